@@ -39,6 +39,13 @@ NS_ASSUME_NONNULL_BEGIN
  */
 + (void)injectAssociate;
 
+/**
+ *  Inject properties marked with \c <DIAssociate> protocol storing values of properties without ivar in \c storage
+ *
+ *  @param storage Storage of values, \c DIAssociationStorageSideTable for properties accessed from many threads
+ */
++ (void)injectAssociateWithStorage:(DIAssociationStorage)storage;
+
 /**
  *  Reject all injections marked explicitly with \c <DIAssociate> protocol.
  */
@@ -57,6 +64,13 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (void)injectAssociate;
 
+/**
+ *  Inject properties marked with \c <DIAssociate> protocol storing values of properties without ivar in \c storage
+ *
+ *  @param storage Storage of values, \c DIAssociationStorageSideTable for properties accessed from many threads
+ */
+- (void)injectAssociateWithStorage:(DIAssociationStorage)storage;
+
 /**
  *  Reject all injections marked explicitly with \c <DIAssociate> protocol.
  */
@@ -28,18 +28,15 @@
 }
 
 + (void)injectAssociate {
+    [self injectAssociateWithStorage:DIAssociationStorageRuntime];
+}
+
++ (void)injectAssociateWithStorage:(DIAssociationStorage)storage {
     [self inject:^NSArray *(Class targetClass, SEL getter, SEL setter,
                             NSString *propertyName, Class propertyClass,
                             NSSet<Protocol *> *propertyProtocols) {
-        return @[
-            DIGetterMake(^id(id target, SEL cmd, id *ivar) {
-                return *ivar;
-            }),
-            DISetterWithOriginalMake(^(id target, SEL cmd, id *ivar, id value, DIOriginalSetter originalSetter) {
-                *ivar = value;
-            })
-        ];
-    } conformingProtocols:@[ @protocol(DIAssociate) ]];
+        return @[ DIGetterIvar(), DISetterIvar() ];
+    } conformingProtocols:@[ @protocol(DIAssociate) ] storage:storage];
 }
 
 + (void)rejectAssociate {
@@ -57,17 +54,15 @@
 @implementation DIImperative (DIAssociate)
 
 - (void)injectAssociate {
-  [[[[[self inject] byPropertyProtocol:@protocol(DIAssociate)]
-      getterBlock:^id(Class targetClass, SEL getter, NSString *propertyName,
-                      Class propertyClass, NSSet<Protocol *> *propertyProtocols,
-                      id target, id *ivar, DIOriginalGetter originalGetter) {
-        return *ivar;
-      }] setterBlock:^(Class targetClass, SEL setter, NSString *propertyName,
-                       Class propertyClass,
-                       NSSet<Protocol *> *propertyProtocols, id target,
-                       id *ivar, id value, DIOriginalSetter originalSetter) {
-    *ivar = value;
-  }] skipDIInjectProtocolFilter];
+  [self injectAssociateWithStorage:DIAssociationStorageRuntime];
+}
+
+- (void)injectAssociateWithStorage:(DIAssociationStorage)storage {
+  [[[[[[self inject] byPropertyProtocol:@protocol(DIAssociate)]
+      getterBlock:DIImperativeGetterFromGetter(DIGetterIvar())]
+      setterBlock:DIImperativeSetterFromSetter(DISetterIvar())]
+      associationStorage:storage]
+      skipDIInjectProtocolFilter];
 }
 
 - (void)rejectAssociate {
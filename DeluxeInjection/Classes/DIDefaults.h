@@ -19,6 +19,8 @@
 
 #import "DIDeluxeInjection.h"
 #import "DIImperative.h"
+#import "DIDefaultsCodec.h"
+#import "DIDefaultsStorage.h"
 
 NS_ASSUME_NONNULL_BEGIN
 
@@ -72,6 +74,44 @@ typedef NSUserDefaults * _Nullable (^DIUserDefaultsBlock)(Class targetClass,
                                                           Class _Nullable propertyClass,
                                                           NSSet<Protocol *> *propertyProtocols);
 
+/**
+ *  Block to define custom storage to use instead of NSUserDefaults
+ *
+ *  @param targetClass       Class to be injected/rejected
+ *  @param propertyName      Property name to be injected/rejected
+ *  @param propertyClass     Class of property to be injected/rejected, \c nil in case of \c id
+ *  @param propertyProtocols Set of property protocols including all superprotocols
+ *
+ *  @return Storage for propertyName of \c targetClass or \c nil to use \c [NSUserDefaults \c standardUserDefaults]
+ */
+typedef id<DIDefaultsStorage> _Nullable (^DIDefaultsStorageBlock)(Class targetClass,
+                                                                 NSString *propertyName,
+                                                                 Class _Nullable propertyClass,
+                                                                 NSSet<Protocol *> *propertyProtocols);
+
+/**
+ *  Options of defaults properties injection
+ */
+typedef NS_OPTIONS(NSUInteger, DIDefaultsOptions) {
+    /**
+     *  Every access reads \c NSUserDefaults, archived values are unarchived on every get
+     */
+    DIDefaultsOptionNone = 0,
+    /**
+     *  Key and defaults are resolved once per property and decoded value is kept in memory,
+     *  value is read and decoded again only after stored value of its key changes
+     *  through setter or any \c NSUserDefaultsDidChangeNotification.
+     *  Getters of \c <DIDefaultsSync> properties do not call \c synchronize in this mode.
+     */
+    DIDefaultsOptionCached = 1 << 0,
+    /**
+     *  Setters of \c <DIDefaultsSync> and \c <DIDefaultsArchivedSync> properties update memory right away
+     *  and \c synchronize is coalesced to be called once per \c defaultsWriteBehindInterval
+     *  or on \c flushDefaults call, getters do not call \c synchronize
+     */
+    DIDefaultsOptionWriteBehind = 1 << 1,
+};
+
 @interface DeluxeInjection (DIDefaults)
 
 /**
@@ -108,12 +148,69 @@ typedef NSUserDefaults * _Nullable (^DIUserDefaultsBlock)(Class targetClass,
  */
 + (void)injectDefaultsWithKeyBlock:(DIDefaultsKeyBlock)keyBlock defaultsBlock:(DIUserDefaultsBlock)defaultsBlock;
 
+/**
+ *  Inject properties marked with \c <DIDefaults>, \c <DIDefaultsSync>,
+ *  \c <DIDefaultsArchive> and \c <DIDefaultsArchiveSync> protocol
+ *  using NSUserDefaults access with custom key provided by block
+ *
+ *  @param keyBlock      Block to provide key for property
+ *  @param defaultsBlock Block to provide NSUserDefaults instance
+ *  @param options       Options of access, \c DIDefaultsOptionCached to keep decoded values in memory
+ */
++ (void)injectDefaultsWithKeyBlock:(DIDefaultsKeyBlock)keyBlock defaultsBlock:(DIUserDefaultsBlock)defaultsBlock options:(DIDefaultsOptions)options;
+
+/**
+ *  Inject properties marked with \c <DIDefaults>, \c <DIDefaultsSync>,
+ *  \c <DIDefaultsArchive> and \c <DIDefaultsArchiveSync> protocol
+ *  using custom storage, for example \c DIMappedStorage, with custom key provided by block
+ *
+ *  @param keyBlock     Block to provide key for property
+ *  @param storageBlock Block to provide storage instance
+ *  @param options      Options of access, \c DIDefaultsOptionCached to keep decoded values in memory
+ */
++ (void)injectDefaultsWithKeyBlock:(DIDefaultsKeyBlock)keyBlock storageBlock:(DIDefaultsStorageBlock)storageBlock options:(DIDefaultsOptions)options;
+
 /**
  *  Reject all injections marked explicitly with \c <DIDefaults>, \c <DIDefaultsSync>,
  *  \c <DIDefaultsArchive> and \c <DIDefaultsArchiveSync> protocol.
  */
 + (void)rejectDefaults;
 
+/**
+ *  Synchronize all defaults changed by properties injected with \c DIDefaultsOptionWriteBehind
+ *  and not synchronized yet, should be called at points where changes should be durable
+ */
++ (void)flushDefaults;
+
+/**
+ *  Codec of \c <DIDefaultsArchived> and \c <DIDefaultsArchivedSync> properties injected after this call
+ *
+ *  @return Codec, \c DIKeyedArchiverCodec by default
+ */
++ (id<DIDefaultsCodec>)defaultsArchiveCodec;
+
+/**
+ *  Change codec of archived properties, properties injected earlier keep using previous codec.
+ *  Use \c DIBinaryCodec for compact and fast encoding of small value objects.
+ *
+ *  @param codec Codec or \c nil to use \c DIKeyedArchiverCodec
+ */
++ (void)setDefaultsArchiveCodec:(nullable id<DIDefaultsCodec>)codec;
+
+/**
+ *  Delay between first unsynchronized change and its synchronization in \c DIDefaultsOptionWriteBehind mode
+ *
+ *  @return Interval in seconds, \c 1.0 by default
+ */
++ (NSTimeInterval)defaultsWriteBehindInterval;
+
+/**
+ *  Change delay between first unsynchronized change and its synchronization
+ *
+ *  @param interval Interval in seconds
+ */
++ (void)setDefaultsWriteBehindInterval:(NSTimeInterval)interval;
+
 @end
 
 //
@@ -155,6 +252,30 @@ typedef NSUserDefaults * _Nullable (^DIUserDefaultsBlock)(Class targetClass,
  */
 - (void)injectDefaultsWithKeyBlock:(DIDefaultsKeyBlock)keyBlock defaultsBlock:(DIUserDefaultsBlock)defaultsBlock;
 
+/**
+ *  Inject properties marked with \c <DIDefaults>, \c <DIDefaultsSync>,
+ *  \c <DIDefaultsArchive> and \c <DIDefaultsArchiveSync> protocol
+ *  using NSUserDefaults access with custom key provided by block
+ *
+ *  @param keyBlock      Block to provide key for property
+ *  @param defaultsBlock Block to provide NSUserDefaults instance
+ *  @param options       Options of access, \c DIDefaultsOptionCached to resolve key and defaults
+ *                       on first access of every property and keep decoded values in memory
+ */
+- (void)injectDefaultsWithKeyBlock:(DIDefaultsKeyBlock)keyBlock defaultsBlock:(DIUserDefaultsBlock)defaultsBlock options:(DIDefaultsOptions)options;
+
+/**
+ *  Inject properties marked with \c <DIDefaults>, \c <DIDefaultsSync>,
+ *  \c <DIDefaultsArchive> and \c <DIDefaultsArchiveSync> protocol
+ *  using custom storage, for example \c DIMappedStorage, with custom key provided by block
+ *
+ *  @param keyBlock     Block to provide key for property
+ *  @param storageBlock Block to provide storage instance
+ *  @param options      Options of access, \c DIDefaultsOptionCached to resolve key and storage
+ *                      on first access of every property and keep decoded values in memory
+ */
+- (void)injectDefaultsWithKeyBlock:(DIDefaultsKeyBlock)keyBlock storageBlock:(DIDefaultsStorageBlock)storageBlock options:(DIDefaultsOptions)options;
+
 /**
  *  Reject all injections marked explicitly with \c <DIDefaults>,
  *  \c <DIDefaultsSync>, \c <DIDefaultsArchive> and \c <DIDefaultsArchiveSync> protocol.
@@ -17,14 +17,207 @@
 //  limitations under the License.
 //
 
+#import <stdatomic.h>
+
 #import "DIDeluxeInjectionPlugin.h"
 #import "DIInjectPlugin.h"
 #import "DIDefaults.h"
+#import "DIDefaultsCodec.h"
+#import "DIDefaultsStorage.h"
 
 @implementation NSObject (DIDefaults)
 
 @end
 
+//
+
+static NSArray<Protocol *> *DIDefaultsProtocols() {
+    return @[ @protocol(DIDefaults),
+              @protocol(DIDefaultsSync),
+              @protocol(DIDefaultsArchived),
+              @protocol(DIDefaultsArchivedSync) ];
+}
+
+static void DIDefaultsProtocolGetFlags(Protocol *protocol, BOOL *withSync, BOOL *withArchive) {
+    *withSync = (protocol == @protocol(DIDefaultsSync) || protocol == @protocol(DIDefaultsArchivedSync));
+    *withArchive = (protocol == @protocol(DIDefaultsArchived) || protocol == @protocol(DIDefaultsArchivedSync));
+}
+
+static id<DIDefaultsCodec> DIDefaultsArchiveCodec;
+
+static id DIDefaultsCodecLock() {
+    static id lock;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        lock = [NSObject new];
+        DIDefaultsArchiveCodec = [[DIKeyedArchiverCodec alloc] init];
+    });
+    return lock;
+}
+
+/**
+ *  Codec for properties being injected, archived properties keep codec they were injected with
+ */
+static id<DIDefaultsCodec> DIDefaultsCodecForArchive(BOOL withArchive) {
+    if (!withArchive) {
+        return nil;
+    }
+    @synchronized(DIDefaultsCodecLock()) {
+        return DIDefaultsArchiveCodec;
+    }
+}
+
+static id DIDefaultsDecode(id value, id<DIDefaultsCodec> codec) {
+    if (codec && value) {
+        return [codec decodeData:value];
+    }
+    return value;
+}
+
+static id DIDefaultsEncode(id value, id<DIDefaultsCodec> codec) {
+    if (codec && value) {
+        return [codec encodeObject:value];
+    }
+    return value;
+}
+
+//
+
+static _Atomic(NSUInteger) DIDefaultsGeneration = 1;
+
+/**
+ *  Any change of any defaults makes cached values to be checked against stored values on next access
+ */
+static NSUInteger DIDefaultsCurrentGeneration() {
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        for (NSString *name in @[ NSUserDefaultsDidChangeNotification, DIDefaultsStorageDidChangeNotification ]) {
+            [[NSNotificationCenter defaultCenter] addObserverForName:name object:nil queue:nil usingBlock:^(NSNotification *note) {
+                atomic_fetch_add(&DIDefaultsGeneration, 1);
+            }];
+        }
+    });
+    return atomic_load(&DIDefaultsGeneration);
+}
+
+/**
+ *  Decoded value of single property with stored value it was decoded from
+ */
+@interface DIDefaultsCacheEntry : NSObject {
+@public
+    NSUInteger generation;
+    id storedValue;
+    id value;
+}
+
+@end
+
+@implementation DIDefaultsCacheEntry
+
+@end
+
+//
+
+static NSTimeInterval DIDefaultsWriteBehindInterval = 1.0;
+static NSMutableSet<id<DIDefaultsStorage>> *DIDefaultsPending;
+static BOOL DIDefaultsFlushScheduled;
+
+static id DIDefaultsPendingLock() {
+    static id lock;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        lock = [NSObject new];
+        DIDefaultsPending = [NSMutableSet set];
+    });
+    return lock;
+}
+
+static void DIDefaultsFlush() {
+    NSArray<id<DIDefaultsStorage>> *pending;
+    @synchronized(DIDefaultsPendingLock()) {
+        pending = DIDefaultsPending.allObjects;
+        [DIDefaultsPending removeAllObjects];
+        DIDefaultsFlushScheduled = NO;
+    }
+    for (id<DIDefaultsStorage> defaults in pending) {
+        [defaults synchronize];
+    }
+}
+
+/**
+ *  Remember defaults to be synchronized, all changes made during interval are synchronized together
+ */
+static void DIDefaultsScheduleFlush(id<DIDefaultsStorage> defaults) {
+    NSTimeInterval interval;
+    @synchronized(DIDefaultsPendingLock()) {
+        [DIDefaultsPending addObject:defaults];
+        if (DIDefaultsFlushScheduled) {
+            return;
+        }
+        DIDefaultsFlushScheduled = YES;
+        interval = DIDefaultsWriteBehindInterval;
+    }
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(interval * NSEC_PER_SEC)), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_BACKGROUND, 0), ^{
+        DIDefaultsFlush();
+    });
+}
+
+/**
+ *  Create getter and setter of defaults property
+ *
+ *  @return Array with getter and setter blocks
+ */
+static NSArray *DIDefaultsAccessorsMake(id<DIDefaultsStorage> defaults, NSString *key, BOOL withSync, id<DIDefaultsCodec> codec, DIDefaultsOptions options) {
+    BOOL writeBehind = withSync && (options & DIDefaultsOptionWriteBehind);
+    withSync = withSync && !writeBehind;
+    
+    if (!(options & DIDefaultsOptionCached)) {
+        return @[DIGetterMake(^id _Nullable(id target, SEL cmd, id *ivar) {
+            if (withSync) {
+                [defaults synchronize];
+            }
+            return DIDefaultsDecode([defaults objectForKey:key], codec);
+        }), DISetterWithOriginalMake(^(id target, SEL cmd, id *ivar, id value, void (*originalSetter)(id, SEL, id)) {
+            [defaults setObject:DIDefaultsEncode(value, codec) forKey:key];
+            if (withSync) {
+                [defaults synchronize];
+            }
+            if (writeBehind) {
+                DIDefaultsScheduleFlush(defaults);
+            }
+        })];
+    }
+    
+    DIDefaultsCacheEntry *entry = [[DIDefaultsCacheEntry alloc] init];
+    return @[DIGetterMake(^id _Nullable(id target, SEL cmd, id *ivar) {
+        NSUInteger generation = DIDefaultsCurrentGeneration();
+        @synchronized(entry) {
+            if (entry->generation != generation) {
+                id storedValue = [defaults objectForKey:key];
+                if (entry->generation == 0 || !(storedValue == entry->storedValue || [storedValue isEqual:entry->storedValue])) {
+                    entry->storedValue = storedValue;
+                    entry->value = DIDefaultsDecode(storedValue, codec);
+                }
+                entry->generation = generation;
+            }
+            return entry->value;
+        }
+    }), DISetterWithOriginalMake(^(id target, SEL cmd, id *ivar, id value, void (*originalSetter)(id, SEL, id)) {
+        @synchronized(entry) {
+            [defaults setObject:DIDefaultsEncode(value, codec) forKey:key];
+            entry->generation = 0;
+        }
+        if (withSync) {
+            [defaults synchronize];
+        }
+        if (writeBehind) {
+            DIDefaultsScheduleFlush(defaults);
+        }
+    })];
+}
+
+//
+
 @implementation DeluxeInjection (DIDefaults)
 
 #pragma mark - Private
@@ -57,64 +250,70 @@
 }
 
 + (void)injectDefaultsWithKeyBlock:(DIDefaultsKeyBlock)keyBlock defaultsBlock:(DIUserDefaultsBlock)defaultsBlock {
-    NSMutableSet *defaultsProtocols = [NSMutableSet setWithArray:@[
-        @protocol(DIDefaults),
-        @protocol(DIDefaultsSync),
-        @protocol(DIDefaultsArchived),
-        @protocol(DIDefaultsArchivedSync),
-    ]];
+    [self injectDefaultsWithKeyBlock:keyBlock defaultsBlock:defaultsBlock options:DIDefaultsOptionNone];
+}
+
++ (void)injectDefaultsWithKeyBlock:(DIDefaultsKeyBlock)keyBlock defaultsBlock:(DIUserDefaultsBlock)defaultsBlock options:(DIDefaultsOptions)options {
+    [self injectDefaultsWithKeyBlock:keyBlock storageBlock:^id<DIDefaultsStorage> (Class targetClass, NSString *propertyName, Class propertyClass, NSSet<Protocol *> *propertyProtocols) {
+        return defaultsBlock(targetClass, propertyName, propertyClass, propertyProtocols);
+    } options:options];
+}
+
++ (void)injectDefaultsWithKeyBlock:(DIDefaultsKeyBlock)keyBlock storageBlock:(DIDefaultsStorageBlock)storageBlock options:(DIDefaultsOptions)options {
+    NSArray<Protocol *> *defaultsProtocols = DIDefaultsProtocols();
     
     [self inject:^NSArray *(Class targetClass, SEL getter, SEL setter, NSString *propertyName, Class propertyClass, NSSet<Protocol *> *propertyProtocols) {
+        Protocol *protocol = nil;
+        for (Protocol *defaultsProtocol in defaultsProtocols) {
+            if ([propertyProtocols containsObject:defaultsProtocol]) {
+                protocol = defaultsProtocol;
+                break;
+            }
+        }
         
-        NSMutableSet *protocolsCopy = [defaultsProtocols mutableCopy];
-        [protocolsCopy intersectSet:propertyProtocols];
-        Protocol *protocol = protocolsCopy.anyObject;
-        NSValue *protocolKey = [NSValue valueWithPointer:(__bridge void *)protocol];
-        
-        BOOL withSync = [@{
-            [NSValue valueWithPointer:(__bridge void *)@protocol(DIDefaults)] : @NO,
-            [NSValue valueWithPointer:(__bridge void *)@protocol(DIDefaultsSync)] : @YES,
-            [NSValue valueWithPointer:(__bridge void *)@protocol(DIDefaultsArchived)] : @NO,
-            [NSValue valueWithPointer:(__bridge void *)@protocol(DIDefaultsArchivedSync)] : @YES,
-        }[protocolKey] boolValue];
-        
-        BOOL withArchive = [@{
-            [NSValue valueWithPointer:(__bridge void *)@protocol(DIDefaults)] : @NO,
-            [NSValue valueWithPointer:(__bridge void *)@protocol(DIDefaultsSync)] : @NO,
-            [NSValue valueWithPointer:(__bridge void *)@protocol(DIDefaultsArchived)] : @YES,
-            [NSValue valueWithPointer:(__bridge void *)@protocol(DIDefaultsArchivedSync)] : @YES,
-        }[protocolKey] boolValue];
+        BOOL withSync;
+        BOOL withArchive;
+        DIDefaultsProtocolGetFlags(protocol, &withSync, &withArchive);
+        id<DIDefaultsCodec> codec = DIDefaultsCodecForArchive(withArchive);
         
         NSString *key = keyBlock(targetClass, propertyName, propertyClass, propertyProtocols) ?: propertyName;
-        NSUserDefaults *defaults = defaultsBlock(targetClass, propertyName, propertyClass, propertyProtocols) ?: [NSUserDefaults standardUserDefaults];
-        return @[DIGetterMake(^id _Nullable(id target, SEL cmd, id *ivar) {
-            if (withSync) {
-                [defaults synchronize];
-            }
-            id value = [defaults objectForKey:key];
-            if (withArchive && value) {
-                return [NSKeyedUnarchiver unarchiveObjectWithData:value];
-            }
-            return value;
-        }), DISetterWithOriginalMake(^(id target, SEL cmd, id *ivar, id value, void (*originalSetter)(id, SEL, id)) {
-            if (withArchive && value) {
-                value = [NSKeyedArchiver archivedDataWithRootObject:value];
-            }
-            [defaults setObject:value forKey:key];
-            if (withSync) {
-                [defaults synchronize];
-            }
-        })];
-    } conformingProtocols:defaultsProtocols.allObjects];
+        id<DIDefaultsStorage> defaults = storageBlock(targetClass, propertyName, propertyClass, propertyProtocols) ?: [NSUserDefaults standardUserDefaults];
+        return DIDefaultsAccessorsMake(defaults, key, withSync, codec, options);
+    } conformingProtocols:defaultsProtocols];
 }
 
 + (void)rejectDefaults {
     [self reject:^BOOL(Class targetClass, NSString *propertyName, Class propertyClass, NSSet<Protocol *> *propertyProtocols) {
         return YES;
-    } conformingProtocols:@[ @protocol(DIDefaults),
-                             @protocol(DIDefaultsSync),
-                             @protocol(DIDefaultsArchived),
-                             @protocol(DIDefaultsArchivedSync) ]];
+    } conformingProtocols:DIDefaultsProtocols()];
+}
+
++ (void)flushDefaults {
+    DIDefaultsFlush();
+}
+
++ (id<DIDefaultsCodec>)defaultsArchiveCodec {
+    @synchronized(DIDefaultsCodecLock()) {
+        return DIDefaultsArchiveCodec;
+    }
+}
+
++ (void)setDefaultsArchiveCodec:(id<DIDefaultsCodec>)codec {
+    @synchronized(DIDefaultsCodecLock()) {
+        DIDefaultsArchiveCodec = codec ?: [[DIKeyedArchiverCodec alloc] init];
+    }
+}
+
++ (NSTimeInterval)defaultsWriteBehindInterval {
+    @synchronized(DIDefaultsPendingLock()) {
+        return DIDefaultsWriteBehindInterval;
+    }
+}
+
++ (void)setDefaultsWriteBehindInterval:(NSTimeInterval)interval {
+    @synchronized(DIDefaultsPendingLock()) {
+        DIDefaultsWriteBehindInterval = interval;
+    }
 }
 
 @end
@@ -145,56 +344,57 @@
 
 
 - (void)injectDefaultsWithKeyBlock:(DIDefaultsKeyBlock)keyBlock defaultsBlock:(DIUserDefaultsBlock)defaultsBlock {
-    for (Protocol *protocol in @[ @protocol(DIDefaults),
-                                  @protocol(DIDefaultsSync),
-                                  @protocol(DIDefaultsArchived),
-                                  @protocol(DIDefaultsArchivedSync) ]) {
-        NSValue *protocolKey = [NSValue valueWithPointer:(__bridge void *)protocol];
-        
-        BOOL withSync = [@{
-            [NSValue valueWithPointer:(__bridge void *)@protocol(DIDefaults)] : @NO,
-            [NSValue valueWithPointer:(__bridge void *)@protocol(DIDefaultsSync)] : @YES,
-            [NSValue valueWithPointer:(__bridge void *)@protocol(DIDefaultsArchived)] : @NO,
-            [NSValue valueWithPointer:(__bridge void *)@protocol(DIDefaultsArchivedSync)] : @YES,
-        }[protocolKey] boolValue];
+    [self injectDefaultsWithKeyBlock:keyBlock defaultsBlock:defaultsBlock options:DIDefaultsOptionNone];
+}
+
+- (void)injectDefaultsWithKeyBlock:(DIDefaultsKeyBlock)keyBlock defaultsBlock:(DIUserDefaultsBlock)defaultsBlock options:(DIDefaultsOptions)options {
+    [self injectDefaultsWithKeyBlock:keyBlock storageBlock:^id<DIDefaultsStorage> (Class targetClass, NSString *propertyName, Class propertyClass, NSSet<Protocol *> *propertyProtocols) {
+        return defaultsBlock(targetClass, propertyName, propertyClass, propertyProtocols);
+    } options:options];
+}
+
+- (void)injectDefaultsWithKeyBlock:(DIDefaultsKeyBlock)keyBlock storageBlock:(DIDefaultsStorageBlock)storageBlock options:(DIDefaultsOptions)options {
+    for (Protocol *protocol in DIDefaultsProtocols()) {
+        BOOL withSync;
+        BOOL withArchive;
+        DIDefaultsProtocolGetFlags(protocol, &withSync, &withArchive);
+        id<DIDefaultsCodec> codec = DIDefaultsCodecForArchive(withArchive);
         
-        BOOL withArchive = [@{
-            [NSValue valueWithPointer:(__bridge void *)@protocol(DIDefaults)] : @NO,
-            [NSValue valueWithPointer:(__bridge void *)@protocol(DIDefaultsSync)] : @NO,
-            [NSValue valueWithPointer:(__bridge void *)@protocol(DIDefaultsArchived)] : @YES,
-            [NSValue valueWithPointer:(__bridge void *)@protocol(DIDefaultsArchivedSync)] : @YES,
-        }[protocolKey] boolValue];
+        if (options & DIDefaultsOptionCached) {
+            // Key and storage are resolved and accessors are created once per property, reads take no shared lock
+            [[[[self inject] byPropertyProtocol:protocol] accessorsBlock:^NSArray *(Class targetClass, SEL getter, SEL setter, NSString *propertyName, Class propertyClass, NSSet<Protocol *> *propertyProtocols) {
+                NSString *key = keyBlock(targetClass, propertyName, propertyClass, propertyProtocols) ?: propertyName;
+                id<DIDefaultsStorage> defaults = storageBlock(targetClass, propertyName, propertyClass, propertyProtocols) ?: [NSUserDefaults standardUserDefaults];
+                return DIDefaultsAccessorsMake(defaults, key, withSync, codec, options);
+            }] skipDIInjectProtocolFilter];
+            continue;
+        }
         
+        BOOL writeBehind = withSync && (options & DIDefaultsOptionWriteBehind);
+        BOOL syncNow = withSync && !writeBehind;
         [[[[[self inject] byPropertyProtocol:protocol] getterBlock:^id _Nullable(Class targetClass, SEL getter, NSString *propertyName, Class propertyClass, NSSet<Protocol *> *propertyProtocols, id target, id *ivar, DIOriginalGetter originalGetter) {
-            NSUserDefaults *defaults = defaultsBlock(targetClass, propertyName, propertyClass, propertyProtocols) ?: [NSUserDefaults standardUserDefaults];
+            id<DIDefaultsStorage> defaults = storageBlock(targetClass, propertyName, propertyClass, propertyProtocols) ?: [NSUserDefaults standardUserDefaults];
             NSString *key = keyBlock(targetClass, propertyName, propertyClass, propertyProtocols) ?: propertyName;
-            if (withSync) {
+            if (syncNow) {
                 [defaults synchronize];
             }
-            id value = [defaults objectForKey:key];
-            if (withArchive && value) {
-                return [NSKeyedUnarchiver unarchiveObjectWithData:value];
-            }
-            return value;
+            return DIDefaultsDecode([defaults objectForKey:key], codec);
         }] setterBlock:^(Class targetClass, SEL setter, NSString *propertyName, Class propertyClass, NSSet<Protocol *> *propertyProtocols, id target, id *ivar, id value, DIOriginalSetter originalSetter) {
-            NSUserDefaults *defaults = defaultsBlock(targetClass, propertyName, propertyClass, propertyProtocols) ?: [NSUserDefaults standardUserDefaults];
+            id<DIDefaultsStorage> defaults = storageBlock(targetClass, propertyName, propertyClass, propertyProtocols) ?: [NSUserDefaults standardUserDefaults];
             NSString *key = keyBlock(targetClass, propertyName, propertyClass, propertyProtocols) ?: propertyName;
-            if (withArchive && value) {
-                value = [NSKeyedArchiver archivedDataWithRootObject:value];
-            }
-            [defaults setObject:value forKey:key];
-            if (withSync) {
+            [defaults setObject:DIDefaultsEncode(value, codec) forKey:key];
+            if (syncNow) {
                 [defaults synchronize];
             }
+            if (writeBehind) {
+                DIDefaultsScheduleFlush(defaults);
+            }
         }] skipDIInjectProtocolFilter];
     }
 }
 
 - (void)rejectDefaults {
-    for (Protocol *protocol in @[ @protocol(DIDefaults),
-                                  @protocol(DIDefaultsSync),
-                                  @protocol(DIDefaultsArchived),
-                                  @protocol(DIDefaultsArchivedSync) ]) {
+    for (Protocol *protocol in DIDefaultsProtocols()) {
         [[[self reject] byPropertyProtocol:protocol] skipDIInjectProtocolFilter];
     }
 }
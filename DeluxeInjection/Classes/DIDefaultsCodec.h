@@ -0,0 +1,80 @@
+//
+//  DIDefaultsCodec.h
+//  DeluxeInjection
+//
+//  Copyright (c) 2016 Anton Bukov <k06aaa@gmail.com>
+//
+//  Licensed under the MIT License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  https://opensource.org/licenses/MIT
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ *  Converts values of \c <DIDefaultsArchived> and \c <DIDefaultsArchivedSync> properties to data and back
+ */
+@protocol DIDefaultsCodec <NSObject>
+
+/**
+ *  Encode property value
+ *
+ *  @param object Value to encode
+ *
+ *  @return Data to store or \c nil if value can not be encoded
+ */
+- (nullable NSData *)encodeObject:(id)object;
+
+/**
+ *  Decode property value
+ *
+ *  @param data Stored data
+ *
+ *  @return Decoded value or \c nil if data can not be decoded
+ */
+- (nullable id)decodeData:(NSData *)data;
+
+@end
+
+//
+
+/**
+ *  Codec using \c NSKeyedArchiver and \c NSKeyedUnarchiver, used by default
+ */
+@interface DIKeyedArchiverCodec : NSObject <DIDefaultsCodec>
+
+@end
+
+//
+
+/**
+ *  Compact binary codec, several times smaller and faster than keyed archiving for small value objects.
+ *  Property list classes, \c NSSet and \c NSNull are written directly,
+ *  other objects are written using their \c NSCoding keyed fields and class name.
+ *  Decoding is schema tolerant: missing fields are decoded as \c nil or zero, unknown fields are skipped
+ *  and objects of unknown classes are decoded as \c nil. Data stored by \c NSKeyedArchiver is decoded too,
+ *  so existing values survive codec change. Collections are decoded immutable.
+ *  Values using non-keyed coding and object graphs with cycles are stored as keyed archives.
+ */
+@interface DIBinaryCodec : NSObject <DIDefaultsCodec>
+
+/**
+ *  Version of format written by this codec, data of newer versions is not decoded
+ *
+ *  @return Format version
+ */
++ (uint8_t)formatVersion;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,559 @@
+//
+//  DIDefaultsCodec.m
+//  DeluxeInjection
+//
+//  Copyright (c) 2016 Anton Bukov <k06aaa@gmail.com>
+//
+//  Licensed under the MIT License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  https://opensource.org/licenses/MIT
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import "DIDefaultsCodec.h"
+
+@implementation DIKeyedArchiverCodec
+
+- (NSData *)encodeObject:(id)object {
+    return [NSKeyedArchiver archivedDataWithRootObject:object];
+}
+
+- (id)decodeData:(NSData *)data {
+    @try {
+        return [NSKeyedUnarchiver unarchiveObjectWithData:data];
+    }
+    @catch (NSException *exception) {
+        return nil;
+    }
+}
+
+@end
+
+//
+// Binary format:
+//   header: 'D', 'I', uint8 format version
+//   value:  uint8 tag and payload depending on tag,
+//           integers are zigzag varints, lengths and counts are varints, doubles are 8 bytes
+//   object: class name string, fields count, (key string, value) for every field
+//   values which can not be written this way (non-keyed coding, cycles) are stored as keyed archive instead
+//
+
+static uint8_t const DIBinaryCodecMagic[2] = {'D', 'I'};
+static uint8_t const DIBinaryCodecVersion = 1;
+static NSUInteger const DIBinaryCodecMaxDepth = 64;
+
+typedef NS_ENUM(uint8_t, DIBinaryTag) {
+    DIBinaryTagNull = 0,
+    DIBinaryTagFalse = 1,
+    DIBinaryTagTrue = 2,
+    DIBinaryTagInteger = 3,
+    DIBinaryTagDouble = 4,
+    DIBinaryTagString = 5,
+    DIBinaryTagData = 6,
+    DIBinaryTagDate = 7,
+    DIBinaryTagArray = 8,
+    DIBinaryTagDictionary = 9,
+    DIBinaryTagSet = 10,
+    DIBinaryTagObject = 11,
+    DIBinaryTagUnsigned = 12,
+};
+
+static void DIBinaryWriteVarint(NSMutableData *data, uint64_t value) {
+    uint8_t buffer[10];
+    size_t length = 0;
+    do {
+        buffer[length] = (value & 0x7F) | (value > 0x7F ? 0x80 : 0);
+        value >>= 7;
+        length++;
+    } while (value);
+    [data appendBytes:buffer length:length];
+}
+
+static void DIBinaryWriteTag(NSMutableData *data, DIBinaryTag tag) {
+    [data appendBytes:&tag length:1];
+}
+
+static void DIBinaryWriteString(NSMutableData *data, NSString *string) {
+    const char *utf8 = string.UTF8String;
+    NSUInteger length = [string lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+    DIBinaryWriteVarint(data, length);
+    [data appendBytes:utf8 length:length];
+}
+
+static void DIBinaryWriteDouble(NSMutableData *data, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    bits = CFSwapInt64HostToLittle(bits);
+    [data appendBytes:&bits length:sizeof(bits)];
+}
+
+typedef struct {
+    const uint8_t *bytes;
+    size_t length;
+    size_t offset;
+} DIBinaryReader;
+
+static BOOL DIBinaryReadVarint(DIBinaryReader *reader, uint64_t *value) {
+    uint64_t result = 0;
+    for (NSUInteger shift = 0; shift < 64; shift += 7) {
+        if (reader->offset >= reader->length) {
+            return NO;
+        }
+        uint8_t byte = reader->bytes[reader->offset++];
+        result |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return YES;
+        }
+    }
+    return NO;
+}
+
+static BOOL DIBinaryReadCount(DIBinaryReader *reader, NSUInteger *count) {
+    uint64_t value;
+    // Every element takes at least one byte, so larger counts are corrupted
+    if (!DIBinaryReadVarint(reader, &value) || value > reader->length - reader->offset) {
+        return NO;
+    }
+    *count = (NSUInteger)value;
+    return YES;
+}
+
+static NSString *DIBinaryReadString(DIBinaryReader *reader) {
+    NSUInteger length;
+    if (!DIBinaryReadCount(reader, &length)) {
+        return nil;
+    }
+    NSString *string = [[NSString alloc] initWithBytes:reader->bytes + reader->offset length:length encoding:NSUTF8StringEncoding];
+    reader->offset += length;
+    return string;
+}
+
+static BOOL DIBinaryReadDouble(DIBinaryReader *reader, double *value) {
+    uint64_t bits;
+    if (reader->length - reader->offset < sizeof(bits)) {
+        return NO;
+    }
+    memcpy(&bits, reader->bytes + reader->offset, sizeof(bits));
+    reader->offset += sizeof(bits);
+    bits = CFSwapInt64LittleToHost(bits);
+    memcpy(value, &bits, sizeof(bits));
+    return YES;
+}
+
+//
+
+/**
+ *  Keyed coder collecting fields of single object on encoding and providing them on decoding
+ */
+@interface DIBinaryCoder : NSCoder
+
+@property (strong, nonatomic) NSMutableDictionary<NSString *, id> *fields;
+
+@end
+
+@implementation DIBinaryCoder
+
+- (instancetype)initWithFields:(NSMutableDictionary<NSString *, id> *)fields {
+    self = [super init];
+    if (self) {
+        _fields = fields;
+    }
+    return self;
+}
+
+- (BOOL)allowsKeyedCoding {
+    return YES;
+}
+
+- (BOOL)requiresSecureCoding {
+    return NO;
+}
+
+#pragma mark - Encoding
+
+- (void)encodeObject:(id)object forKey:(NSString *)key {
+    self.fields[key] = object;
+}
+
+- (void)encodeConditionalObject:(id)object forKey:(NSString *)key {
+    self.fields[key] = object;
+}
+
+- (void)encodeBool:(BOOL)value forKey:(NSString *)key {
+    self.fields[key] = @(value);
+}
+
+- (void)encodeInt:(int)value forKey:(NSString *)key {
+    self.fields[key] = @(value);
+}
+
+- (void)encodeInt32:(int32_t)value forKey:(NSString *)key {
+    self.fields[key] = @(value);
+}
+
+- (void)encodeInt64:(int64_t)value forKey:(NSString *)key {
+    self.fields[key] = @(value);
+}
+
+- (void)encodeInteger:(NSInteger)value forKey:(NSString *)key {
+    self.fields[key] = @(value);
+}
+
+- (void)encodeFloat:(float)value forKey:(NSString *)key {
+    self.fields[key] = @(value);
+}
+
+- (void)encodeDouble:(double)value forKey:(NSString *)key {
+    self.fields[key] = @(value);
+}
+
+- (void)encodeBytes:(const uint8_t *)bytes length:(NSUInteger)length forKey:(NSString *)key {
+    self.fields[key] = [NSData dataWithBytes:bytes length:length];
+}
+
+#pragma mark - Decoding
+
+- (BOOL)containsValueForKey:(NSString *)key {
+    return self.fields[key] != nil;
+}
+
+- (id)decodeObjectForKey:(NSString *)key {
+    return self.fields[key];
+}
+
+- (id)decodeObjectOfClass:(Class)aClass forKey:(NSString *)key {
+    id object = self.fields[key];
+    return [object isKindOfClass:aClass] ? object : nil;
+}
+
+- (id)decodeObjectOfClasses:(NSSet<Class> *)classes forKey:(NSString *)key {
+    id object = self.fields[key];
+    for (Class aClass in classes) {
+        if ([object isKindOfClass:aClass]) {
+            return object;
+        }
+    }
+    return nil;
+}
+
+- (NSNumber *)numberForKey:(NSString *)key {
+    id number = self.fields[key];
+    return [number isKindOfClass:[NSNumber class]] ? number : nil;
+}
+
+- (BOOL)decodeBoolForKey:(NSString *)key {
+    return [self numberForKey:key].boolValue;
+}
+
+- (int)decodeIntForKey:(NSString *)key {
+    return [self numberForKey:key].intValue;
+}
+
+- (int32_t)decodeInt32ForKey:(NSString *)key {
+    return [self numberForKey:key].intValue;
+}
+
+- (int64_t)decodeInt64ForKey:(NSString *)key {
+    return [self numberForKey:key].longLongValue;
+}
+
+- (NSInteger)decodeIntegerForKey:(NSString *)key {
+    return [self numberForKey:key].integerValue;
+}
+
+- (float)decodeFloatForKey:(NSString *)key {
+    return [self numberForKey:key].floatValue;
+}
+
+- (double)decodeDoubleForKey:(NSString *)key {
+    return [self numberForKey:key].doubleValue;
+}
+
+- (const uint8_t *)decodeBytesForKey:(NSString *)key returnedLength:(NSUInteger *)length {
+    id data = self.fields[key];
+    if (![data isKindOfClass:[NSData class]]) {
+        *length = 0;
+        return NULL;
+    }
+    *length = [data length];
+    return [data bytes];
+}
+
+@end
+
+//
+
+static BOOL DIBinaryWriteValue(NSMutableData *data, id value, NSUInteger depth) {
+    if (depth > DIBinaryCodecMaxDepth) {
+        return NO;
+    }
+    
+    if (value == nil || value == [NSNull null]) {
+        DIBinaryWriteTag(data, DIBinaryTagNull);
+        return YES;
+    }
+    
+    if ([value isKindOfClass:[NSNumber class]] && ![value isKindOfClass:[NSDecimalNumber class]]) {
+        CFNumberRef number = (__bridge CFNumberRef)value;
+        if (CFGetTypeID(number) == CFBooleanGetTypeID()) {
+            DIBinaryWriteTag(data, [value boolValue] ? DIBinaryTagTrue : DIBinaryTagFalse);
+        }
+        else if (CFNumberIsFloatType(number)) {
+            DIBinaryWriteTag(data, DIBinaryTagDouble);
+            DIBinaryWriteDouble(data, [value doubleValue]);
+        }
+        else if ((strcmp([value objCType], @encode(unsigned long long)) == 0 ||
+                  strcmp([value objCType], @encode(unsigned long)) == 0) &&
+                 [value unsignedLongLongValue] > INT64_MAX) {
+            DIBinaryWriteTag(data, DIBinaryTagUnsigned);
+            DIBinaryWriteVarint(data, [value unsignedLongLongValue]);
+        }
+        else {
+            int64_t integer = [value longLongValue];
+            DIBinaryWriteTag(data, DIBinaryTagInteger);
+            DIBinaryWriteVarint(data, ((uint64_t)integer << 1) ^ (uint64_t)(integer >> 63));
+        }
+        return YES;
+    }
+    
+    if ([value isKindOfClass:[NSString class]]) {
+        DIBinaryWriteTag(data, DIBinaryTagString);
+        DIBinaryWriteString(data, value);
+        return YES;
+    }
+    
+    if ([value isKindOfClass:[NSData class]]) {
+        DIBinaryWriteTag(data, DIBinaryTagData);
+        DIBinaryWriteVarint(data, [value length]);
+        [data appendData:value];
+        return YES;
+    }
+    
+    if ([value isKindOfClass:[NSDate class]]) {
+        DIBinaryWriteTag(data, DIBinaryTagDate);
+        DIBinaryWriteDouble(data, [value timeIntervalSinceReferenceDate]);
+        return YES;
+    }
+    
+    if ([value isKindOfClass:[NSArray class]] || [value isKindOfClass:[NSSet class]]) {
+        DIBinaryWriteTag(data, [value isKindOfClass:[NSArray class]] ? DIBinaryTagArray : DIBinaryTagSet);
+        DIBinaryWriteVarint(data, [value count]);
+        for (id item in value) {
+            if (!DIBinaryWriteValue(data, item, depth + 1)) {
+                return NO;
+            }
+        }
+        return YES;
+    }
+    
+    if ([value isKindOfClass:[NSDictionary class]]) {
+        DIBinaryWriteTag(data, DIBinaryTagDictionary);
+        DIBinaryWriteVarint(data, [value count]);
+        __block BOOL success = YES;
+        [value enumerateKeysAndObjectsUsingBlock:^(id key, id item, BOOL *stop) {
+            success = DIBinaryWriteValue(data, key, depth + 1) && DIBinaryWriteValue(data, item, depth + 1);
+            *stop = !success;
+        }];
+        return success;
+    }
+    
+    Class klass = [value classForCoder];
+    if (![klass conformsToProtocol:@protocol(NSCoding)]) {
+        return NO;
+    }
+    DIBinaryCoder *coder = [[DIBinaryCoder alloc] initWithFields:[NSMutableDictionary dictionary]];
+    [value encodeWithCoder:coder];
+    
+    DIBinaryWriteTag(data, DIBinaryTagObject);
+    DIBinaryWriteString(data, NSStringFromClass(klass));
+    DIBinaryWriteVarint(data, coder.fields.count);
+    for (NSString *key in coder.fields) {
+        DIBinaryWriteString(data, key);
+        if (!DIBinaryWriteValue(data, coder.fields[key], depth + 1)) {
+            return NO;
+        }
+    }
+    return YES;
+}
+
+static BOOL DIBinaryReadValue(DIBinaryReader *reader, id *value, NSUInteger depth) {
+    if (depth > DIBinaryCodecMaxDepth || reader->offset >= reader->length) {
+        return NO;
+    }
+    
+    DIBinaryTag tag = reader->bytes[reader->offset++];
+    switch (tag) {
+        case DIBinaryTagNull:
+            *value = nil;
+            return YES;
+            
+        case DIBinaryTagFalse:
+        case DIBinaryTagTrue:
+            *value = @(tag == DIBinaryTagTrue);
+            return YES;
+            
+        case DIBinaryTagInteger: {
+            uint64_t zigzag;
+            if (!DIBinaryReadVarint(reader, &zigzag)) {
+                return NO;
+            }
+            *value = @((int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1));
+            return YES;
+        }
+            
+        case DIBinaryTagUnsigned: {
+            uint64_t integer;
+            if (!DIBinaryReadVarint(reader, &integer)) {
+                return NO;
+            }
+            *value = @(integer);
+            return YES;
+        }
+            
+        case DIBinaryTagDouble:
+        case DIBinaryTagDate: {
+            double number;
+            if (!DIBinaryReadDouble(reader, &number)) {
+                return NO;
+            }
+            *value = (tag == DIBinaryTagDate) ? [NSDate dateWithTimeIntervalSinceReferenceDate:number] : @(number);
+            return YES;
+        }
+            
+        case DIBinaryTagString:
+            *value = DIBinaryReadString(reader);
+            return (*value != nil);
+            
+        case DIBinaryTagData: {
+            NSUInteger length;
+            if (!DIBinaryReadCount(reader, &length)) {
+                return NO;
+            }
+            *value = [NSData dataWithBytes:reader->bytes + reader->offset length:length];
+            reader->offset += length;
+            return YES;
+        }
+            
+        case DIBinaryTagArray:
+        case DIBinaryTagSet: {
+            NSUInteger count;
+            if (!DIBinaryReadCount(reader, &count)) {
+                return NO;
+            }
+            NSMutableArray *items = [NSMutableArray arrayWithCapacity:count];
+            for (NSUInteger i = 0; i < count; i++) {
+                id item;
+                if (!DIBinaryReadValue(reader, &item, depth + 1)) {
+                    return NO;
+                }
+                [items addObject:item ?: [NSNull null]];
+            }
+            *value = (tag == DIBinaryTagSet) ? [NSSet setWithArray:items] : [items copy];
+            return YES;
+        }
+            
+        case DIBinaryTagDictionary: {
+            NSUInteger count;
+            if (!DIBinaryReadCount(reader, &count)) {
+                return NO;
+            }
+            NSMutableDictionary *items = [NSMutableDictionary dictionaryWithCapacity:count];
+            for (NSUInteger i = 0; i < count; i++) {
+                id key;
+                id item;
+                if (!DIBinaryReadValue(reader, &key, depth + 1) || !DIBinaryReadValue(reader, &item, depth + 1)) {
+                    return NO;
+                }
+                items[key ?: [NSNull null]] = item ?: [NSNull null];
+            }
+            *value = [items copy];
+            return YES;
+        }
+            
+        case DIBinaryTagObject: {
+            NSString *className = DIBinaryReadString(reader);
+            NSUInteger count;
+            if (className == nil || !DIBinaryReadCount(reader, &count)) {
+                return NO;
+            }
+            NSMutableDictionary<NSString *, id> *fields = [NSMutableDictionary dictionaryWithCapacity:count];
+            for (NSUInteger i = 0; i < count; i++) {
+                NSString *key = DIBinaryReadString(reader);
+                id item;
+                if (key == nil || !DIBinaryReadValue(reader, &item, depth + 1)) {
+                    return NO;
+                }
+                fields[key] = item;
+            }
+            
+            // Fields are read anyway to keep position, unknown classes are decoded as nil
+            Class klass = NSClassFromString(className);
+            if (![klass conformsToProtocol:@protocol(NSCoding)]) {
+                *value = nil;
+                return YES;
+            }
+            DIBinaryCoder *coder = [[DIBinaryCoder alloc] initWithFields:fields];
+            id object = [[klass alloc] initWithCoder:coder];
+            *value = [object awakeAfterUsingCoder:coder];
+            return YES;
+        }
+    }
+    
+    return NO;
+}
+
+//
+
+@implementation DIBinaryCodec
+
++ (uint8_t)formatVersion {
+    return DIBinaryCodecVersion;
+}
+
+- (NSData *)encodeObject:(id)object {
+    NSMutableData *data = [NSMutableData dataWithCapacity:64];
+    [data appendBytes:DIBinaryCodecMagic length:sizeof(DIBinaryCodecMagic)];
+    [data appendBytes:&DIBinaryCodecVersion length:1];
+    @try {
+        if (DIBinaryWriteValue(data, object, 0)) {
+            return data;
+        }
+    }
+    @catch (NSException *exception) {
+        // Class uses non-keyed coding
+    }
+    // Keyed archives are decoded too, so such values are still stored
+    return [[[DIKeyedArchiverCodec alloc] init] encodeObject:object];
+}
+
+- (id)decodeData:(NSData *)data {
+    const uint8_t *bytes = data.bytes;
+    if (data.length < sizeof(DIBinaryCodecMagic) + 1 || memcmp(bytes, DIBinaryCodecMagic, sizeof(DIBinaryCodecMagic)) != 0) {
+        return [[[DIKeyedArchiverCodec alloc] init] decodeData:data];
+    }
+    if (bytes[sizeof(DIBinaryCodecMagic)] > DIBinaryCodecVersion) {
+        return nil;
+    }
+    
+    DIBinaryReader reader = {bytes, data.length, sizeof(DIBinaryCodecMagic) + 1};
+    id value;
+    @try {
+        if (!DIBinaryReadValue(&reader, &value, 0)) {
+            return nil;
+        }
+    }
+    @catch (NSException *exception) {
+        return nil;
+    }
+    return value;
+}
+
+@end
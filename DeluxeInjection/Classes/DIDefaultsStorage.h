@@ -0,0 +1,67 @@
+//
+//  DIDefaultsStorage.h
+//  DeluxeInjection
+//
+//  Copyright (c) 2016 Anton Bukov <k06aaa@gmail.com>
+//
+//  Licensed under the MIT License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  https://opensource.org/licenses/MIT
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ *  Posted by storages other than \c NSUserDefaults after any value was changed,
+ *  object of notification is storage
+ */
+extern NSString *const DIDefaultsStorageDidChangeNotification;
+
+/**
+ *  Key-value storage of defaults properties, values are property list objects
+ */
+@protocol DIDefaultsStorage <NSObject>
+
+/**
+ *  Get stored value
+ *
+ *  @param key Key of value
+ *
+ *  @return Stored value or \c nil
+ */
+- (nullable id)objectForKey:(NSString *)key;
+
+/**
+ *  Store value
+ *
+ *  @param value Property list object or \c nil to remove value
+ *  @param key   Key of value
+ */
+- (void)setObject:(nullable id)value forKey:(NSString *)key;
+
+/**
+ *  Make all changes durable
+ *
+ *  @return \c YES on success
+ */
+- (BOOL)synchronize;
+
+@end
+
+//
+
+@interface NSUserDefaults (DIDefaultsStorage) <DIDefaultsStorage>
+
+@end
+
+NS_ASSUME_NONNULL_END
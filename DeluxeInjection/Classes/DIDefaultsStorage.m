@@ -0,0 +1,26 @@
+//
+//  DIDefaultsStorage.m
+//  DeluxeInjection
+//
+//  Copyright (c) 2016 Anton Bukov <k06aaa@gmail.com>
+//
+//  Licensed under the MIT License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  https://opensource.org/licenses/MIT
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import "DIDefaultsStorage.h"
+
+NSString *const DIDefaultsStorageDidChangeNotification = @"DIDefaultsStorageDidChangeNotification";
+
+@implementation NSUserDefaults (DIDefaultsStorage)
+
+@end
@@ -19,6 +19,8 @@
 
 #import <Foundation/Foundation.h>
 
+#import "DIScanScope.h"
+
 NS_ASSUME_NONNULL_BEGIN
 
 #pragma mark - Block types
@@ -168,6 +170,14 @@ DIGetter DIGetterIfIvarIsNil(DIGetterWithoutIvar getter);
  */
 DIGetter DIGetterIfIvarIsNilOnce(DIGetterWithoutIvar getter);
 
+/**
+ *  Works the same way as \c DIGetterIfIvarIsNil, but first concurrent calls on the same target
+ *  publish value with compare-and-swap of strong ivar or side table slot,
+ *  so all callers get the same instance and values of losers are discarded.
+ *  After value is published getter costs single acquire load of strong ivar.
+ */
+DIGetter DIGetterIfIvarIsNilAtomic(DIGetterWithoutIvar getter);
+
 /**
  *  Helper to call supers getter method
  *
@@ -188,8 +198,31 @@ id DIGetterSuperCall(id target, Class klass, SEL getter);
  */
 void DISetterSuperCall(id target, Class klass, SEL setter, id value);
 
+/**
+ *  Storage of values of injected properties without ivar, like \c @dynamic and protocol properties
+ */
+typedef NS_ENUM(NSInteger, DIAssociationStorage) {
+    /**
+     *  Store values with \c objc_setAssociatedObject, every access takes global runtime associations lock
+     */
+    DIAssociationStorageRuntime,
+    /**
+     *  Store values in sharded side table, accesses from different threads to different objects rarely wait for each other
+     */
+    DIAssociationStorageSideTable,
+};
+
 #pragma mark - Main injection class
 
+/**
+ *  Opaque state of all injections, accessor changes are journaled while any checkpoint is alive
+ */
+@interface DIInjectionCheckpoint : NSObject
+
+@end
+
+//
+
 @interface DeluxeInjection : NSObject
 
 /**
@@ -225,6 +258,80 @@ void DISetterSuperCall(id target, Class klass, SEL setter, id value);
  */
 + (NSArray<NSString *> *)injectedSelectorsForClass:(Class)klass;
 
+/**
+ *  Scope of classes enumerated by all injections and rejections of all plugins,
+ *  should be set before first injection
+ *
+ *  @return Current scope, \c [DIScanScope \c defaultScope] by default
+ */
++ (DIScanScope *)scanScope;
+
+/**
+ *  Restrict classes enumerated by all plugins to some images and class name prefixes,
+ *  already injected properties out of new scope are not rejected
+ *
+ *  @param scanScope New scope or \c nil to reset to \c [DIScanScope \c defaultScope]
+ */
++ (void)setScanScope:(nullable DIScanScope *)scanScope;
+
+/**
+ *  Path of file keeping discovered properties between launches
+ *
+ *  @return Current path, \c nil by default
+ */
++ (nullable NSString *)indexCachePath;
+
+/**
+ *  Keep discovered marked properties in file, next launch with same images will read them
+ *  from file instead of runtime scan, should be set before first injection
+ *
+ *  @param path Path of cache file or \c nil to not use cache
+ */
++ (void)setIndexCachePath:(nullable NSString *)path;
+
+/**
+ *  Remember current state of injections to roll back to it with \c restoreCheckpoint:,
+ *  useful in \c setUp and \c tearDown of tests instead of rejecting every plugin: \code
+ *- (void)setUp {
+ *    [super setUp];
+ *    self.checkpoint = [DeluxeInjection checkpoint];
+ *}
+ *
+ *- (void)tearDown {
+ *    [DeluxeInjection restoreCheckpoint:self.checkpoint];
+ *    [super tearDown];
+ *}
+ *\endcode
+ *
+ *  @return Checkpoint, journaling stops when all checkpoints are deallocated
+ */
++ (DIInjectionCheckpoint *)checkpoint;
+
+/**
+ *  Roll back all accessor changes made after checkpoint in single batch, cost is proportional
+ *  to number of changes. Values of properties injected after checkpoint are dropped.
+ *  Newer checkpoints become invalid after restoring older one.
+ *
+ *  @param checkpoint Checkpoint taken with \c checkpoint method
+ */
++ (void)restoreCheckpoint:(DIInjectionCheckpoint *)checkpoint;
+
+/**
+ *  Collect injections and rejections made by any plugins inside block and apply them
+ *  after block returns with single enumeration of properties, every property is passed
+ *  to all matching injections and rejections in order they were called: \code
+ *[DeluxeInjection injectPlan:^{
+ *    [DeluxeInjection injectLazy];
+ *    [DeluxeInjection injectDefaults];
+ *    [DeluxeInjection injectAssociate];
+ *}];
+ *\endcode
+ *  Nested calls join outer plan, calls made on other threads are not collected.
+ *
+ *  @param block Block calling plugin injections and rejections
+ */
++ (void)injectPlan:(void (^)(void))block;
+
 /**
  *  Overriden \c debugDescription method to see tree of classes and injected properties
  *
@@ -18,10 +18,19 @@
 //
 
 #import <objc/message.h>
+#import <pthread.h>
+#import <stdatomic.h>
 
 #import <RuntimeRoutines/RuntimeRoutines.h>
 
 #import "DIDeluxeInjection.h"
+#import "DIDeluxeInjectionPlugin.h"
+#import "DIPrewarmPlugin.h"
+#import "DIPropertyIndex.h"
+#import "DIRegistry.h"
+#import "DISideTable.h"
+#import "DIStatsPlugin.h"
+#import "DITracePlugin.h"
 
 //
 
@@ -29,98 +38,481 @@ static void *DINothingToRestore = &DINothingToRestore;
 
 //
 
-static NSMutableDictionary<Class, NSMutableDictionary<NSString *, NSValue *> *> *injectionsGettersBackup;
-static NSMutableDictionary<Class, NSMutableDictionary<NSString *, NSValue *> *> *injectionsSettersBackup;
+static NSString *DITraceProtocolsName(NSArray<Protocol *> *protocols) {
+    if (protocols == nil) {
+        return @"*";
+    }
+    NSMutableArray<NSString *> *names = [NSMutableArray arrayWithCapacity:protocols.count];
+    for (Protocol *protocol in protocols) {
+        [names addObject:NSStringFromProtocol(protocol)];
+    }
+    return [names componentsJoinedByString:@","];
+}
 
-static IMP DIInjectionsBackupRead(NSMutableDictionary<Class, NSMutableDictionary<NSString *, NSValue *> *> *__strong *backup, Class class, SEL selector) {
-    NSValue *value = (*backup)[class][NSStringFromSelector(selector)];
-    return value.pointerValue;
+static NSDictionary<NSString *, id> *DITraceAccessorArgs(Class klass, SEL selector) {
+    return @{ @"class" : NSStringFromClass(klass), @"selector" : NSStringFromSelector(selector) };
 }
 
-static BOOL DIInjectionsBackupWrite(NSMutableDictionary<Class, NSMutableDictionary<NSString *, NSValue *> *> *__strong *backup, Class class, SEL selector, IMP imp) {
-    NSString *selectorKey = NSStringFromSelector(selector);
-    if (!!(*backup)[class][selectorKey] != !!imp) {
-        if (imp) {
-            if (*backup == nil) {
-                *backup = [NSMutableDictionary dictionary];
-            }
-            
-            if ((*backup)[class] == nil) {
-                (*backup)[(id) class] = [NSMutableDictionary dictionary];
-            }
+//
 
-            (*backup)[class][selectorKey] = [NSValue valueWithPointer:imp];
-        }
-        else {
-            [(*backup)[class] removeObjectForKey:selectorKey];
-            if ((*backup)[class].count == 0) {
-                [(*backup) removeObjectForKey:class];
-            }
-            if ((*backup).count == 0) {
-                *backup = nil;
-            }
-        }
-        return YES;
-    }
-    
-    return NO;
+static DIRegistry *DIInjectionsGettersBackup() {
+    static DIRegistry *registry;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        registry = DIRegistryCreate();
+    });
+    return registry;
+}
+
+static DIRegistry *DIInjectionsSettersBackup() {
+    static DIRegistry *registry;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        registry = DIRegistryCreate();
+    });
+    return registry;
+}
+
+static pthread_mutex_t *DIInjectionsMutex() {
+    static pthread_mutex_t mutex;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        pthread_mutexattr_t attributes;
+        pthread_mutexattr_init(&attributes);
+        pthread_mutexattr_settype(&attributes, PTHREAD_MUTEX_RECURSIVE);
+        pthread_mutex_init(&mutex, &attributes);
+        pthread_mutexattr_destroy(&attributes);
+    });
+    return &mutex;
+}
+
+static IMP DIInjectionsBackupRead(DIRegistry *backup, Class class, SEL selector) {
+    return (IMP)DIRegistryGet(backup, class, selector);
+}
+
+static BOOL DIInjectionsBackupWrite(DIRegistry *backup, Class class, SEL selector, IMP imp) {
+    __block BOOL changed = NO;
+    DIRegistryUpdate(backup, class, selector, ^void *(void *value) {
+        changed = (!!value != !!imp);
+        return changed ? (void *)imp : value;
+    });
+    return changed;
+}
+
+static void DIInjectionsBackupSet(DIRegistry *backup, Class class, SEL selector, IMP imp) {
+    DIRegistryUpdate(backup, class, selector, ^void *(void *value) {
+        return (void *)imp;
+    });
 }
 
 static IMP DIInjectionsGettersBackupRead(Class class, SEL selector) {
-    return DIInjectionsBackupRead(&injectionsGettersBackup, class, selector);
+    return DIInjectionsBackupRead(DIInjectionsGettersBackup(), class, selector);
 }
 
 static BOOL DIInjectionsGettersBackupWrite(Class class, SEL selector, IMP imp) {
-    return DIInjectionsBackupWrite(&injectionsGettersBackup, class, selector, imp);
+    return DIInjectionsBackupWrite(DIInjectionsGettersBackup(), class, selector, imp);
 }
 
 static IMP DIInjectionsSettersBackupRead(Class class, SEL selector) {
-    return DIInjectionsBackupRead(&injectionsSettersBackup, class, selector);
+    return DIInjectionsBackupRead(DIInjectionsSettersBackup(), class, selector);
 }
 
 static BOOL DIInjectionsSettersBackupWrite(Class class, SEL selector, IMP imp) {
-    return DIInjectionsBackupWrite(&injectionsSettersBackup, class, selector, imp);
+    return DIInjectionsBackupWrite(DIInjectionsSettersBackup(), class, selector, imp);
 }
 
 //
 
-static NSMutableDictionary<Class, NSMutableDictionary<NSString *, NSHashTable *> *> *associates;
-static NSMutableDictionary<Class, NSMutableDictionary<NSString *, NSHashTable *> *> *associatesUnsafe;
+/**
+ *  Objects having associated values of single property, entries are never removed from registry,
+ *  since injected getters may read them concurrently, they are only cleared on rejection
+ */
+@interface DIAssociatesEntry : NSObject {
+@public
+    pthread_mutex_t mutex;
+    BOOL active;
+    NSHashTable *objects;
+    NSHashTable *objectsUnsafe;
+}
+
+@end
+
+@implementation DIAssociatesEntry
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        pthread_mutex_init(&mutex, NULL);
+    }
+    return self;
+}
+
+@end
+
+static DIRegistry *DIAssociates() {
+    static DIRegistry *registry;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        registry = DIRegistryCreate();
+    });
+    return registry;
+}
+
+static DIAssociatesEntry *DIAssociatesEntryGet(Class class, SEL getter, BOOL create) {
+    DIAssociatesEntry *entry = (__bridge DIAssociatesEntry *)DIRegistryGet(DIAssociates(), class, getter);
+    if (entry || !create) {
+        return entry;
+    }
+    return (__bridge DIAssociatesEntry *)DIRegistryUpdate(DIAssociates(), class, getter, ^void *(void *value) {
+        return value ?: (__bridge_retained void *)[[DIAssociatesEntry alloc] init];
+    });
+}
 
 static NSArray *DIAssociatesRead(Class class, SEL getter) {
-    NSHashTable *hashTable = associates[class][NSStringFromSelector(getter)];
-    return hashTable.allObjects;
+    DIAssociatesEntry *entry = DIAssociatesEntryGet(class, getter, NO);
+    if (entry == nil) {
+        return nil;
+    }
+    pthread_mutex_lock(&entry->mutex);
+    NSArray *objects = entry->active ? entry->objects.allObjects : nil;
+    pthread_mutex_unlock(&entry->mutex);
+    return objects;
 }
 
 static void DIAssociatesWrite(Class class, SEL getter, id object) {
-    if (associates == nil) {
-        associates = [NSMutableDictionary dictionary];
-        associatesUnsafe = [NSMutableDictionary dictionary];
+    DIAssociatesEntry *entry = DIAssociatesEntryGet(class, getter, YES);
+    pthread_mutex_lock(&entry->mutex);
+    if (!entry->active) {
+        entry->active = YES;
+        entry->objects = [NSHashTable hashTableWithOptions:NSPointerFunctionsWeakMemory | NSPointerFunctionsOpaquePersonality];
+        entry->objectsUnsafe = [NSHashTable hashTableWithOptions:NSPointerFunctionsOpaqueMemory | NSPointerFunctionsOpaquePersonality];
+    }
+    if (object) {
+        if (![entry->objectsUnsafe containsObject:object]) {
+            [entry->objects addObject:object];
+            [entry->objectsUnsafe addObject:object];
+        }
     }
+    pthread_mutex_unlock(&entry->mutex);
+}
 
-    if (associates[(id) class] == nil) {
-        associates[(id) class] = [NSMutableDictionary dictionary];
-        associatesUnsafe[(id) class] = [NSMutableDictionary dictionary];
+static void DIAssociatesRemove(Class class, SEL getter) {
+    DIAssociatesEntry *entry = DIAssociatesEntryGet(class, getter, NO);
+    if (entry == nil) {
+        return;
     }
+    pthread_mutex_lock(&entry->mutex);
+    entry->active = NO;
+    entry->objects = nil;
+    entry->objectsUnsafe = nil;
+    pthread_mutex_unlock(&entry->mutex);
+}
+
+//
+
+/**
+ *  Single accessor change made while some checkpoint is alive
+ */
+@interface DIJournalEntry : NSObject
 
-    NSString *selectorKey = NSStringFromSelector(getter);
-    if (associates[class][selectorKey] == nil) {
-        associates[class][selectorKey] = [NSHashTable hashTableWithOptions:NSPointerFunctionsWeakMemory | NSPointerFunctionsOpaquePersonality];
-        associatesUnsafe[class][selectorKey] = [NSHashTable hashTableWithOptions:NSPointerFunctionsOpaqueMemory | NSPointerFunctionsOpaquePersonality];
+@property (strong, nonatomic) DIPropertyDescriptor *descriptor;
+@property (assign, nonatomic) BOOL setter;
+@property (assign, nonatomic) IMP previousImp;
+@property (assign, nonatomic) IMP previousBackup;
+
+@end
+
+@implementation DIJournalEntry
+
+@end
+
+static NSMutableArray<DIJournalEntry *> *DIJournal;
+static NSUInteger DIJournalCheckpointsCount;
+
+/**
+ *  Remember accessor change to be able to roll it back, should be called under \c DIInjectionsMutex().
+ *  Block implementations replaced by changes are never removed with \c imp_removeBlock(),
+ *  since other threads may still execute them or keep them in method caches.
+ *
+ *  @param descriptor     Property of changed accessor
+ *  @param setter         \c YES for setter change
+ *  @param previousImp    Implementation replaced in class or \c NULL if class had no own method
+ *  @param previousBackup Backup of original implementation before change
+ */
+static void DIJournalRecord(DIPropertyDescriptor *descriptor, BOOL setter, IMP previousImp, IMP previousBackup) {
+    if (DIJournalCheckpointsCount == 0) {
+        return;
     }
 
-    if (object) {
-        if (![associatesUnsafe[class][selectorKey] containsObject:object]) {
-            [associates[class][selectorKey] addObject:object];
-            [associatesUnsafe[class][selectorKey] addObject:object];
+    DIJournalEntry *entry = [[DIJournalEntry alloc] init];
+    entry.descriptor = descriptor;
+    entry.setter = setter;
+    entry.previousImp = previousImp;
+    entry.previousBackup = previousBackup;
+    [DIJournal addObject:entry];
+}
+
+static void DIAssociationsClear(DIPropertyDescriptor *descriptor) {
+    Class class = descriptor.targetClass;
+    SEL getter = descriptor.getter;
+    NSArray *associated = DIAssociatesRead(class, getter);
+    if (associated) {
+        SEL associationKey = NSSelectorFromString([@"DI_" stringByAppendingString:descriptor.propertyName]);
+        DIPropertyAttributes attributes = descriptor.attributes;
+        objc_AssociationPolicy associationPolicy = DIPropertyAttributesGetAssociationPolicy(&attributes);
+        for (id object in associated) {
+            objc_setAssociatedObject(object, associationKey, nil, associationPolicy);
+            DISideTableSet(object, associationKey, nil, associationPolicy);
         }
+        DIAssociatesRemove(class, getter);
     }
 }
 
-static void DIAssociatesRemove(Class class, SEL getter) {
-    NSString *selectorKey = NSStringFromSelector(getter);
-    [associates[class] removeObjectForKey:selectorKey];
-    [associatesUnsafe[class] removeObjectForKey:selectorKey];
+//
+
+@interface DIInjectionCheckpoint ()
+
+@property (assign, nonatomic) NSUInteger journalPosition;
+@property (copy, nonatomic) NSArray *rules;
+@property (assign, nonatomic) BOOL restored;
+
+@end
+
+@implementation DIInjectionCheckpoint
+
+- (void)dealloc {
+    pthread_mutex_lock(DIInjectionsMutex());
+    // Last checkpoint finishes journaling
+    if (--DIJournalCheckpointsCount == 0) {
+        DIJournal = nil;
+    }
+    pthread_mutex_unlock(DIInjectionsMutex());
+}
+
+@end
+
+//
+
+typedef NS_ENUM(NSInteger, DIAccessorShapeKind) {
+    DIAccessorShapeKindIvar,
+    DIAccessorShapeKindIvarIfNilValue,
+    DIAccessorShapeKindIvarIfNilBlock,
+    DIAccessorShapeKindIvarIfNilAtomic,
+};
+
+/**
+ *  Describes behavior of common getters and setters to inject them without calling blocks on every access
+ */
+@interface DIAccessorShape : NSObject
+
+@property (assign, nonatomic) DIAccessorShapeKind kind;
+@property (strong, nonatomic, nullable) id value;
+@property (copy, nonatomic, nullable) DIGetterWithoutIvar getter;
+
+@end
+
+@implementation DIAccessorShape
+
+@end
+
+static void *DIAccessorShapeKey = &DIAccessorShapeKey;
+
+static id DIAccessorShapeSet(id block, DIAccessorShapeKind kind, id value, DIGetterWithoutIvar getter) {
+    DIAccessorShape *shape = [[DIAccessorShape alloc] init];
+    shape.kind = kind;
+    shape.value = value;
+    shape.getter = getter;
+    objc_setAssociatedObject(block, DIAccessorShapeKey, shape, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    return block;
+}
+
+static DIAccessorShape *DIAccessorShapeGet(id block) {
+    return block ? objc_getAssociatedObject(block, DIAccessorShapeKey) : nil;
+}
+
+typedef NS_ENUM(NSInteger, DIIvarOwnership) {
+    DIIvarOwnershipStrong,
+    DIIvarOwnershipWeak,
+    DIIvarOwnershipUnsafeUnretained,
+};
+
+/**
+ *  Check whether ivar layout scans word at offset, layouts are series of skip and scan counts of words
+ */
+static BOOL DIIvarLayoutContains(const uint8_t *layout, ptrdiff_t offset) {
+    if (layout == NULL) {
+        return NO;
+    }
+    ptrdiff_t index = 0;
+    ptrdiff_t ivarIndex = offset / (ptrdiff_t)sizeof(void *);
+    for (uint8_t byte = *layout; byte; byte = *++layout) {
+        index += (byte >> 4);
+        if (index > ivarIndex) {
+            return NO;
+        }
+        index += (byte & 0x0F);
+        if (index > ivarIndex) {
+            return YES;
+        }
+    }
+    return NO;
+}
+
+/**
+ *  Ownership of ivar from layouts of class declaring it, the same way \c object_setIvar finds it.
+ *  Property attributes can not be used: readonly properties have no ownership attributes by default.
+ */
+static DIIvarOwnership DIIvarGetOwnership(Class klass, Ivar ivar) {
+    const char *ivarName = ivar_getName(ivar);
+    Class ownerClass = klass;
+    for (Class superclass = class_getSuperclass(klass); superclass && class_getInstanceVariable(superclass, ivarName) == ivar; superclass = class_getSuperclass(superclass)) {
+        ownerClass = superclass;
+    }
+    
+    ptrdiff_t offset = ivar_getOffset(ivar);
+    if (DIIvarLayoutContains(class_getIvarLayout(ownerClass), offset)) {
+        return DIIvarOwnershipStrong;
+    }
+    if (DIIvarLayoutContains(class_getWeakIvarLayout(ownerClass), offset)) {
+        return DIIvarOwnershipWeak;
+    }
+    return DIIvarOwnershipUnsafeUnretained;
+}
+
+static inline id DIIvarLoad(id target, ptrdiff_t offset, DIIvarOwnership ownership) {
+    void *slot = (uint8_t *)(__bridge void *)target + offset;
+    switch (ownership) {
+        case DIIvarOwnershipStrong:
+            return *(__strong id *)slot;
+        case DIIvarOwnershipWeak:
+            return *(__weak id *)slot;
+        case DIIvarOwnershipUnsafeUnretained:
+            return *(__unsafe_unretained id *)slot;
+    }
+    return nil;
+}
+
+static inline void DIIvarStore(id target, ptrdiff_t offset, DIIvarOwnership ownership, id value) {
+    void *slot = (uint8_t *)(__bridge void *)target + offset;
+    switch (ownership) {
+        case DIIvarOwnershipStrong:
+            *(__strong id *)slot = value;
+            break;
+        case DIIvarOwnershipWeak:
+            *(__weak id *)slot = value;
+            break;
+        case DIIvarOwnershipUnsafeUnretained:
+            *(__unsafe_unretained id *)slot = value;
+            break;
+    }
+}
+
+static id (^DIShapedGetterBlock(DIAccessorShape *shape, SEL getter, Ivar ivar, DIIvarOwnership ownership))(id) {
+    ptrdiff_t offset = ivar_getOffset(ivar);
+    switch (shape.kind) {
+        case DIAccessorShapeKindIvar:
+            return ^id(id target) {
+                return DIIvarLoad(target, offset, ownership);
+            };
+        case DIAccessorShapeKindIvarIfNilValue: {
+            id value = shape.value;
+            return ^id(id target) {
+                id result = DIIvarLoad(target, offset, ownership);
+                if (result == nil) {
+                    DIStatsNoteSlowPath();
+                    result = value;
+                    DIIvarStore(target, offset, ownership, result);
+                }
+                return result;
+            };
+        }
+        case DIAccessorShapeKindIvarIfNilBlock: {
+            DIGetterWithoutIvar valueGetter = shape.getter;
+            return ^id(id target) {
+                id result = DIIvarLoad(target, offset, ownership);
+                if (result == nil) {
+                    DIStatsNoteSlowPath();
+                    uint64_t traceStart = DITraceBegin();
+                    result = valueGetter(target, getter);
+                    if (traceStart) {
+                        DITraceEnd(traceStart, "lazy", @"provider", DITraceAccessorArgs(object_getClass(target), getter));
+                    }
+                    DIIvarStore(target, offset, ownership, result);
+                }
+                return result;
+            };
+        }
+        case DIAccessorShapeKindIvarIfNilAtomic:
+            return nil; // Needs original getter block, see DIAtomicIvarGetterBlock
+    }
+    return nil;
+}
+
+/**
+ *  Getter publishing value initialized by \c getterBlock into strong ivar with compare-and-swap,
+ *  value of thread losing the race is released and winning value is returned
+ */
+static id (^DIAtomicIvarGetterBlock(DIGetter getterBlock, SEL getter, Ivar ivar, DIOriginalGetter originalGetter))(id) {
+    ptrdiff_t offset = ivar_getOffset(ivar);
+    return ^id(id target) {
+        _Atomic(void *) *slot = (_Atomic(void *) *)((uint8_t *)(__bridge void *)target + offset);
+        void *current = atomic_load_explicit(slot, memory_order_acquire);
+        if (current) {
+            return (__bridge id)current;
+        }
+        
+        DIStatsNoteSlowPath();
+        id value = nil;
+        getterBlock(target, getter, &value, originalGetter);
+        if (value == nil) {
+            return nil;
+        }
+        void *retainedValue = (__bridge_retained void *)value;
+        if (atomic_compare_exchange_strong_explicit(slot, &current, retainedValue, memory_order_acq_rel, memory_order_acquire)) {
+            return value;
+        }
+        CFRelease(retainedValue);
+        return (__bridge id)current;
+    };
+}
+
+/**
+ *  Getter publishing value initialized by \c getterBlock into side table slot only if slot is still empty
+ */
+static id (^DIAtomicSideTableGetterBlock(DIGetter getterBlock, Class klass, SEL getter, SEL associationKey, objc_AssociationPolicy associationPolicy, DIOriginalGetter originalGetter))(id) {
+    return ^id(id target) {
+        id current = DISideTableGet(target, associationKey);
+        if (current) {
+            return current;
+        }
+        
+        DIStatsNoteSlowPath();
+        id value = nil;
+        getterBlock(target, getter, &value, originalGetter);
+        if (value == nil) {
+            return nil;
+        }
+        current = DISideTableSetIfNil(target, associationKey, value, associationPolicy);
+        if (current == value) {
+            DIAssociatesWrite(klass, getter, target);
+        }
+        return current;
+    };
+}
+
+/**
+ *  Setter assigning value to ivar directly, \c copy properties store copy of value like synthesized setter does
+ */
+static void (^DIShapedSetterBlock(Ivar ivar, DIIvarOwnership ownership, BOOL copy))(id, id) {
+    ptrdiff_t offset = ivar_getOffset(ivar);
+    if (copy) {
+        return ^void(id target, id newValue) {
+            DIIvarStore(target, offset, ownership, [newValue copy]);
+        };
+    }
+    return ^void(id target, id newValue) {
+        DIIvarStore(target, offset, ownership, newValue);
+    };
 }
 
 //
@@ -146,28 +538,99 @@ DISetter DISetterWithOriginalMake(DISetter setter) {
 }
 
 DIGetter DIGetterIfIvarIsNil(DIGetterWithoutIvar getter) {
-    return DIGetterWithOriginalMake(^id _Nullable(id  _Nonnull target, SEL cmd, id  _Nullable __autoreleasing * _Nonnull ivar, id  _Nullable (* _Nullable originalGetter)(id  _Nonnull __strong, SEL _Nonnull)) {
+    DIGetter block = DIGetterWithOriginalMake(^id _Nullable(id  _Nonnull target, SEL cmd, id  _Nullable __autoreleasing * _Nonnull ivar, id  _Nullable (* _Nullable originalGetter)(id  _Nonnull __strong, SEL _Nonnull)) {
+        if (*ivar == nil) {
+            DIStatsNoteSlowPath();
+            uint64_t traceStart = DITraceBegin();
+            *ivar = getter(target, cmd);
+            if (traceStart) {
+                DITraceEnd(traceStart, "lazy", @"provider", DITraceAccessorArgs(object_getClass(target), cmd));
+            }
+        }
+        return *ivar;
+    });
+    return DIAccessorShapeSet(block, DIAccessorShapeKindIvarIfNilBlock, nil, getter);
+}
+
+DIGetter DIGetterIfIvarIsNilWithValue(id value) {
+    DIGetter block = DIGetterWithOriginalMake(^id _Nullable(id  _Nonnull target, SEL cmd, id  _Nullable __autoreleasing * _Nonnull ivar, id  _Nullable (* _Nullable originalGetter)(id  _Nonnull __strong, SEL _Nonnull)) {
+        if (*ivar == nil) {
+            DIStatsNoteSlowPath();
+            *ivar = value;
+        }
+        return *ivar;
+    });
+    return DIAccessorShapeSet(block, DIAccessorShapeKindIvarIfNilValue, value, nil);
+}
+
+DIGetter DIGetterIfIvarIsNilAtomic(DIGetterWithoutIvar getter) {
+    return DIBlockCopyIfNilAtomic(^id _Nullable(id  _Nonnull target, SEL cmd, id  _Nullable __autoreleasing * _Nonnull ivar, id  _Nullable (* _Nullable originalGetter)(id  _Nonnull __strong, SEL _Nonnull)) {
         if (*ivar == nil) {
+            DIStatsNoteSlowPath();
+            uint64_t traceStart = DITraceBegin();
             *ivar = getter(target, cmd);
+            if (traceStart) {
+                DITraceEnd(traceStart, "lazy", @"provider", DITraceAccessorArgs(object_getClass(target), cmd));
+            }
         }
         return *ivar;
     });
 }
 
+DIGetter DIGetterIvar(void) {
+    DIGetter block = DIGetterMake(^id _Nullable(id target, SEL cmd, id *ivar) {
+        return *ivar;
+    });
+    return DIAccessorShapeSet(block, DIAccessorShapeKindIvar, nil, nil);
+}
+
+DISetter DISetterIvar(void) {
+    DISetter block = DISetterMake(^(id target, SEL cmd, id *ivar, id value) {
+        *ivar = value;
+    });
+    return DIAccessorShapeSet(block, DIAccessorShapeKindIvar, nil, nil);
+}
+
+id DIBlockCopyShape(id block, id sourceBlock) {
+    id copiedBlock = [block copy];
+    DIAccessorShape *shape = DIAccessorShapeGet(sourceBlock);
+    if (shape) {
+        objc_setAssociatedObject(copiedBlock, DIAccessorShapeKey, shape, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    }
+    return copiedBlock;
+}
+
+id DIBlockCopyIfNilAtomic(id block) {
+    return DIAccessorShapeSet([block copy], DIAccessorShapeKindIvarIfNilAtomic, nil, nil);
+}
+
+static _Atomic(uintptr_t) DIOnceTokensCount = 0;
+
+/**
+ *  Side table key for pair of injection token and selector. Keys are odd, so they never
+ *  collide with selectors and pointers used as keys of associated values.
+ */
+static const void *DIOnceKey(uintptr_t token, SEL cmd) {
+    uint64_t hash = (uint64_t)(uintptr_t)cmd * 0x9E3779B97F4A7C15ull ^ (uint64_t)token * 0xC2B2AE3D27D4EB4Full;
+    hash ^= hash >> 29;
+    return (const void *)((uintptr_t)hash | 1);
+}
+
 DIGetter DIGetterIfIvarIsNilOnce(DIGetterWithoutIvar getter) {
-    __block NSMapTable *targets = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsOpaqueMemory | NSPointerFunctionsOpaquePersonality valueOptions:NSPointerFunctionsStrongMemory];
+    // Flags are kept in side table of target, so they are freed when target deallocates,
+    // tokens are never reused, so flags of previous injections do not match new ones
+    uintptr_t token = atomic_fetch_add(&DIOnceTokensCount, 1) + 1;
     return DIGetterWithOriginalMake(^id _Nullable(id  _Nonnull target, SEL cmd, id  _Nullable __autoreleasing * _Nonnull ivar, id  _Nullable (* _Nullable originalGetter)(id  _Nonnull __strong, SEL _Nonnull)) {
         if (*ivar == nil) {
-            NSMutableSet *cmds = [targets objectForKey:target];
-            if (cmds == nil) {
-                cmds = [NSMutableSet set];
-                [targets setObject:cmds forKey:target];
-            }
-            
-            NSString *cmdStr = NSStringFromSelector(cmd);
-            if (![cmds containsObject:cmdStr]) {
+            const void *key = DIOnceKey(token, cmd);
+            if (DISideTableGet(target, key) == nil) {
+                DIStatsNoteSlowPath();
+                uint64_t traceStart = DITraceBegin();
                 *ivar = getter(target, cmd);
-                [cmds addObject:cmdStr];
+                if (traceStart) {
+                    DITraceEnd(traceStart, "lazy", @"provider", DITraceAccessorArgs(object_getClass(target), cmd));
+                }
+                DISideTableSet(target, key, (__bridge id)kCFBooleanTrue, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
             }
         }
         return *ivar;
@@ -211,14 +674,148 @@ void DISetterSuperCall(id target, Class class, SEL setter, id value) {
 
 //
 
+@interface DIInjectionRule : NSObject
+
+@property (copy, nonatomic) NSArray<Protocol *> *protocols;
+@property (copy, nonatomic) DIPropertyBlock injectBlock;
+@property (copy, nonatomic) DIPropertyFilter rejectBlock;
+@property (assign, nonatomic) DIAssociationStorage storage;
+@property (strong, nonatomic) NSMutableArray<DIPropertyDescriptor *> *injected;
+
+@end
+
+@implementation DIInjectionRule
+
+@end
+
+static id DIInjectionRulesLock() {
+    static id lock;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        lock = [NSObject new];
+    });
+    return lock;
+}
+
+static NSMutableArray<DIInjectionRule *> *DIInjectionRules() {
+    static NSMutableArray<DIInjectionRule *> *rules;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        rules = [NSMutableArray array];
+    });
+    return rules;
+}
+
+static BOOL DIProtocolsEqual(NSArray<Protocol *> *protocols, NSArray<Protocol *> *otherProtocols) {
+    if (protocols == nil || otherProtocols == nil) {
+        return protocols == otherProtocols;
+    }
+    return [[NSSet setWithArray:protocols] isEqualToSet:[NSSet setWithArray:otherProtocols]];
+}
+
+static BOOL DIProtocolsCover(NSArray<Protocol *> *protocols, NSArray<Protocol *> *otherProtocols) {
+    if (protocols == nil) {
+        return YES;
+    }
+    if (otherProtocols == nil) {
+        return NO;
+    }
+    return [[NSSet setWithArray:otherProtocols] isSubsetOfSet:[NSSet setWithArray:protocols]];
+}
+
+static BOOL DIProtocolsIntersect(NSArray<Protocol *> *protocols, NSArray<Protocol *> *otherProtocols) {
+    if (protocols == nil || otherProtocols == nil) {
+        return YES;
+    }
+    return [[NSSet setWithArray:otherProtocols] intersectsSet:[NSSet setWithArray:protocols]];
+}
+
+/**
+ *  Deferred injection or rejection collected while running \c injectPlan: block
+ */
+@interface DIInjectionPlanStep : NSObject
+
+@property (copy, nonatomic) DIPropertyBlock injectBlock;
+@property (copy, nonatomic) DIPropertyFilter rejectBlock;
+@property (copy, nonatomic) NSArray<Protocol *> *protocols;
+@property (strong, nonatomic) NSSet<Protocol *> *protocolsSet;
+@property (assign, nonatomic) DIAssociationStorage storage;
+@property (strong, nonatomic) NSMutableArray<DIPropertyDescriptor *> *injected;
+
+@end
+
+@implementation DIInjectionPlanStep
+
+- (instancetype)initWithInjectBlock:(DIPropertyBlock)injectBlock rejectBlock:(DIPropertyFilter)rejectBlock protocols:(NSArray<Protocol *> *)protocols storage:(DIAssociationStorage)storage {
+    self = [super init];
+    if (self) {
+        _injectBlock = injectBlock;
+        _rejectBlock = rejectBlock;
+        _protocols = [protocols copy];
+        _protocolsSet = protocols ? [NSSet setWithArray:protocols] : nil;
+        _storage = storage;
+        _injected = [NSMutableArray array];
+    }
+    return self;
+}
+
+@end
+
+static NSString *const DIInjectionPlanThreadKey = @"DIInjectionPlan";
+
+static NSMutableArray<DIInjectionPlanStep *> *DIInjectionPlanCurrent() {
+    return [NSThread currentThread].threadDictionary[DIInjectionPlanThreadKey];
+}
+
+/**
+ *  Newer injection over the same protocols which injected every property injected by older one
+ *  replaces it, so repeating the same injection does not grow list of rules
+ */
+static BOOL DIInjectionRuleSupersedes(DIInjectionRule *rule, DIInjectionRule *existingRule, NSSet<NSValue *> *injectedProperties) {
+    if (!existingRule.injectBlock || !DIProtocolsEqual(rule.protocols, existingRule.protocols)) {
+        return NO;
+    }
+    for (DIPropertyDescriptor *descriptor in existingRule.injected) {
+        if (![injectedProperties containsObject:[NSValue valueWithPointer:descriptor.property]]) {
+            return NO;
+        }
+    }
+    return YES;
+}
+
+static BOOL DIInjectionRuleHasInjected(DIInjectionRule *rule) {
+    for (DIPropertyDescriptor *descriptor in rule.injected) {
+        if (DIInjectionsGettersBackupRead(descriptor.targetClass, descriptor.getter) ||
+            DIInjectionsSettersBackupRead(descriptor.targetClass, descriptor.setter)) {
+            return YES;
+        }
+    }
+    return NO;
+}
+
+//
+
 @interface DeluxeInjection ()
 
 @property (strong, nonatomic) id exampleProperty;
 
++ (void)applyRulesToImageIndex:(DIPropertyIndex *)imageIndex;
+
 @end
 
 @implementation DeluxeInjection
 
++ (void)initialize {
+    if (self != [DeluxeInjection class]) {
+        return;
+    }
+
+    // Active rules are applied to classes of images loaded later
+    [DIPropertyIndex sharedIndex].didIndexImageBlock = ^(DIPropertyIndex *imageIndex) {
+        [DeluxeInjection applyRulesToImageIndex:imageIndex];
+    };
+}
+
 #pragma mark - Sample getter and setter
 
 IMP EmptyMethodImp(){
@@ -232,358 +829,481 @@ IMP EmptyMethodImp(){
 
 #pragma mark - Private
 
-+ (void)enumerateAllClassProperties:(void (^)(Class class, objc_property_t property))block conformingProtocols:(NSArray<Protocol *> *)protocols {
-    NSMutableArray *protocolStrs = [NSMutableArray array];
-    for (Protocol *protocol in protocols) {
-        [protocolStrs addObject:[NSString stringWithFormat:@"<%@>", NSStringFromProtocol(protocol)]];
-    }
-    
-    RRClassEnumerateAllClasses(YES, ^(Class klass) {
-        RRClassEnumerateProperties(klass, ^(objc_property_t property) {
-            const char *type = property_getAttributes(property);
-            BOOL found = NO;
-            if (strstr(type, "<DI")) {
-                for (NSString *protoStr in protocolStrs) {
-                    if (type && strstr(type, protoStr.UTF8String)) {
-                        found = YES;
-                        break;
-                    }
-                }
-            }
-            if (!protocols || found) {
-                block(klass, property);
-            }
-        });
-    });
++ (void)enumerateAllClassProperties:(void (^)(DIPropertyDescriptor *descriptor))block conformingProtocols:(NSArray<Protocol *> *)protocols {
+    [[DIPropertyIndex sharedIndex] enumerateDescriptorsConformingProtocols:protocols usingBlock:block];
 }
 
-+ (void)inject:(Class)klass property:(objc_property_t)property getterBlock:(DIGetter)getterBlock setterBlock:(DISetter)setterBlock blockFactory:(DIPropertyBlock)blockFactory {
-    __block DIGetter getterToInject = getterBlock;
-    __block DISetter setterToInject = setterBlock;
++ (BOOL)injectDescriptor:(DIPropertyDescriptor *)descriptor getterBlock:(DIGetter)getterBlock setterBlock:(DISetter)setterBlock blockFactory:(DIPropertyBlock)blockFactory storage:(DIAssociationStorage)storage {
+    DIGetter getterToInject = getterBlock;
+    DISetter setterToInject = setterBlock;
+
+    Class klass = descriptor.targetClass;
+    SEL getter = descriptor.getter;
+    SEL setter = descriptor.setter;
+    NSString *propertyName = descriptor.propertyName;
+    if (blockFactory) {
+        NSArray *blocks = blockFactory(klass, getter, setter, propertyName, descriptor.propertyClass, descriptor.propertyProtocols);
+        NSAssert(blocks == nil || blocks == [DeluxeInjection doNotInject] ||
+                 ([blocks isKindOfClass:[NSArray class]] && blocks.count == 2),
+                 @"Provide nil, [DeluxeInjection doNotInject] or array with getter and setter blocks");
+
+        if (blocks.firstObject && blocks.firstObject != [DeluxeInjection doNotInject]) {
+            getterToInject = blocks.firstObject;
+        }
+        if (blocks.lastObject && blocks.lastObject != [DeluxeInjection doNotInject]) {
+            setterToInject = blocks.lastObject;
+        }
+        if (!getterToInject && !setterToInject) {
+            return NO;
+        }
+    }
 
-    RRPropertyGetClassAndProtocols(property, ^(Class propertyClass, NSSet<Protocol *> *propertyProtocols) {
-        SEL getter = RRPropertyGetGetter(property);
-        SEL setter = RRPropertyGetSetter(property);
+    Method getterMethod = class_getInstanceMethod(klass, getter);
+    if (getterMethod) {
+        NSAssert(RRMethodGetArgumentsCount(getterMethod) == 0,
+                 @"Getter should not have any arguments");
+        NSAssert([RRMethodGetReturnType(getterMethod) isEqualToString:@"@"],
+                 @"DeluxeInjection do not support non-object properties injections");
+    }
 
-        NSString *propertyName = [NSString stringWithUTF8String:property_getName(property)];
-        if (blockFactory) {
-            NSArray *blocks = blockFactory(klass, getter, setter, propertyName, propertyClass, propertyProtocols);
-            NSAssert(blocks == nil || blocks == [DeluxeInjection doNotInject] ||
-                     ([blocks isKindOfClass:[NSArray class]] && blocks.count == 2),
-                     @"Provide nil, [DeluxeInjection doNotInject] or array with getter and setter blocks");
+    Method setterMethod = class_getInstanceMethod(klass, setter);
+    if (setterMethod) {
+        NSAssert([RRMethodGetReturnType(setterMethod) isEqualToString:@"v"],
+                 @"Setter should return void");
+        NSAssert(RRMethodGetArgumentsCount(setterMethod) == 1,
+                 @"Setter should have exactly one argument");
+        NSAssert([RRMethodGetArgumentType(setterMethod, 0) isEqualToString:@"@"],
+                 @"DeluxeInjection do not support non-object properties injections");
+    }
+    
+    // Reading backups and replacing methods should be atomic for concurrent inject and reject
+    pthread_mutex_lock(DIInjectionsMutex());
+    DIOriginalGetter originalGetterIMP = (DIOriginalGetter)(DIInjectionsGettersBackupRead(klass, getter) ?: method_getImplementation(getterMethod));
+    DIOriginalSetter originalSetterIMP = (DIOriginalSetter)(DIInjectionsSettersBackupRead(klass, setter) ?: method_getImplementation(setterMethod));
+    if (originalGetterIMP == DINothingToRestore) {
+        originalGetterIMP = nil;
+    }
+    if (originalSetterIMP == DINothingToRestore) {
+        originalSetterIMP = nil;
+    }
+    
+    DIPropertyAttributes attributes = descriptor.attributes;
+    Ivar propertyIvar = DIPropertyAttributesGetIvar(klass, &attributes);
+    
+    BOOL haveIvar = (propertyIvar != nil);
+    BOOL originalGetterExist = class_getMethodImplementation(klass, getter) != EmptyMethodImp();
+    BOOL originalSetterExist = class_getMethodImplementation(klass, setter) != EmptyMethodImp();
+    BOOL useOriginalAccessors = (originalGetterExist && originalSetterExist);
+    if (!originalGetterExist) {
+        originalGetterIMP = nil;
+    }
+    if (!originalSetterExist) {
+        originalSetterIMP = nil;
+    }
+    BOOL isWeak = (attributes.flags & DIPropertyAttributeWeak) != 0;
+    BOOL getterAtomic = (DIAccessorShapeGet(getterToInject).kind == DIAccessorShapeKindIvarIfNilAtomic);
+    if (getterAtomic && !haveIvar && !useOriginalAccessors && !isWeak) {
+        storage = DIAssociationStorageSideTable; // Only side table slots can be published atomically
+    }
+    SEL associationKey = NSSelectorFromString([@"DI_" stringByAppendingString:propertyName]);
+    objc_AssociationPolicy associationPolicy = DIPropertyAttributesGetAssociationPolicy(&attributes);
+    id (*associationGet)(id, const void *) = (storage == DIAssociationStorageSideTable) ? DISideTableGet : objc_getAssociatedObject;
+    void (*associationSet)(id, const void *, id, objc_AssociationPolicy) = (storage == DIAssociationStorageSideTable) ? DISideTableSet : objc_setAssociatedObject;
+
+    DIIvarOwnership ivarOwnership = haveIvar ? DIIvarGetOwnership(klass, propertyIvar) : DIIvarOwnershipUnsafeUnretained;
+    DIAccessorShape *getterShape = haveIvar ? DIAccessorShapeGet(getterToInject) : nil;
+    if (getterShape.kind == DIAccessorShapeKindIvarIfNilAtomic) {
+        getterShape = nil; // Published atomically below or falls back to generic getter
+    }
+    DIAccessorShape *setterShape = haveIvar ? DIAccessorShapeGet(setterToInject) : nil;
+    if (setterShape.kind != DIAccessorShapeKindIvar) {
+        setterShape = nil; // Only plain assignment can be injected as dedicated setter
+    }
 
-            if (blocks.firstObject && blocks.firstObject != [DeluxeInjection doNotInject]) {
-                getterToInject = blocks.firstObject;
-            }
-            if (blocks.lastObject && blocks.lastObject != [DeluxeInjection doNotInject]) {
-                setterToInject = blocks.lastObject;
-            }
-            if (!getterToInject && !setterToInject) {
-                return;
-            }
-        }
+    if (getterAtomic && haveIvar && ivarOwnership != DIIvarOwnershipStrong) {
+        pthread_mutex_unlock(DIInjectionsMutex());
+        NSAssert(NO, @"Atomic getter can publish value only to strong ivar, ivar of [%@ %@] is not strong", klass, propertyName);
+        return NO;
+    }
 
-        Method getterMethod = class_getInstanceMethod(klass, getter);
-        if (getterMethod) {
-            NSAssert(RRMethodGetArgumentsCount(getterMethod) == 0,
-                     @"Getter should not have any arguments");
-            NSAssert([RRMethodGetReturnType(getterMethod) isEqualToString:@"@"],
-                     @"DeluxeInjection do not support non-object properties injections");
+    id (^newGetterBlock)(id) = nil;
+    if (getterToInject) {
+        if (getterAtomic && haveIvar) {
+            newGetterBlock = DIAtomicIvarGetterBlock(getterToInject, getter, propertyIvar, originalGetterIMP);
         }
-
-        Method setterMethod = class_getInstanceMethod(klass, setter);
-        if (setterMethod) {
-            NSAssert([RRMethodGetReturnType(setterMethod) isEqualToString:@"v"],
-                     @"Setter should return void");
-            NSAssert(RRMethodGetArgumentsCount(setterMethod) == 1,
-                     @"Setter should have exactly one argument");
-            NSAssert([RRMethodGetArgumentType(setterMethod, 0) isEqualToString:@"@"],
-                     @"DeluxeInjection do not support non-object properties injections");
+        else if (getterAtomic && !haveIvar && !useOriginalAccessors && !isWeak) {
+            newGetterBlock = DIAtomicSideTableGetterBlock(getterToInject, klass, getter, associationKey, associationPolicy, originalGetterIMP);
         }
-        
-        DIOriginalGetter originalGetterIMP = (DIOriginalGetter)(DIInjectionsGettersBackupRead(klass, getter) ?: method_getImplementation(getterMethod));
-        DIOriginalSetter originalSetterIMP = (DIOriginalSetter)(DIInjectionsSettersBackupRead(klass, setter) ?: method_getImplementation(setterMethod));
-        if (originalGetterIMP == DINothingToRestore) {
-            originalGetterIMP = nil;
+        else if (getterShape) {
+            newGetterBlock = DIShapedGetterBlock(getterShape, getter, propertyIvar, ivarOwnership);
         }
-        if (originalSetterIMP == DINothingToRestore) {
-            originalSetterIMP = nil;
+        else if (haveIvar) {
+            newGetterBlock = ^id(id target) {
+                id ivar = object_getIvar(target, propertyIvar);
+                id ivar2 = ivar;
+                id result = getterToInject(target, getter, &ivar, originalGetterIMP);
+                if (ivar != ivar2) {
+                    object_setIvar(target, propertyIvar, ivar);
+                }
+                return result;
+            };
         }
-        
-        NSString *propertyIvarStr = RRPropertyGetAttribute(property, "V");
-        Ivar propertyIvar = propertyIvarStr ? class_getInstanceVariable(klass, propertyIvarStr.UTF8String) : nil;
-        
-        BOOL haveIvar = (propertyIvar != nil);
-        BOOL originalGetterExist = class_getMethodImplementation(klass, getter) != EmptyMethodImp();
-        BOOL originalSetterExist = class_getMethodImplementation(klass, setter) != EmptyMethodImp();
-        BOOL useOriginalAccessors = (originalGetterExist && originalSetterExist);
-        if (!originalGetterExist) {
-            originalGetterIMP = nil;
-        }
-        if (!originalSetterExist) {
-            originalSetterIMP = nil;
-        }
-        SEL associationKey = NSSelectorFromString([@"DI_" stringByAppendingString:propertyName]);
-        objc_AssociationPolicy associationPolicy = RRPropertyGetAssociationPolicy(property);
-        BOOL isWeak = RRPropertyGetIsWeak(property);
-
-        id (^newGetterBlock)(id) = nil;
-        if (getterToInject) {
-            if (haveIvar) {
+        else {
+            if (isWeak) {
                 newGetterBlock = ^id(id target) {
-                    id ivar = object_getIvar(target, propertyIvar);
+                    id ivar = nil;
+                    DIWeakWrapper *wrapper = nil;
+                    BOOL wrapperWasNil = NO;
+                    if (useOriginalAccessors) {
+                        ivar = originalGetterIMP(target, getter);
+                    }
+                    else {
+                        wrapper = associationGet(target, associationKey);
+                        wrapperWasNil = (wrapper == nil);
+                        if (wrapperWasNil) {
+                            wrapper = [[DIWeakWrapper alloc] init];
+                        }
+                        ivar = ((DIWeakWrapper *)wrapper)->object;
+                    }
+                    
                     id ivar2 = ivar;
+                    BOOL ivarWasNil = (ivar == nil);
                     id result = getterToInject(target, getter, &ivar, originalGetterIMP);
-                    if (ivar != ivar2) {
-                        object_setIvar(target, propertyIvar, ivar);
+                    if (ivar && ivarWasNil) {
+                        DIAssociatesWrite(klass, getter, target);
                     }
-                    return result;
-                };
-            }
-            else {
-                if (isWeak) {
-                    newGetterBlock = ^id(id target) {
-                        id ivar = nil;
-                        DIWeakWrapper *wrapper = nil;
-                        BOOL wrapperWasNil = NO;
-                        if (useOriginalAccessors) {
-                            ivar = originalGetterIMP(target, getter);
-                        }
-                        else {
-                            wrapper = objc_getAssociatedObject(target, associationKey);
-                            wrapperWasNil = (wrapper == nil);
-                            if (wrapperWasNil) {
-                                wrapper = [[DIWeakWrapper alloc] init];
-                            }
-                            ivar = ((DIWeakWrapper *)wrapper)->object;
-                        }
-                        
-                        id ivar2 = ivar;
-                        BOOL ivarWasNil = (ivar == nil);
-                        id result = getterToInject(target, getter, &ivar, originalGetterIMP);
-                        if (ivar && ivarWasNil) {
-                            DIAssociatesWrite(klass, getter, target);
-                        }
-                        
-                        if (ivar != ivar2) {
-                            if (!useOriginalAccessors) {
-                                wrapper->object = ivar;
-                                if (wrapperWasNil) {
-                                    objc_setAssociatedObject(target, associationKey, wrapper, associationPolicy);
-                                }
-                            }
-                            if (originalSetterIMP) {
-                                originalSetterIMP(target, setter, ivar);
-                            }
-                        }
-                        return result;
-                    };
-                }
-                else {
-                    newGetterBlock = ^id(id target) {
-                        id ivar = nil;
-                        if (useOriginalAccessors) {
-                            ivar = originalGetterIMP(target, getter);
-                        }
-                        else {
-                            ivar = objc_getAssociatedObject(target, associationKey);
-                        }
-                        
-                        id ivar2 = ivar;
-                        BOOL ivarWasNil = (ivar == nil);
-                        id result = getterToInject(target, getter, &ivar, originalGetterIMP);
-                        if (ivar && ivarWasNil) {
-                            DIAssociatesWrite(klass, getter, target);
-                        }
-                        
-                        if (ivar != ivar2) {
-                            if (!useOriginalAccessors) {
-                                objc_setAssociatedObject(target, associationKey, ivar, associationPolicy);
-                            }
-                            if (originalSetterIMP) {
-                                originalSetterIMP(target, setter, ivar);
-                            }
-                        }
-                        return result;
-                    };
-                }
-            }
-        }
-
-        void (^newSetterBlock)(id, id) = nil;
-        if (setterToInject) {
-            if (haveIvar) {
-                newSetterBlock = ^void(id target, id newValue) {
-                    id ivar = object_getIvar(target, propertyIvar);
-                    setterToInject(target, setter, &ivar, newValue, originalSetterIMP);
-                    object_setIvar(target, propertyIvar, ivar);
-                };
-            }
-            else {
-                if (isWeak) {
-                    newSetterBlock = ^void(id target, id newValue) {
-                        id ivar = nil;
-                        DIWeakWrapper *wrapper = nil;
-                        BOOL wrapperWasNil = NO;
-                        if (useOriginalAccessors) {
-                            ivar = originalGetterIMP(target, getter);
-                        }
-                        else {
-                            wrapper = objc_getAssociatedObject(target, associationKey);
-                            wrapperWasNil = (wrapper == nil);
-                            if (wrapperWasNil) {
-                                wrapper = [[DIWeakWrapper alloc] init];
-                            }
-                            ivar = wrapper->object;
-                        }
-                        
-                        BOOL ivarWasNil = (ivar == nil);
-                        setterToInject(target, setter, &ivar, newValue, originalSetterIMP);
-                        if (ivar && ivarWasNil) {
-                            DIAssociatesWrite(klass, getter, target);
-                        }
-                        
+                    
+                    if (ivar != ivar2) {
                         if (!useOriginalAccessors) {
                             wrapper->object = ivar;
                             if (wrapperWasNil) {
-                                objc_setAssociatedObject(target, associationKey, wrapper, associationPolicy);
+                                associationSet(target, associationKey, wrapper, associationPolicy);
                             }
                         }
                         if (originalSetterIMP) {
                             originalSetterIMP(target, setter, ivar);
                         }
-                    };
-                }
-                else {
-                    newSetterBlock = ^void(id target, id newValue) {
-                        id ivar = nil;
-                        if (useOriginalAccessors) {
-                            ivar = originalGetterIMP(target, getter);
-                        }
-                        else {
-                            ivar = objc_getAssociatedObject(target, associationKey);
-                        }
-                        
-                        BOOL ivarWasNil = (ivar == nil);
-                        setterToInject(target, setter, &ivar, newValue, originalSetterIMP);
-                        if (ivar && ivarWasNil) {
-                            DIAssociatesWrite(klass, getter, target);
-                        }
-                        
+                    }
+                    return result;
+                };
+            }
+            else {
+                newGetterBlock = ^id(id target) {
+                    id ivar = nil;
+                    if (useOriginalAccessors) {
+                        ivar = originalGetterIMP(target, getter);
+                    }
+                    else {
+                        ivar = associationGet(target, associationKey);
+                    }
+                    
+                    id ivar2 = ivar;
+                    BOOL ivarWasNil = (ivar == nil);
+                    id result = getterToInject(target, getter, &ivar, originalGetterIMP);
+                    if (ivar && ivarWasNil) {
+                        DIAssociatesWrite(klass, getter, target);
+                    }
+                    
+                    if (ivar != ivar2) {
                         if (!useOriginalAccessors) {
-                            objc_setAssociatedObject(target, associationKey, ivar, associationPolicy);
+                            associationSet(target, associationKey, ivar, associationPolicy);
                         }
                         if (originalSetterIMP) {
                             originalSetterIMP(target, setter, ivar);
                         }
-                    };
-                }
+                    }
+                    return result;
+                };
             }
         }
+    }
 
-        if (getterToInject) {
-            IMP newGetterImp = imp_implementationWithBlock(newGetterBlock);
-            const char *getterTypes = method_getTypeEncoding(class_getInstanceMethod(self, @selector(exampleProperty)));
-            IMP replacedGetterImp = class_replaceMethod(klass, getter, newGetterImp, getterTypes);
-            if (!DIInjectionsGettersBackupWrite(klass, getter, replacedGetterImp ?: (IMP)DINothingToRestore)) {
-                imp_removeBlock(replacedGetterImp);
-            }
+    void (^newSetterBlock)(id, id) = nil;
+    if (setterToInject) {
+        if (setterShape) {
+            newSetterBlock = DIShapedSetterBlock(propertyIvar, ivarOwnership, (attributes.flags & DIPropertyAttributeCopy) != 0);
         }
-
-        // If need association and not have setter and property is not ReadOnly so we need implement simple setter
-        if (!haveIvar && !useOriginalAccessors &&
-            !RRPropertyGetAttribute(property, "R")) {
-            
+        else if (haveIvar) {
+            newSetterBlock = ^void(id target, id newValue) {
+                id ivar = object_getIvar(target, propertyIvar);
+                setterToInject(target, setter, &ivar, newValue, originalSetterIMP);
+                object_setIvar(target, propertyIvar, ivar);
+            };
+        }
+        else {
             if (isWeak) {
                 newSetterBlock = ^void(id target, id newValue) {
-                    DIWeakWrapper *wrapper = objc_getAssociatedObject(target, associationKey) ?: [[DIWeakWrapper alloc] init];
-                    wrapper->object = newValue;
-                    objc_setAssociatedObject(target, associationKey, wrapper, associationPolicy);
+                    id ivar = nil;
+                    DIWeakWrapper *wrapper = nil;
+                    BOOL wrapperWasNil = NO;
+                    if (useOriginalAccessors) {
+                        ivar = originalGetterIMP(target, getter);
+                    }
+                    else {
+                        wrapper = associationGet(target, associationKey);
+                        wrapperWasNil = (wrapper == nil);
+                        if (wrapperWasNil) {
+                            wrapper = [[DIWeakWrapper alloc] init];
+                        }
+                        ivar = wrapper->object;
+                    }
+                    
+                    BOOL ivarWasNil = (ivar == nil);
+                    setterToInject(target, setter, &ivar, newValue, originalSetterIMP);
+                    if (ivar && ivarWasNil) {
+                        DIAssociatesWrite(klass, getter, target);
+                    }
+                    
+                    if (!useOriginalAccessors) {
+                        wrapper->object = ivar;
+                        if (wrapperWasNil) {
+                            associationSet(target, associationKey, wrapper, associationPolicy);
+                        }
+                    }
                     if (originalSetterIMP) {
-                        originalSetterIMP(target, setter, newValue);
+                        originalSetterIMP(target, setter, ivar);
                     }
                 };
             }
             else {
                 newSetterBlock = ^void(id target, id newValue) {
-                    objc_setAssociatedObject(target, associationKey, newValue, associationPolicy);
+                    id ivar = nil;
+                    if (useOriginalAccessors) {
+                        ivar = originalGetterIMP(target, getter);
+                    }
+                    else {
+                        ivar = associationGet(target, associationKey);
+                    }
+                    
+                    BOOL ivarWasNil = (ivar == nil);
+                    setterToInject(target, setter, &ivar, newValue, originalSetterIMP);
+                    if (ivar && ivarWasNil) {
+                        DIAssociatesWrite(klass, getter, target);
+                    }
+                    
+                    if (!useOriginalAccessors) {
+                        associationSet(target, associationKey, ivar, associationPolicy);
+                    }
                     if (originalSetterIMP) {
-                        originalSetterIMP(target, setter, newValue);
+                        originalSetterIMP(target, setter, ivar);
                     }
                 };
             }
         }
+    }
 
-        if (newSetterBlock) {
-            IMP newSetterImp = imp_implementationWithBlock(newSetterBlock);
-            const char *setterTypes = method_getTypeEncoding(class_getInstanceMethod(self, @selector(setExampleProperty:)));
-            IMP replacedSetterImp = class_replaceMethod(klass, setter, newSetterImp, setterTypes);
-            if (!DIInjectionsSettersBackupWrite(klass, setter, replacedSetterImp ?: (IMP)DINothingToRestore)) {
-                imp_removeBlock(replacedSetterImp);
-            }
+    if (getterToInject) {
+        IMP newGetterImp = imp_implementationWithBlock(DIStatsGetterBlock(newGetterBlock, klass, getter));
+        const char *getterTypes = method_getTypeEncoding(class_getInstanceMethod(self, @selector(exampleProperty)));
+        IMP previousBackup = DIInjectionsGettersBackupRead(klass, getter);
+        uint64_t traceStart = DITraceBegin();
+        IMP replacedGetterImp = class_replaceMethod(klass, getter, newGetterImp, getterTypes);
+        if (traceStart) {
+            DITraceEnd(traceStart, "commit", @"replace getter", DITraceAccessorArgs(klass, getter));
         }
-    });
+        DIInjectionsGettersBackupWrite(klass, getter, replacedGetterImp ?: (IMP)DINothingToRestore);
+        DIJournalRecord(descriptor, NO, replacedGetterImp, previousBackup);
+        DILazyProviderUnregister(klass, descriptor.propertyName);
+    }
+
+    // If need association and not have setter and property is not ReadOnly so we need implement simple setter
+    if (!haveIvar && !useOriginalAccessors &&
+        !(attributes.flags & DIPropertyAttributeReadOnly)) {
+        
+        if (isWeak) {
+            newSetterBlock = ^void(id target, id newValue) {
+                DIWeakWrapper *wrapper = associationGet(target, associationKey) ?: [[DIWeakWrapper alloc] init];
+                wrapper->object = newValue;
+                associationSet(target, associationKey, wrapper, associationPolicy);
+                if (originalSetterIMP) {
+                    originalSetterIMP(target, setter, newValue);
+                }
+            };
+        }
+        else {
+            newSetterBlock = ^void(id target, id newValue) {
+                associationSet(target, associationKey, newValue, associationPolicy);
+                if (originalSetterIMP) {
+                    originalSetterIMP(target, setter, newValue);
+                }
+            };
+        }
+    }
+
+    if (newSetterBlock) {
+        IMP newSetterImp = imp_implementationWithBlock(DIStatsSetterBlock(newSetterBlock, klass, setter));
+        const char *setterTypes = method_getTypeEncoding(class_getInstanceMethod(self, @selector(setExampleProperty:)));
+        IMP previousBackup = DIInjectionsSettersBackupRead(klass, setter);
+        uint64_t traceStart = DITraceBegin();
+        IMP replacedSetterImp = class_replaceMethod(klass, setter, newSetterImp, setterTypes);
+        if (traceStart) {
+            DITraceEnd(traceStart, "commit", @"replace setter", DITraceAccessorArgs(klass, setter));
+        }
+        DIInjectionsSettersBackupWrite(klass, setter, replacedSetterImp ?: (IMP)DINothingToRestore);
+        DIJournalRecord(descriptor, YES, replacedSetterImp, previousBackup);
+    }
+    pthread_mutex_unlock(DIInjectionsMutex());
+    
+    return YES;
 }
 
 + (void)inject:(DIPropertyBlock)block conformingProtocols:(NSArray<Protocol *> *)protocols {
-    [self enumerateAllClassProperties:^(Class class, objc_property_t property) {
-        [self inject:class property:property getterBlock:nil setterBlock:nil blockFactory:block];
+    [self inject:block conformingProtocols:protocols storage:DIAssociationStorageRuntime];
+}
+
++ (void)inject:(DIPropertyBlock)block conformingProtocols:(NSArray<Protocol *> *)protocols storage:(DIAssociationStorage)storage {
+    NSMutableArray<DIInjectionPlanStep *> *plan = DIInjectionPlanCurrent();
+    if (plan) {
+        [plan addObject:[[DIInjectionPlanStep alloc] initWithInjectBlock:block rejectBlock:nil protocols:protocols storage:storage]];
+        return;
+    }
+
+    uint64_t traceStart = DITraceBegin();
+    NSMutableArray<DIPropertyDescriptor *> *injected = [NSMutableArray array];
+    [self enumerateAllClassProperties:^(DIPropertyDescriptor *descriptor) {
+        if ([self injectDescriptor:descriptor getterBlock:nil setterBlock:nil blockFactory:block storage:storage]) {
+            [injected addObject:descriptor];
+        }
     } conformingProtocols:protocols];
+    [self recordInjection:block conformingProtocols:protocols storage:storage injected:injected];
+    if (traceStart) {
+        DITraceEnd(traceStart, "inject", @"inject", @{ @"protocols" : DITraceProtocolsName(protocols), @"injected" : @(injected.count) });
+    }
 }
 
-+ (void)reject:(Class)class property:(objc_property_t)property {
++ (void)rejectDescriptor:(DIPropertyDescriptor *)descriptor {
+    Class class = descriptor.targetClass;
+    pthread_mutex_lock(DIInjectionsMutex());
+
     // Restore or remove getter
-    SEL getter = RRPropertyGetGetter(property);
+    SEL getter = descriptor.getter;
     IMP getterImp = DIInjectionsGettersBackupRead(class, getter);
-    if (getterImp && getterImp != DINothingToRestore) {
-        const char *types = method_getTypeEncoding(class_getInstanceMethod(self, @selector(exampleProperty)));
-        IMP replacedImp = class_replaceMethod(class, getter, getterImp, types);
-        imp_removeBlock(replacedImp);
-    }
-    else if (getterImp == DINothingToRestore) {
+    if (getterImp) {
         const char *getterTypes = method_getTypeEncoding(class_getInstanceMethod(self, @selector(exampleProperty)));
-        IMP replacedImp = class_replaceMethod(class, getter, EmptyMethodImp(), getterTypes);
-        imp_removeBlock(replacedImp);
+        IMP restoredImp = (getterImp == DINothingToRestore) ? EmptyMethodImp() : getterImp;
+        uint64_t traceStart = DITraceBegin();
+        IMP replacedImp = class_replaceMethod(class, getter, restoredImp, getterTypes);
+        if (traceStart) {
+            DITraceEnd(traceStart, "commit", @"restore getter", DITraceAccessorArgs(class, getter));
+        }
+        DIInjectionsGettersBackupWrite(class, getter, nil);
+        DIJournalRecord(descriptor, NO, replacedImp, getterImp);
     }
-    DIInjectionsGettersBackupWrite(class, getter, nil);
 
     // Restore or remove setter
-    SEL setter = RRPropertyGetSetter(property);
+    SEL setter = descriptor.setter;
     IMP setterImp = DIInjectionsSettersBackupRead(class, setter);
-    if (setterImp && setterImp != DINothingToRestore) {
-        const char *types = method_getTypeEncoding(class_getInstanceMethod(self, @selector(setExampleProperty:)));
-        IMP replacedImp = class_replaceMethod(class, setter, getterImp, types);
-        imp_removeBlock(replacedImp);
-    }
-    else if (setterImp == DINothingToRestore) {
+    if (setterImp) {
         const char *setterTypes = method_getTypeEncoding(class_getInstanceMethod(self, @selector(setExampleProperty:)));
-        IMP replacedImp = class_replaceMethod(class, setter, EmptyMethodImp(), setterTypes);
-        imp_removeBlock(replacedImp);
+        IMP restoredImp = (setterImp == DINothingToRestore) ? EmptyMethodImp() : setterImp;
+        uint64_t traceStart = DITraceBegin();
+        IMP replacedImp = class_replaceMethod(class, setter, restoredImp, setterTypes);
+        if (traceStart) {
+            DITraceEnd(traceStart, "commit", @"restore setter", DITraceAccessorArgs(class, setter));
+        }
+        DIInjectionsSettersBackupWrite(class, setter, nil);
+        DIJournalRecord(descriptor, YES, replacedImp, setterImp);
     }
-    DIInjectionsSettersBackupWrite(class, setter, nil);
 
-    // Remove association
-    NSArray *associated = DIAssociatesRead(class, getter);
-    if (associated) {
-        NSString *propertyName = [NSString stringWithUTF8String:property_getName(property)];
-        SEL associationKey = NSSelectorFromString([@"DI_" stringByAppendingString:propertyName]);
-        objc_AssociationPolicy associationPolicy = RRPropertyGetAssociationPolicy(property);
-        for (id object in associated) {
-            objc_setAssociatedObject(object, associationKey, nil, associationPolicy);
+    DIAssociationsClear(descriptor);
+    DILazyProviderUnregister(class, descriptor.propertyName);
+    pthread_mutex_unlock(DIInjectionsMutex());
+}
+
++ (void)reject:(DIPropertyFilter)block conformingProtocols:(NSArray<Protocol *> *)protocols {
+    NSMutableArray<DIInjectionPlanStep *> *plan = DIInjectionPlanCurrent();
+    if (plan) {
+        [plan addObject:[[DIInjectionPlanStep alloc] initWithInjectBlock:nil rejectBlock:block protocols:protocols storage:DIAssociationStorageRuntime]];
+        return;
+    }
+
+    uint64_t traceStart = DITraceBegin();
+    [self enumerateAllClassProperties:^(DIPropertyDescriptor *descriptor) {
+        if (block(descriptor.targetClass, descriptor.propertyName, descriptor.propertyClass, descriptor.propertyProtocols)) {
+            [self rejectDescriptor:descriptor];
         }
-        DIAssociatesRemove(class, getter);
+    } conformingProtocols:protocols];
+    [self recordRejection:block conformingProtocols:protocols];
+    if (traceStart) {
+        DITraceEnd(traceStart, "inject", @"reject", @{ @"protocols" : DITraceProtocolsName(protocols) });
     }
 }
 
-+ (void)reject:(DIPropertyFilter)block conformingProtocols:(NSArray<Protocol *> *)protocols {
-    [self enumerateAllClassProperties:^(Class klass, objc_property_t property) {
-        RRPropertyGetClassAndProtocols(property, ^(Class propertyClass, NSSet<Protocol *> *propertyProtocols) {
-            NSString *propertyName = [NSString stringWithUTF8String:property_getName(property)];
-            if (block(klass, propertyName, propertyClass, propertyProtocols)) {
-                [self reject:klass property:property];
+#pragma mark - Rules
+
++ (void)recordInjection:(DIPropertyBlock)block conformingProtocols:(NSArray<Protocol *> *)protocols storage:(DIAssociationStorage)storage injected:(NSArray<DIPropertyDescriptor *> *)descriptors {
+    DIInjectionRule *rule = [[DIInjectionRule alloc] init];
+    rule.protocols = protocols;
+    rule.injectBlock = block;
+    rule.storage = storage;
+    rule.injected = [descriptors mutableCopy];
+
+    NSMutableSet<NSValue *> *injectedProperties = [NSMutableSet setWithCapacity:descriptors.count];
+    for (DIPropertyDescriptor *descriptor in descriptors) {
+        [injectedProperties addObject:[NSValue valueWithPointer:descriptor.property]];
+    }
+
+    @synchronized(DIInjectionRulesLock()) {
+        NSMutableArray<DIInjectionRule *> *rules = DIInjectionRules();
+        NSIndexSet *superseded = [rules indexesOfObjectsPassingTest:^BOOL(DIInjectionRule *existingRule, NSUInteger idx, BOOL *stop) {
+            return DIInjectionRuleSupersedes(rule, existingRule, injectedProperties);
+        }];
+        [rules removeObjectsAtIndexes:superseded];
+        [rules addObject:rule];
+    }
+}
+
++ (void)recordRejection:(DIPropertyFilter)block conformingProtocols:(NSArray<Protocol *> *)protocols {
+    DIInjectionRule *rule = [[DIInjectionRule alloc] init];
+    rule.protocols = protocols;
+    rule.rejectBlock = block;
+
+    @synchronized(DIInjectionRulesLock()) {
+        NSMutableArray<DIInjectionRule *> *rules = DIInjectionRules();
+        [rules addObject:rule];
+
+        // Injection is revoked when rejection covers all its protocols and nothing injected by it left
+        NSMutableArray<DIInjectionRule *> *compacted = [NSMutableArray array];
+        for (DIInjectionRule *existingRule in rules) {
+            if (existingRule.injectBlock &&
+                DIProtocolsCover(rule.protocols, existingRule.protocols) &&
+                !DIInjectionRuleHasInjected(existingRule)) {
+                continue;
             }
-        });
-    } conformingProtocols:protocols];
+            // Rejection matters only after some active injection it can affect
+            if (existingRule.rejectBlock) {
+                BOOL affects = NO;
+                for (DIInjectionRule *injectionRule in compacted) {
+                    if (injectionRule.injectBlock && DIProtocolsIntersect(existingRule.protocols, injectionRule.protocols)) {
+                        affects = YES;
+                        break;
+                    }
+                }
+                if (!affects) {
+                    continue;
+                }
+            }
+            [compacted addObject:existingRule];
+        }
+        [rules setArray:compacted];
+    }
+}
+
++ (void)applyRulesToImageIndex:(DIPropertyIndex *)imageIndex {
+    @synchronized(DIInjectionRulesLock()) {
+        for (DIInjectionRule *rule in DIInjectionRules()) {
+            [imageIndex enumerateDescriptorsConformingProtocols:rule.protocols usingBlock:^(DIPropertyDescriptor *descriptor) {
+                if (rule.injectBlock) {
+                    if ([self injectDescriptor:descriptor getterBlock:nil setterBlock:nil blockFactory:rule.injectBlock storage:rule.storage]) {
+                        [rule.injected addObject:descriptor];
+                    }
+                }
+                else if (rule.rejectBlock(descriptor.targetClass, descriptor.propertyName, descriptor.propertyClass, descriptor.propertyProtocols)) {
+                    [self rejectDescriptor:descriptor];
+                }
+            }];
+        }
+    }
 }
 
 #pragma mark - Public
@@ -605,30 +1325,174 @@ IMP EmptyMethodImp(){
 }
 
 + (NSArray<Class> *)injectedClasses {
-    NSMutableSet *set = [NSMutableSet setWithArray:injectionsGettersBackup.allKeys];
-    [set unionSet:[NSSet setWithArray:injectionsSettersBackup.allKeys]];
+    NSMutableSet *set = [NSMutableSet set];
+    void (^block)(Class, SEL, void *) = ^(Class klass, SEL selector, void *value) {
+        [set addObject:klass];
+    };
+    DIRegistryEnumerate(DIInjectionsGettersBackup(), block);
+    DIRegistryEnumerate(DIInjectionsSettersBackup(), block);
     return set.allObjects;
 }
 
 + (NSArray<NSString *> *)injectedSelectorsForClass:(Class)klass {
-    return [[NSArray arrayWithArray:injectionsGettersBackup[klass].allKeys]
-            arrayByAddingObjectsFromArray:injectionsSettersBackup[klass].allKeys];
+    NSMutableArray<NSString *> *selectors = [NSMutableArray array];
+    void (^block)(Class, SEL, void *) = ^(Class injectedClass, SEL selector, void *value) {
+        if (injectedClass == klass) {
+            [selectors addObject:NSStringFromSelector(selector)];
+        }
+    };
+    DIRegistryEnumerate(DIInjectionsGettersBackup(), block);
+    DIRegistryEnumerate(DIInjectionsSettersBackup(), block);
+    return selectors;
+}
+
++ (DIScanScope *)scanScope {
+    return [DIPropertyIndex sharedIndex].scanScope;
+}
+
++ (void)setScanScope:(DIScanScope *)scanScope {
+    [DIPropertyIndex sharedIndex].scanScope = scanScope ?: [DIScanScope defaultScope];
+}
+
++ (NSString *)indexCachePath {
+    return [DIPropertyIndex sharedIndex].cachePath;
+}
+
++ (void)setIndexCachePath:(NSString *)path {
+    [DIPropertyIndex sharedIndex].cachePath = path;
+}
+
++ (DIInjectionCheckpoint *)checkpoint {
+    DIInjectionCheckpoint *checkpoint = [[DIInjectionCheckpoint alloc] init];
+    pthread_mutex_lock(DIInjectionsMutex());
+    if (DIJournalCheckpointsCount++ == 0) {
+        DIJournal = [NSMutableArray array];
+    }
+    checkpoint.journalPosition = DIJournal.count;
+    @synchronized(DIInjectionRulesLock()) {
+        checkpoint.rules = DIInjectionRules();
+    }
+    pthread_mutex_unlock(DIInjectionsMutex());
+    return checkpoint;
+}
+
++ (void)restoreCheckpoint:(DIInjectionCheckpoint *)checkpoint {
+    pthread_mutex_lock(DIInjectionsMutex());
+    NSAssert(!checkpoint.restored && checkpoint.journalPosition <= DIJournal.count,
+             @"Checkpoint was already restored or newer than restored one");
+    if (checkpoint.restored || checkpoint.journalPosition > DIJournal.count) {
+        pthread_mutex_unlock(DIInjectionsMutex());
+        return;
+    }
+
+    const char *getterTypes = method_getTypeEncoding(class_getInstanceMethod(self, @selector(exampleProperty)));
+    const char *setterTypes = method_getTypeEncoding(class_getInstanceMethod(self, @selector(setExampleProperty:)));
+    NSRange range = NSMakeRange(checkpoint.journalPosition, DIJournal.count - checkpoint.journalPosition);
+    NSArray<DIJournalEntry *> *entries = [DIJournal subarrayWithRange:range];
+    [DIJournal removeObjectsInRange:range];
+
+    // Roll changes back in reverse order, blocks created after checkpoint are kept for threads still running them
+    for (DIJournalEntry *entry in entries.reverseObjectEnumerator) {
+        DIPropertyDescriptor *descriptor = entry.descriptor;
+        Class klass = descriptor.targetClass;
+        SEL selector = entry.setter ? descriptor.setter : descriptor.getter;
+        class_replaceMethod(klass, selector, entry.previousImp ?: EmptyMethodImp(), entry.setter ? setterTypes : getterTypes);
+        DIInjectionsBackupSet(entry.setter ? DIInjectionsSettersBackup() : DIInjectionsGettersBackup(), klass, selector, entry.previousBackup);
+    }
+    for (DIJournalEntry *entry in entries) {
+        // Values of properties not injected at checkpoint are dropped
+        if (!entry.setter && entry.previousBackup == NULL) {
+            DIAssociationsClear(entry.descriptor);
+        }
+    }
+
+    @synchronized(DIInjectionRulesLock()) {
+        [DIInjectionRules() setArray:checkpoint.rules];
+    }
+    checkpoint.restored = YES;
+    pthread_mutex_unlock(DIInjectionsMutex());
+}
+
++ (void)injectPlan:(void (^)(void))block {
+    NSMutableDictionary *threadDictionary = [NSThread currentThread].threadDictionary;
+    if (threadDictionary[DIInjectionPlanThreadKey]) {
+        block();
+        return;
+    }
+
+    NSMutableArray<DIInjectionPlanStep *> *plan = [NSMutableArray array];
+    threadDictionary[DIInjectionPlanThreadKey] = plan;
+    @try {
+        block();
+    }
+    @finally {
+        [threadDictionary removeObjectForKey:DIInjectionPlanThreadKey];
+    }
+    if (plan.count == 0) {
+        return;
+    }
+
+    // Enumerate union of marked properties once or all properties if any step is not restricted to protocols
+    NSMutableOrderedSet<Protocol *> *protocols = [NSMutableOrderedSet orderedSet];
+    for (DIInjectionPlanStep *step in plan) {
+        if (step.protocols == nil) {
+            protocols = nil;
+            break;
+        }
+        [protocols addObjectsFromArray:step.protocols];
+    }
+
+    uint64_t traceStart = DITraceBegin();
+    [self enumerateAllClassProperties:^(DIPropertyDescriptor *descriptor) {
+        for (DIInjectionPlanStep *step in plan) {
+            if (step.protocolsSet && ![step.protocolsSet intersectsSet:descriptor.propertyProtocols]) {
+                continue;
+            }
+            if (step.injectBlock) {
+                if ([self injectDescriptor:descriptor getterBlock:nil setterBlock:nil blockFactory:step.injectBlock storage:step.storage]) {
+                    [step.injected addObject:descriptor];
+                }
+            }
+            else if (step.rejectBlock(descriptor.targetClass, descriptor.propertyName, descriptor.propertyClass, descriptor.propertyProtocols)) {
+                [self rejectDescriptor:descriptor];
+            }
+        }
+    } conformingProtocols:protocols.array];
+
+    for (DIInjectionPlanStep *step in plan) {
+        if (step.injectBlock) {
+            [self recordInjection:step.injectBlock conformingProtocols:step.protocols storage:step.storage injected:step.injected];
+        }
+        else {
+            [self recordRejection:step.rejectBlock conformingProtocols:step.protocols];
+        }
+    }
+    if (traceStart) {
+        DITraceEnd(traceStart, "inject", @"inject plan", @{ @"protocols" : DITraceProtocolsName(protocols.array), @"steps" : @(plan.count) });
+    }
 }
 
 + (NSString *)debugDescription {
     return [[super description] stringByAppendingString:^{
         NSMutableString *str = [NSMutableString stringWithString:@" injected:\n"];
 
-        if (injectionsGettersBackup == nil &&
-            injectionsSettersBackup == nil) {
+        NSMutableDictionary<Class, NSMutableArray<NSString *> *> *getters = [NSMutableDictionary dictionary];
+        DIRegistryEnumerate(DIInjectionsGettersBackup(), ^(Class klass, SEL selector, void *value) {
+            if (getters[klass] == nil) {
+                getters[(id)klass] = [NSMutableArray array];
+            }
+            [getters[klass] addObject:NSStringFromSelector(selector)];
+        });
+
+        if (getters.count == 0 && [self injectedClasses].count == 0) {
             [str appendString:@"Nothing"];
             return str;
         }
 
-        for (Class class in injectionsGettersBackup) {
-            [str appendFormat:@"%@ properties to class %@:\n", @(injectionsGettersBackup[class].count), class];
+        for (Class class in getters) {
+            [str appendFormat:@"%@ properties to class %@:\n", @(getters[class].count), class];
             NSInteger i = 1;
-            for (NSString *selStr in injectionsGettersBackup[class]) {
+            for (NSString *selStr in getters[class]) {
                 NSArray *objects = DIAssociatesRead(class, NSSelectorFromString(selStr));
                 if (objects) {
                     [str appendFormat:@"\t%@. @selector(%@) associated with %@ object(s)\n", @(i++), selStr, @(objects.count)];
@@ -645,7 +1509,16 @@ IMP EmptyMethodImp(){
 #pragma mark - Plugin API
 
 + (void)inject:(Class)klass property:(objc_property_t)property getterBlock:(DIGetter)getterBlock setterBlock:(DISetter)setterBlock {
-    [self inject:klass property:property getterBlock:getterBlock setterBlock:setterBlock blockFactory:nil];
+    [self inject:klass property:property getterBlock:getterBlock setterBlock:setterBlock storage:DIAssociationStorageRuntime];
+}
+
++ (void)inject:(Class)klass property:(objc_property_t)property getterBlock:(DIGetter)getterBlock setterBlock:(DISetter)setterBlock storage:(DIAssociationStorage)storage {
+    DIPropertyDescriptor *descriptor = [[DIPropertyIndex sharedIndex] descriptorForClass:klass property:property];
+    [self injectDescriptor:descriptor getterBlock:getterBlock setterBlock:setterBlock blockFactory:nil storage:storage];
+}
+
++ (void)reject:(Class)klass property:(objc_property_t)property {
+    [self rejectDescriptor:[[DIPropertyIndex sharedIndex] descriptorForClass:klass property:property]];
 }
 
 @end
@@ -20,18 +20,86 @@
 #import <objc/runtime.h>
 
 #import "DIDeluxeInjection.h"
+#import "DIPropertyIndex.h"
 
 NS_ASSUME_NONNULL_BEGIN
 
+/**
+ *  Getter returning \c *ivar, injected as dedicated accessor with direct ivar access
+ */
+DIGetter DIGetterIvar(void);
+
+/**
+ *  Setter assigning \c *ivar without calling original setter, injected as dedicated accessor with direct ivar access
+ */
+DISetter DISetterIvar(void);
+
+/**
+ *  Works the same way as \c DIGetterIfIvarIsNil with block returning \c value,
+ *  injected as dedicated accessor with direct ivar access
+ *
+ *  @param value Value to be assigned to \c nil ivar
+ *
+ *  @return Getter block
+ */
+DIGetter DIGetterIfIvarIsNilWithValue(id _Nullable value);
+
+/**
+ *  Copy block and mark it as behaving the same way as \c sourceBlock,
+ *  used to keep shaped getters and setters recognizable after wrapping into other blocks
+ *
+ *  @param block       Block wrapping \c sourceBlock
+ *  @param sourceBlock Block created with \c DIGetterIvar, \c DISetterIvar, \c DIGetterIfIvarIsNil or \c DIGetterIfIvarIsNilWithValue
+ *
+ *  @return Copied block
+ */
+id DIBlockCopyShape(id block, id _Nullable sourceBlock);
+
+/**
+ *  Copy getter block assigning \c *ivar only when it is \c nil and mark it to be injected
+ *  the same way as \c DIGetterIfIvarIsNilAtomic, works with \c DIGetter and \c DIImperativeGetter blocks
+ *
+ *  @param block Getter block
+ *
+ *  @return Copied block
+ */
+id DIBlockCopyIfNilAtomic(id block);
+
 @interface DeluxeInjection (Plugin)
 
 + (void)inject:(DIPropertyBlock)block conformingProtocols:(NSArray<Protocol *> * _Nullable)protocols;
++ (void)inject:(DIPropertyBlock)block conformingProtocols:(NSArray<Protocol *> * _Nullable)protocols storage:(DIAssociationStorage)storage;
 + (void)reject:(DIPropertyFilter)block conformingProtocols:(NSArray<Protocol *> * _Nullable)protocols;
 
 + (void)inject:(Class)klass property:(objc_property_t)property getterBlock:(DIGetter)getterBlock setterBlock:(DISetter)setterBlock;
++ (void)inject:(Class)klass property:(objc_property_t)property getterBlock:(DIGetter)getterBlock setterBlock:(DISetter)setterBlock storage:(DIAssociationStorage)storage;
 
 + (void)reject:(Class)klass property:(objc_property_t)property;
 
++ (void)enumerateAllClassProperties:(void (^)(DIPropertyDescriptor *descriptor))block conformingProtocols:(NSArray<Protocol *> * _Nullable)protocols;
+
+/**
+ *  Remember injection made by plugin to apply it to classes of images loaded later.
+ *  Injections made with \c inject:conformingProtocols: are remembered automatically.
+ *  Injection replaces earlier ones over the same protocols whose injected properties it injected again.
+ *
+ *  @param block       Block factory to be called for properties of new classes
+ *  @param protocols   Marker protocols of properties or \c nil for all properties
+ *  @param storage     Storage of values of properties without ivar
+ *  @param descriptors Properties injected by plugin right now
+ */
++ (void)recordInjection:(DIPropertyBlock)block conformingProtocols:(NSArray<Protocol *> * _Nullable)protocols storage:(DIAssociationStorage)storage injected:(NSArray<DIPropertyDescriptor *> *)descriptors;
+
+/**
+ *  Remember rejection made by plugin to apply it to classes of images loaded later.
+ *  Rejections made with \c reject:conformingProtocols: are remembered automatically.
+ *  Rejection revokes every earlier injection covering the same protocols once none of its properties stay injected.
+ *
+ *  @param block     Block filter to be called for properties of new classes
+ *  @param protocols Marker protocols of properties or \c nil for all properties
+ */
++ (void)recordRejection:(DIPropertyFilter)block conformingProtocols:(NSArray<Protocol *> * _Nullable)protocols;
+
 @end
 
 NS_ASSUME_NONNULL_END
@@ -0,0 +1,120 @@
+//
+//  DIDependencyGraph.h
+//  DeluxeInjection
+//
+//  Copyright (c) 2016 Anton Bukov <k06aaa@gmail.com>
+//
+//  Licensed under the MIT License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  https://opensource.org/licenses/MIT
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import "DIImperative.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+extern NSString *const DIDependencyGraphErrorDomain;
+
+/**
+ *  Key of \c userInfo of cycle error with array of classes forming cycles or depending on them
+ */
+extern NSString *const DIDependencyGraphCycleClassesKey;
+
+typedef NS_ENUM(NSInteger, DIDependencyGraphError) {
+    DIDependencyGraphErrorCycle = 1,
+};
+
+/**
+ *  Block building instance of service class
+ *
+ *  @param klass Class of service
+ *
+ *  @return Service instance
+ */
+typedef id _Nonnull (^DIDependencyGraphBuilder)(Class klass);
+
+/**
+ *  Graph of service classes where class depends on services of its \c <DIInject> properties,
+ *  built from \c DIImperative holders index. Every service is built once: either by \c build
+ *  or on first access of property injected with \c injectDependencyGraph: whichever comes first.
+ */
+@interface DIDependencyGraph : NSObject
+
+/**
+ *  Service classes in topological order, every class goes after all of its dependencies
+ */
+@property (readonly, copy, nonatomic) NSArray<Class> *classes;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/**
+ *  Get services class depends on
+ *
+ *  @param klass Service class
+ *
+ *  @return Set of service classes
+ */
+- (NSSet<Class> *)dependenciesOfClass:(Class)klass;
+
+/**
+ *  Get service instance building it and its dependencies if needed.
+ *  Builder should reach other graph classes through declared dependencies only: undeclared access
+ *  of class being built, directly or from lazy getter called inside \c init, never returns.
+ *  It is asserted when the access happens on the building thread.
+ *
+ *  @param klass Service class
+ *
+ *  @return Service instance or \c nil if class is not in graph
+ */
+- (nullable id)instanceOfClass:(Class)klass;
+
+/**
+ *  Build all services on concurrent queue and wait for them, independent services are built in parallel,
+ *  every service is built after all of its dependencies
+ */
+- (void)build;
+
+/**
+ *  Build all services on concurrent queue without waiting
+ *
+ *  @param completion Block to be called on main queue after all services are built
+ */
+- (void)buildWithCompletion:(nullable dispatch_block_t)completion;
+
+@end
+
+//
+
+@interface DIImperative (DIDependencyGraph)
+
+/**
+ *  Make dependency graph of service classes, cycles are detected right here
+ *
+ *  @param classes Service classes
+ *  @param builder Block building instance of class, \c alloc-init is used for \c nil
+ *  @param error   Error with \c DIDependencyGraphErrorCycle code if dependencies have cycle
+ *
+ *  @return Graph or \c nil if dependencies have cycle
+ */
+- (nullable DIDependencyGraph *)dependencyGraphForClasses:(NSArray<Class> *)classes
+                                                  builder:(nullable DIDependencyGraphBuilder)builder
+                                                    error:(NSError **)error;
+
+/**
+ *  Inject \c <DIInject> properties of every service class of graph with its single instance
+ *
+ *  @param graph Dependency graph
+ */
+- (void)injectDependencyGraph:(DIDependencyGraph *)graph;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,278 @@
+//
+//  DIDependencyGraph.m
+//  DeluxeInjection
+//
+//  Copyright (c) 2016 Anton Bukov <k06aaa@gmail.com>
+//
+//  Licensed under the MIT License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  https://opensource.org/licenses/MIT
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import <pthread.h>
+#import <stdatomic.h>
+
+#import "DIInject.h"
+#import "DIImperativePlugin.h"
+#import "DIDependencyGraph.h"
+#import "DITracePlugin.h"
+
+NSString *const DIDependencyGraphErrorDomain = @"DIDependencyGraphErrorDomain";
+NSString *const DIDependencyGraphCycleClassesKey = @"DIDependencyGraphCycleClassesKey";
+
+@interface DIDependencyGraphNode : NSObject {
+@public
+    Class _klass;
+    NSUInteger _index;
+    NSArray<DIDependencyGraphNode *> *_dependencies;
+    NSArray<DIDependencyGraphNode *> *_dependents;
+    dispatch_once_t _once;
+    _Atomic(uintptr_t) _buildingThread;
+    _Atomic(BOOL) _built;
+    id _instance;
+}
+
+@end
+
+@implementation DIDependencyGraphNode
+
+@end
+
+//
+
+@interface DIDependencyGraph ()
+
+@property (strong, nonatomic) NSArray<DIDependencyGraphNode *> *nodes;
+@property (strong, nonatomic) NSDictionary<Class, DIDependencyGraphNode *> *nodesByClass;
+@property (copy, nonatomic) DIDependencyGraphBuilder builder;
+
+@end
+
+@implementation DIDependencyGraph
+
+- (instancetype)initWithClasses:(NSArray<Class> *)classes
+                   dependencies:(NSDictionary<Class, NSSet<Class> *> *)dependencies
+                        builder:(DIDependencyGraphBuilder)builder {
+    self = [super init];
+    if (self) {
+        _classes = [classes copy];
+        _builder = [builder copy];
+
+        NSMutableArray<DIDependencyGraphNode *> *nodes = [NSMutableArray arrayWithCapacity:classes.count];
+        NSMutableDictionary<Class, DIDependencyGraphNode *> *nodesByClass = [NSMutableDictionary dictionaryWithCapacity:classes.count];
+        for (Class klass in classes) {
+            DIDependencyGraphNode *node = [DIDependencyGraphNode new];
+            node->_klass = klass;
+            node->_index = nodes.count;
+            [nodes addObject:node];
+            nodesByClass[(id)klass] = node;
+        }
+
+        NSMutableDictionary<Class, NSMutableArray<DIDependencyGraphNode *> *> *dependents = [NSMutableDictionary dictionary];
+        for (DIDependencyGraphNode *node in nodes) {
+            NSMutableArray<DIDependencyGraphNode *> *nodeDependencies = [NSMutableArray array];
+            for (Class dependency in dependencies[(id)node->_klass]) {
+                [nodeDependencies addObject:nodesByClass[(id)dependency]];
+                if (dependents[(id)dependency] == nil) {
+                    dependents[(id)dependency] = [NSMutableArray array];
+                }
+                [dependents[(id)dependency] addObject:node];
+            }
+            node->_dependencies = nodeDependencies;
+        }
+        for (DIDependencyGraphNode *node in nodes) {
+            node->_dependents = [dependents[(id)node->_klass] copy] ?: @[];
+        }
+
+        _nodes = nodes;
+        _nodesByClass = nodesByClass;
+    }
+    return self;
+}
+
+- (NSSet<Class> *)dependenciesOfClass:(Class)klass {
+    DIDependencyGraphNode *node = self.nodesByClass[(id)klass];
+    if (node == nil) {
+        return [NSSet set];
+    }
+    NSMutableSet<Class> *dependencies = [NSMutableSet setWithCapacity:node->_dependencies.count];
+    for (DIDependencyGraphNode *dependency in node->_dependencies) {
+        [dependencies addObject:dependency->_klass];
+    }
+    return dependencies;
+}
+
+- (id)instanceOfNode:(DIDependencyGraphNode *)node {
+    // Graph is acyclic, so nested once blocks of different nodes can not deadlock unless builder
+    // reaches graph class not declared as dependency, nested once block of the same node never returns
+    if (!atomic_load_explicit(&node->_built, memory_order_acquire)) {
+        NSAssert(atomic_load_explicit(&node->_buildingThread, memory_order_relaxed) != (uintptr_t)pthread_self(),
+                 @"%@ is requested while being built, builders should reach other graph classes through declared dependencies only", node->_klass);
+    }
+    dispatch_once(&node->_once, ^{
+        atomic_store_explicit(&node->_buildingThread, (uintptr_t)pthread_self(), memory_order_relaxed);
+        for (DIDependencyGraphNode *dependency in node->_dependencies) {
+            [self instanceOfNode:dependency];
+        }
+        uint64_t traceStart = DITraceBegin();
+        node->_instance = self.builder(node->_klass);
+        if (traceStart) {
+            DITraceEnd(traceStart, "graph", @"build", @{ @"class" : NSStringFromClass(node->_klass) });
+        }
+        atomic_store_explicit(&node->_built, YES, memory_order_release);
+        atomic_store_explicit(&node->_buildingThread, 0, memory_order_relaxed);
+    });
+    return node->_instance;
+}
+
+- (id)instanceOfClass:(Class)klass {
+    DIDependencyGraphNode *node = self.nodesByClass[(id)klass];
+    if (node == nil) {
+        return nil;
+    }
+    return [self instanceOfNode:node];
+}
+
+- (void)buildNode:(DIDependencyGraphNode *)node
+          pending:(_Atomic(NSUInteger) *)pending
+            group:(dispatch_group_t)group
+            queue:(dispatch_queue_t)queue {
+    [self instanceOfNode:node];
+    for (DIDependencyGraphNode *dependent in node->_dependents) {
+        // Last built dependency schedules dependent, group can not become empty before it
+        if (atomic_fetch_sub(&pending[dependent->_index], 1) == 1) {
+            dispatch_group_async(group, queue, ^{
+                [self buildNode:dependent pending:pending group:group queue:queue];
+            });
+        }
+    }
+}
+
+- (dispatch_group_t)startBuild {
+    dispatch_group_t group = dispatch_group_create();
+    dispatch_queue_t queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+    _Atomic(NSUInteger) *pending = calloc(self.nodes.count, sizeof(_Atomic(NSUInteger)));
+    for (DIDependencyGraphNode *node in self.nodes) {
+        atomic_init(&pending[node->_index], node->_dependencies.count);
+    }
+
+    for (DIDependencyGraphNode *node in self.nodes) {
+        if (node->_dependencies.count == 0) {
+            dispatch_group_async(group, queue, ^{
+                [self buildNode:node pending:pending group:group queue:queue];
+            });
+        }
+    }
+    dispatch_group_notify(group, queue, ^{
+        free(pending);
+    });
+    return group;
+}
+
+- (void)build {
+    dispatch_group_wait([self startBuild], DISPATCH_TIME_FOREVER);
+}
+
+- (void)buildWithCompletion:(dispatch_block_t)completion {
+    dispatch_group_t group = [self startBuild];
+    if (completion) {
+        dispatch_group_notify(group, dispatch_get_main_queue(), completion);
+    }
+}
+
+@end
+
+//
+
+@implementation DIImperative (DIDependencyGraph)
+
+- (DIDependencyGraph *)dependencyGraphForClasses:(NSArray<Class> *)classes
+                                         builder:(DIDependencyGraphBuilder)builder
+                                           error:(NSError **)error {
+    NSArray<Class> *uniqueClasses = [NSOrderedSet orderedSetWithArray:classes].array;
+
+    // Class depends on every graph class used as property class of its own or inherited <DIInject> property
+    NSMutableDictionary<Class, NSMutableSet<Class> *> *dependencies = [NSMutableDictionary dictionaryWithCapacity:uniqueClasses.count];
+    for (Class klass in uniqueClasses) {
+        dependencies[(id)klass] = [NSMutableSet set];
+    }
+    DIImperativeIndex *index = self.index;
+    for (Class propertyClass in uniqueClasses) {
+        [[index holdersForPropertyClass:propertyClass] enumerateIndexesUsingBlock:^(NSUInteger idx, BOOL *stop) {
+            DIImperativeHolder *holder = &index.holders[idx];
+            if (![holder->propertyProtocols containsObject:@protocol(DIInject)]) {
+                return;
+            }
+            for (Class klass in uniqueClasses) {
+                if ([klass isSubclassOfClass:holder->targetClass]) {
+                    [dependencies[(id)klass] addObject:propertyClass];
+                }
+            }
+        }];
+    }
+
+    // Kahn's algorithm, classes without dependencies keep order of input array
+    NSMutableDictionary<Class, NSNumber *> *inDegrees = [NSMutableDictionary dictionaryWithCapacity:uniqueClasses.count];
+    NSMutableDictionary<Class, NSMutableArray<Class> *> *dependents = [NSMutableDictionary dictionary];
+    NSMutableArray<Class> *ready = [NSMutableArray array];
+    for (Class klass in uniqueClasses) {
+        inDegrees[(id)klass] = @(dependencies[(id)klass].count);
+        if (dependencies[(id)klass].count == 0) {
+            [ready addObject:klass];
+        }
+        for (Class dependency in dependencies[(id)klass]) {
+            if (dependents[(id)dependency] == nil) {
+                dependents[(id)dependency] = [NSMutableArray array];
+            }
+            [dependents[(id)dependency] addObject:klass];
+        }
+    }
+
+    NSMutableArray<Class> *sorted = [NSMutableArray arrayWithCapacity:uniqueClasses.count];
+    for (NSUInteger i = 0; i < ready.count; i++) {
+        Class klass = ready[i];
+        [sorted addObject:klass];
+        for (Class dependent in dependents[(id)klass]) {
+            NSUInteger inDegree = inDegrees[(id)dependent].unsignedIntegerValue - 1;
+            inDegrees[(id)dependent] = @(inDegree);
+            if (inDegree == 0) {
+                [ready addObject:dependent];
+            }
+        }
+    }
+
+    if (sorted.count < uniqueClasses.count) {
+        if (error) {
+            NSMutableArray<Class> *cycleClasses = [uniqueClasses mutableCopy];
+            [cycleClasses removeObjectsInArray:sorted];
+            NSString *description = [NSString stringWithFormat:@"Dependency cycle between classes: %@", [cycleClasses componentsJoinedByString:@", "]];
+            *error = [NSError errorWithDomain:DIDependencyGraphErrorDomain
+                                         code:DIDependencyGraphErrorCycle
+                                     userInfo:@{ NSLocalizedDescriptionKey : description,
+                                                 DIDependencyGraphCycleClassesKey : cycleClasses }];
+        }
+        return nil;
+    }
+
+    return [[DIDependencyGraph alloc] initWithClasses:sorted dependencies:dependencies builder:builder ?: ^id(Class klass) {
+        return [[klass alloc] init];
+    }];
+}
+
+- (void)injectDependencyGraph:(DIDependencyGraph *)graph {
+    for (Class klass in graph.classes) {
+        [[[self inject] byPropertyClass:klass] getterValueLazy:^id {
+            return [graph instanceOfClass:klass];
+        }];
+    }
+}
+
+@end
@@ -57,16 +57,15 @@ static NSSet *excudeProtocols() {
             return nil;
         }
         
-        objc_property_t property = RRClassGetPropertyByName(targetClass, propertyName);
-        if (RRPropertyGetIsWeak(property)) {
+        DIPropertyAttributes attributes;
+        DIPropertyAttributesParse(RRClassGetPropertyByName(targetClass, propertyName), &attributes);
+        if (attributes.flags & DIPropertyAttributeWeak) {
             __weak id weakValue = value;
             return @[DIGetterIfIvarIsNil(^id(id target, SEL cmd) {
                 return weakValue;
             }), [DeluxeInjection doNotInject]];
         } else {
-            return @[DIGetterIfIvarIsNil(^id(id target, SEL cmd) {
-                return value;
-            }), [DeluxeInjection doNotInject]];
+            return @[DIGetterIfIvarIsNilWithValue(value), [DeluxeInjection doNotInject]];
         }
     } conformingProtocols:nil];
 }
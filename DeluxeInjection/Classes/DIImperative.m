@@ -17,24 +17,202 @@
 //  limitations under the License.
 //
 
+#import <objc/runtime.h>
+
 #import "DIDeluxeInjectionPlugin.h"
 #import "DIInject.h"
 
 #import "DIImperative.h"
 #import "DIImperativePlugin.h"
+#import "DITracePlugin.h"
+
+//
+
+@interface DIImperativeIndex ()
+
+@property (assign, nonatomic) DIImperativeHolder *holders;
+@property (assign, nonatomic) NSUInteger count;
+@property (assign, nonatomic) NSUInteger generation;
+@property (assign, nonatomic) NSUInteger protocolsCount;
+@property (strong, nonatomic) NSArray<DIPropertyDescriptor *> *descriptors;
+@property (strong, nonatomic) NSDictionary<id, NSIndexSet *> *byClass;
+@property (strong, nonatomic) NSDictionary<NSValue *, NSIndexSet *> *byProtocol;
+@property (strong, nonatomic) NSDictionary<id, NSIndexSet *> *byContainer;
+@property (strong, nonatomic) NSDictionary<id, NSArray<Class> *> *subclasses;
+@property (strong, nonatomic) NSMutableDictionary<id, id> *byContainerHierarchy;
+
+@end
+
+@implementation DIImperativeIndex
+
+- (instancetype)initWithProtocols:(NSArray<Protocol *> *)protocols {
+    self = [super init];
+    if (self) {
+        DIPropertyIndex *propertyIndex = [DIPropertyIndex sharedIndex];
+        _generation = propertyIndex.generation;
+        _protocolsCount = protocols.count;
+        
+        NSMutableArray<DIPropertyDescriptor *> *descriptors = [NSMutableArray array];
+        [propertyIndex enumerateDescriptorsConformingProtocols:protocols usingBlock:^(DIPropertyDescriptor *descriptor) {
+            [descriptors addObject:descriptor];
+        }];
+        _descriptors = descriptors;
+        _count = descriptors.count;
+        _holders = calloc(MAX(_count, 1), sizeof(DIImperativeHolder));
+        
+        NSMutableDictionary<id, NSMutableIndexSet *> *byClass = [NSMutableDictionary dictionary];
+        NSMutableDictionary<NSValue *, NSMutableIndexSet *> *byProtocol = [NSMutableDictionary dictionary];
+        NSMutableDictionary<id, NSMutableIndexSet *> *byContainer = [NSMutableDictionary dictionary];
+        for (NSUInteger i = 0; i < _count; i++) {
+            DIPropertyDescriptor *descriptor = descriptors[i];
+            Class propertyClass = descriptor.propertyClass;
+            _holders[i] = (DIImperativeHolder){
+                .targetClass = descriptor.targetClass,
+                .propertyClass = propertyClass,
+                .propertyName = descriptor.propertyName,
+                .propertyProtocols = descriptor.propertyProtocols,
+                .descriptor = descriptor,
+                .property = descriptor.property,
+                .attributeFlags = descriptor.attributes.flags,
+                .getter = descriptor.getter,
+                .setter = descriptor.setter,
+            };
+            
+            if (propertyClass) {
+                if (byClass[(id)propertyClass] == nil) {
+                    byClass[(id)propertyClass] = [NSMutableIndexSet indexSet];
+                }
+                [byClass[(id)propertyClass] addIndex:i];
+            }
+            
+            for (Protocol *protocol in descriptor.propertyProtocols) {
+                NSValue *key = [NSValue valueWithPointer:(__bridge void *)(protocol)];
+                if (byProtocol[key] == nil) {
+                    byProtocol[key] = [NSMutableIndexSet indexSet];
+                }
+                [byProtocol[key] addIndex:i];
+            }
+            
+            Class targetClass = descriptor.targetClass;
+            if (byContainer[(id)targetClass] == nil) {
+                byContainer[(id)targetClass] = [NSMutableIndexSet indexSet];
+            }
+            [byContainer[(id)targetClass] addIndex:i];
+        }
+        
+        // Link every container class to root through superclasses, stop at already linked ones
+        NSMutableDictionary<id, NSMutableArray<Class> *> *subclasses = [NSMutableDictionary dictionary];
+        NSMutableSet<Class> *linked = [NSMutableSet set];
+        for (Class containerClass in byContainer) {
+            for (Class klass = containerClass; klass && ![linked containsObject:klass]; klass = class_getSuperclass(klass)) {
+                [linked addObject:klass];
+                Class superclass = class_getSuperclass(klass);
+                if (superclass) {
+                    if (subclasses[(id)superclass] == nil) {
+                        subclasses[(id)superclass] = [NSMutableArray array];
+                    }
+                    [subclasses[(id)superclass] addObject:klass];
+                }
+            }
+        }
+        
+        _byClass = byClass;
+        _byProtocol = byProtocol;
+        _byContainer = byContainer;
+        _subclasses = subclasses;
+        _byContainerHierarchy = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(_holders);
+}
+
+- (NSIndexSet *)holdersForPropertyClass:(Class)klass {
+    return self.byClass[(id)klass];
+}
+
+- (NSIndexSet *)holdersForProtocol:(Protocol *)protocol {
+    return self.byProtocol[[NSValue valueWithPointer:(__bridge void *)(protocol)]];
+}
+
+- (NSIndexSet *)holdersForContainerClass:(Class)klass {
+    @synchronized(self.byContainerHierarchy) {
+        id cached = self.byContainerHierarchy[(id)klass];
+        if (cached) {
+            return (cached == [NSNull null]) ? nil : cached;
+        }
+        
+        NSMutableIndexSet *indexes = [NSMutableIndexSet indexSet];
+        NSMutableArray<Class> *stack = [NSMutableArray arrayWithObject:klass];
+        while (stack.count) {
+            Class containerClass = stack.lastObject;
+            [stack removeLastObject];
+            NSIndexSet *containerIndexes = self.byContainer[(id)containerClass];
+            if (containerIndexes) {
+                [indexes addIndexes:containerIndexes];
+            }
+            NSArray<Class> *containerSubclasses = self.subclasses[(id)containerClass];
+            if (containerSubclasses) {
+                [stack addObjectsFromArray:containerSubclasses];
+            }
+        }
+        
+        self.byContainerHierarchy[(id)klass] = indexes.count ? [indexes copy] : [NSNull null];
+        return indexes.count ? indexes : nil;
+    }
+}
+
+@end
 
 //
 
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wdeprecated-implementations"
+#pragma clang diagnostic ignored "-Wdeprecated-declarations"
+
+@interface DIPropertyHolder ()
+
+@property (weak, nonatomic) DIImperative *lets;
+@property (assign, nonatomic) DIImperativeHolder *holder;
+
+@end
+
 @implementation DIPropertyHolder
 
+- (BOOL)wasInjectedGetter {
+    return [self.lets wasInjectedGetter:self.holder];
+}
+
+- (void)setWasInjectedGetter:(BOOL)wasInjectedGetter {
+    [self.lets markHolder:self.holder injectedGetter:wasInjectedGetter injectedSetter:[self.lets wasInjectedSetter:self.holder]];
+}
+
+- (BOOL)wasInjectedSetter {
+    return [self.lets wasInjectedSetter:self.holder];
+}
+
+- (void)setWasInjectedSetter:(BOOL)wasInjectedSetter {
+    [self.lets markHolder:self.holder injectedGetter:[self.lets wasInjectedGetter:self.holder] injectedSetter:wasInjectedSetter];
+}
+
 @end
 
+#pragma clang diagnostic pop
+
 //
 
+typedef NS_OPTIONS(uint8_t, DIImperativeInjected) {
+    DIImperativeInjectedGetter = 1 << 0,
+    DIImperativeInjectedSetter = 1 << 1,
+};
+
 @interface DIImperative ()
 
-@property (strong, nonatomic) NSMutableDictionary<id,NSMutableArray<DIPropertyHolder *> *> *byClass;
-@property (strong, nonatomic) NSMutableDictionary<NSValue *,NSMutableArray<DIPropertyHolder *> *> *byProtocol;
+@property (strong, nonatomic) DIImperativeIndex *index;
+@property (assign, nonatomic) DIImperativeInjected *injected;
+@property (assign, nonatomic) NSUInteger injectedCount;
 @property (assign, nonatomic) BOOL shouldSkipAsserts;
 
 @end
@@ -43,52 +221,130 @@
 
 static NSMutableArray<Protocol *> *DIImperativeProtocols;
 
-@implementation DIImperative
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wdeprecated-declarations"
+
+@implementation DIImperative {
+    NSMutableDictionary<id,NSMutableArray<DIPropertyHolder *> *> *_byClass;
+    NSMutableDictionary<NSValue *,NSMutableArray<DIPropertyHolder *> *> *_byProtocol;
+}
+
+#pragma clang diagnostic pop
 
 + (void)registerPluginProtocol:(Protocol *)pluginProtocol {
     static dispatch_once_t onceToken;
     dispatch_once(&onceToken, ^{
         DIImperativeProtocols = [NSMutableArray array];
     });
-    [DIImperativeProtocols addObject:pluginProtocol];
+    @synchronized(DIImperativeProtocols) {
+        [DIImperativeProtocols addObject:pluginProtocol];
+    }
+}
+
++ (NSArray<Protocol *> *)pluginProtocols {
+    @synchronized(DIImperativeProtocols) {
+        return [DIImperativeProtocols copy];
+    }
+}
+
++ (DIImperativeIndex *)sharedIndex {
+    static DIImperativeIndex *sharedIndex;
+    NSArray<Protocol *> *protocols = [self pluginProtocols];
+    @synchronized(self) {
+        if (sharedIndex == nil ||
+            sharedIndex.generation != [DIPropertyIndex sharedIndex].generation ||
+            sharedIndex.protocolsCount != protocols.count) {
+            sharedIndex = [[DIImperativeIndex alloc] initWithProtocols:protocols];
+        }
+        return sharedIndex;
+    }
 }
 
 - (instancetype)init {
     self = [super init];
     if (self) {
+        _index = [DIImperative sharedIndex];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(_injected);
+}
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wdeprecated-declarations"
+
+- (NSMutableArray<DIPropertyHolder *> *)propertyHoldersForIndexes:(NSIndexSet *)indexes {
+    NSMutableArray<DIPropertyHolder *> *propertyHolders = [NSMutableArray arrayWithCapacity:indexes.count];
+    [indexes enumerateIndexesUsingBlock:^(NSUInteger idx, BOOL *stop) {
+        DIImperativeHolder *holder = &self.index.holders[idx];
+        DIPropertyHolder *propertyHolder = [[DIPropertyHolder alloc] init];
+        propertyHolder.targetClass = holder->targetClass;
+        propertyHolder.propertyClass = holder->propertyClass;
+        propertyHolder.propertyName = holder->propertyName;
+        propertyHolder.propertyProtocols = holder->propertyProtocols;
+        propertyHolder.getter = holder->getter;
+        propertyHolder.setter = holder->setter;
+        propertyHolder.lets = self;
+        propertyHolder.holder = holder;
+        [propertyHolders addObject:propertyHolder];
+    }];
+    return propertyHolders;
+}
+
+- (NSMutableDictionary<id,NSMutableArray<DIPropertyHolder *> *> *)byClass {
+    if (_byClass == nil) {
         _byClass = [NSMutableDictionary dictionary];
+        [self.index.byClass enumerateKeysAndObjectsUsingBlock:^(id klass, NSIndexSet *indexes, BOOL *stop) {
+            self->_byClass[klass] = [self propertyHoldersForIndexes:indexes];
+        }];
+    }
+    return _byClass;
+}
+
+- (void)setByClass:(NSMutableDictionary<id,NSMutableArray<DIPropertyHolder *> *> *)byClass {
+    _byClass = byClass;
+}
+
+- (NSMutableDictionary<NSValue *,NSMutableArray<DIPropertyHolder *> *> *)byProtocol {
+    if (_byProtocol == nil) {
         _byProtocol = [NSMutableDictionary dictionary];
-        
-        [DeluxeInjection inject:^NSArray * (Class targetClass, SEL getter, SEL setter, NSString *propertyName, Class propertyClass, NSSet<Protocol *> *propertyProtocols) {
-            
-            DIPropertyHolder *holder = [[DIPropertyHolder alloc] init];
-            holder.targetClass = targetClass;
-            holder.getter = getter;
-            holder.setter = setter;
-            holder.propertyName = propertyName;
-            holder.propertyClass = propertyClass;
-            holder.propertyProtocols = propertyProtocols;
-            
-            if (propertyClass) {
-                if (self->_byClass[(id)propertyClass] == nil) {
-                    self->_byClass[(id)propertyClass] = [NSMutableArray array];
-                }
-                [self->_byClass[(id)propertyClass] addObject:holder];
-            }
-            
-            for (Protocol *protocol in propertyProtocols) {
-                NSValue *key = [NSValue valueWithPointer:(__bridge void *)(protocol)];
-                if (self->_byProtocol[key] == nil) {
-                    self->_byProtocol[key] = [NSMutableArray array];
-                }
-                [self->_byProtocol[key] addObject:holder];
-            }
-            
-            return @[[DeluxeInjection doNotInject],
-                     [DeluxeInjection doNotInject]];
-        } conformingProtocols:DIImperativeProtocols];
+        [self.index.byProtocol enumerateKeysAndObjectsUsingBlock:^(NSValue *key, NSIndexSet *indexes, BOOL *stop) {
+            self->_byProtocol[key] = [self propertyHoldersForIndexes:indexes];
+        }];
+    }
+    return _byProtocol;
+}
+
+- (void)setByProtocol:(NSMutableDictionary<NSValue *,NSMutableArray<DIPropertyHolder *> *> *)byProtocol {
+    _byProtocol = byProtocol;
+}
+
+#pragma clang diagnostic pop
+
+- (BOOL)wasInjectedGetter:(DIImperativeHolder *)holder {
+    return self.injected && (self.injected[holder - self.index.holders] & DIImperativeInjectedGetter);
+}
+
+- (BOOL)wasInjectedSetter:(DIImperativeHolder *)holder {
+    return self.injected && (self.injected[holder - self.index.holders] & DIImperativeInjectedSetter);
+}
+
+- (void)markHolder:(DIImperativeHolder *)holder injectedGetter:(BOOL)getter injectedSetter:(BOOL)setter {
+    if (self.injected == NULL) {
+        self.injected = calloc(MAX(self.index.count, 1), sizeof(DIImperativeInjected));
+    }
+    DIImperativeInjected *injected = &self.injected[holder - self.index.holders];
+    BOOL wasInjected = (*injected != 0);
+    *injected = (getter ? DIImperativeInjectedGetter : 0) | (setter ? DIImperativeInjectedSetter : 0);
+    BOOL isInjected = getter || setter;
+    if (isInjected && !wasInjected) {
+        self.injectedCount++;
+    }
+    if (!isInjected && wasInjected) {
+        self.injectedCount--;
     }
-    return self;
 }
 
 - (void)skipAsserts {
@@ -96,28 +352,21 @@ static NSMutableArray<Protocol *> *DIImperativeProtocols;
 }
 
 - (void)checkAllInjected {
-    if (self.shouldSkipAsserts) {
+    if (self.shouldSkipAsserts || self.injectedCount == self.index.count) {
         return;
     }
     
-    for (Class klass in self.byClass) {
-        for (DIPropertyHolder *holder in self.byClass[klass]) {
-            NSString *problemDescription = [NSString stringWithFormat:@"Missing injection by class to %@.%@", holder.targetClass, NSStringFromSelector(holder.getter)];
-            NSAssert(holder.wasInjectedGetter || holder.wasInjectedSetter, problemDescription);
-            if (!holder.wasInjectedGetter && !holder.wasInjectedSetter) {
-                NSLog(@"Warning: %@", problemDescription);
-            }
-        }
-    }
-    
-    for (NSValue *key in self.byProtocol) {
-        for (DIPropertyHolder *holder in self.byProtocol[key]) {
-            NSString *problemDescription = [NSString stringWithFormat:@"Missing injection by protocol to %@.%@", holder.targetClass, NSStringFromSelector(holder.getter)];
-            NSAssert(holder.wasInjectedGetter || holder.wasInjectedSetter, problemDescription);
-            if (!holder.wasInjectedGetter && !holder.wasInjectedSetter) {
-                NSLog(@"Warning: %@", problemDescription);
-            }
+    DIImperativeHolder *holders = self.index.holders;
+    for (NSUInteger i = 0; i < self.index.count; i++) {
+        DIImperativeHolder *holder = &holders[i];
+        if ([self wasInjectedGetter:holder] || [self wasInjectedSetter:holder]) {
+            continue;
         }
+        NSString *problemDescription = [NSString stringWithFormat:@"Missing injection %@ to %@.%@",
+                                        holder->propertyClass ? @"by class" : @"by protocol",
+                                        holder->targetClass, NSStringFromSelector(holder->getter)];
+        NSAssert(NO, problemDescription);
+        NSLog(@"Warning: %@", problemDescription);
     }
 }
 
@@ -128,11 +377,17 @@ static NSMutableArray<Protocol *> *DIImperativeProtocols;
 @implementation DeluxeInjection (DIImperative)
 
 + (void)imperative:(void (^)(DIImperative *lets))block; {
+    // Holders of shared index are read-only and injected flags are per session,
+    // so sessions are not serialized and user block runs without any lock held
+    uint64_t traceStart = DITraceBegin();
     DIImperative *di = [[DIImperative alloc] init];
     @autoreleasepool {
         block(di);
     }
     [di checkAllInjected];
+    if (traceStart) {
+        DITraceEnd(traceStart, "imperative", @"imperative", nil);
+    }
 }
 
 @end
@@ -18,9 +18,34 @@
 //
 
 #import "DIImperative.h"
+#import "DIPropertyIndex.h"
 
 NS_ASSUME_NONNULL_BEGIN
 
+/**
+ *  Compact description of injectable property, holders are stored in contiguous array
+ *  of \c DIImperativeIndex and shared read-only by all imperative sessions
+ */
+typedef struct {
+    __unsafe_unretained Class targetClass;
+    __unsafe_unretained Class _Nullable propertyClass;
+    __unsafe_unretained NSString *propertyName;
+    __unsafe_unretained NSSet<Protocol *> *propertyProtocols;
+    __unsafe_unretained DIPropertyDescriptor *descriptor;
+    objc_property_t property;
+    DIPropertyAttributeFlags attributeFlags;
+    SEL getter;
+    SEL setter;
+} DIImperativeHolder;
+
+//
+
+/**
+ *  Object description of injectable property used by plugins before \c DIImperativeHolder,
+ *  kept for compatibility: objects are created on demand by \c byClass and \c byProtocol
+ *  and \c wasInjectedGetter / \c wasInjectedSetter are forwarded to the session
+ */
+DEPRECATED_MSG_ATTRIBUTE("Use DIImperativeHolder of -[DIImperative index]")
 @interface DIPropertyHolder : NSObject
 
 @property (assign, nonatomic) Class targetClass;
@@ -36,10 +61,60 @@ NS_ASSUME_NONNULL_BEGIN
 
 //
 
+/**
+ *  Holders of all properties marked with plugin protocols grouped by property class and by protocol,
+ *  built once from \c DIPropertyIndex and rebuilt only after index changes
+ */
+@interface DIImperativeIndex : NSObject
+
+@property (readonly, assign, nonatomic) DIImperativeHolder *holders;
+@property (readonly, assign, nonatomic) NSUInteger count;
+
+- (nullable NSIndexSet *)holdersForPropertyClass:(Class)klass;
+- (nullable NSIndexSet *)holdersForProtocol:(Protocol *)protocol;
+
+/**
+ *  Get holders of properties declared in class or any of its subclasses,
+ *  walks only indexed part of class hierarchy and caches result
+ *
+ *  @param klass Container class
+ *
+ *  @return Indexes of holders or \c nil if there are no such holders
+ */
+- (nullable NSIndexSet *)holdersForContainerClass:(Class)klass;
+
+@end
+
+//
+
 @interface DIImperative (Plugin)
 
-@property (strong, nonatomic) NSMutableDictionary<id,NSMutableArray<DIPropertyHolder *> *> *byClass;
-@property (strong, nonatomic) NSMutableDictionary<NSValue *,NSMutableArray<DIPropertyHolder *> *> *byProtocol;
+/**
+ *  Protocols registered by plugins with \c registerPluginProtocol:
+ *
+ *  @return Array of protocols
+ */
++ (NSArray<Protocol *> *)pluginProtocols;
+
+@property (readonly, strong, nonatomic) DIImperativeIndex *index;
+
+/**
+ *  Holders grouped by property class and by protocol as objects, kept for compatibility
+ *  and built on first access, use \c index instead
+ */
+@property (strong, nonatomic) NSMutableDictionary<id,NSMutableArray<DIPropertyHolder *> *> *byClass DEPRECATED_MSG_ATTRIBUTE("Use -[DIImperativeIndex holdersForPropertyClass:]");
+@property (strong, nonatomic) NSMutableDictionary<NSValue *,NSMutableArray<DIPropertyHolder *> *> *byProtocol DEPRECATED_MSG_ATTRIBUTE("Use -[DIImperativeIndex holdersForProtocol:]");
+
+/**
+ *  Check holder was injected in current session
+ */
+- (BOOL)wasInjectedGetter:(DIImperativeHolder *)holder;
+- (BOOL)wasInjectedSetter:(DIImperativeHolder *)holder;
+
+/**
+ *  Mark holder injected or rejected in current session
+ */
+- (void)markHolder:(DIImperativeHolder *)holder injectedGetter:(BOOL)getter injectedSetter:(BOOL)setter;
 
 @end
 
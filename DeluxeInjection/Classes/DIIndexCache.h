@@ -0,0 +1,81 @@
+//
+//  DIIndexCache.h
+//  DeluxeInjection
+//
+//  Copyright (c) 2016 Anton Bukov <k06aaa@gmail.com>
+//
+//  Licensed under the MIT License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  https://opensource.org/licenses/MIT
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "DIScanScope.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class DIPropertyDescriptor;
+
+/**
+ *  Memory-mapped file with marked properties discovered by previous launch. File is valid only
+ *  for the same loaded images and scope, so its key contains scope and \c LC_UUID or modification
+ *  time of every image of scope. All strings are read right from mapped file without copying.
+ */
+@interface DIIndexCache : NSObject
+
+/**
+ *  Make key of currently loaded images of scope
+ *
+ *  @param scope Scope of index
+ *
+ *  @return Key data to be stored in cache file
+ */
++ (NSData *)keyForScope:(DIScanScope *)scope;
+
+/**
+ *  Map cache file and validate it
+ *
+ *  @param path Path of cache file
+ *  @param key  Expected key
+ *
+ *  @return Cache or \c nil if file is missing, broken or has different key
+ */
+- (nullable instancetype)initWithPath:(NSString *)path key:(NSData *)key;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/**
+ *  Number of cached properties
+ */
+@property (readonly, assign, nonatomic) NSUInteger count;
+
+/**
+ *  Enumerate cached properties, strings are valid only inside block
+ *
+ *  @param block Block to be called for every property with names of class, property, getter and setter
+ */
+- (void)enumerateEntries:(void (^)(const char *className, const char *propertyName, const char *getterName, const char *setterName, BOOL metaClass))block;
+
+/**
+ *  Write cache file atomically
+ *
+ *  @param descriptors Descriptors of marked properties
+ *  @param key         Key of loaded images
+ *  @param path        Path of cache file
+ *
+ *  @return \c YES on success
+ */
++ (BOOL)writeDescriptors:(NSArray<DIPropertyDescriptor *> *)descriptors key:(NSData *)key toPath:(NSString *)path;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,236 @@
+//
+//  DIIndexCache.m
+//  DeluxeInjection
+//
+//  Copyright (c) 2016 Anton Bukov <k06aaa@gmail.com>
+//
+//  Licensed under the MIT License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  https://opensource.org/licenses/MIT
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import <fcntl.h>
+#import <mach-o/loader.h>
+#import <objc/runtime.h>
+#import <sys/mman.h>
+#import <sys/stat.h>
+
+#import "DIIndexCache.h"
+#import "DIPropertyIndex.h"
+
+static uint32_t const DIIndexCacheMagic = 0x43494944; // "DIIC"
+static uint32_t const DIIndexCacheVersion = 1;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t keyLength;
+    uint32_t entriesCount;
+    uint32_t stringsLength;
+} DIIndexCacheHeader;
+
+typedef NS_OPTIONS(uint32_t, DIIndexCacheEntryFlags) {
+    DIIndexCacheEntryMetaClass = 1 << 0,
+};
+
+// Names are offsets of null-terminated strings inside strings table
+typedef struct {
+    uint32_t className;
+    uint32_t propertyName;
+    uint32_t getterName;
+    uint32_t setterName;
+    DIIndexCacheEntryFlags flags;
+} DIIndexCacheEntry;
+
+// Key is zero-padded to keep entries aligned
+static NSUInteger DIIndexCachePaddedLength(NSUInteger length) {
+    return (length + 3) / 4 * 4;
+}
+
+static BOOL DIIndexCacheAppendImageUUID(NSMutableData *key, const struct mach_header *header) {
+    BOOL is64 = (header->magic == MH_MAGIC_64 || header->magic == MH_CIGAM_64);
+    const uint8_t *cursor = (const uint8_t *)header + (is64 ? sizeof(struct mach_header_64) : sizeof(struct mach_header));
+    for (uint32_t i = 0; i < header->ncmds; i++) {
+        const struct load_command *command = (const struct load_command *)cursor;
+        if (command->cmd == LC_UUID) {
+            [key appendBytes:((const struct uuid_command *)command)->uuid length:sizeof(uuid_t)];
+            return YES;
+        }
+        cursor += command->cmdsize;
+    }
+    return NO;
+}
+
+//
+
+@interface DIIndexCache ()
+
+@property (assign, nonatomic) const uint8_t *bytes;
+@property (assign, nonatomic) size_t length;
+@property (assign, nonatomic) const DIIndexCacheEntry *entries;
+@property (assign, nonatomic) const char *strings;
+@property (assign, nonatomic) uint32_t stringsLength;
+
+@end
+
+@implementation DIIndexCache
+
++ (NSData *)keyForScope:(DIScanScope *)scope {
+    NSMutableData *key = [NSMutableData data];
+    NSString *scopeKey = [NSString stringWithFormat:@"%@|%@|%d|%d",
+                          [scope.images componentsJoinedByString:@","] ?: @"*",
+                          [scope.classPrefixes componentsJoinedByString:@","] ?: @"*",
+                          scope.includeMetaClasses, scope.usesManifest];
+    [key appendData:[scopeKey dataUsingEncoding:NSUTF8StringEncoding]];
+
+    [scope enumerateImages:^(const char *imageName) {
+        [key appendBytes:imageName length:strlen(imageName) + 1];
+        const struct mach_header *header = DIScanScopeImageHeader(imageName);
+        if (header && DIIndexCacheAppendImageUUID(key, header)) {
+            return;
+        }
+        struct stat info = {0};
+        stat(imageName, &info);
+        int64_t identity[3] = {info.st_mtimespec.tv_sec, info.st_mtimespec.tv_nsec, info.st_size};
+        [key appendBytes:identity length:sizeof(identity)];
+    }];
+    return key;
+}
+
+- (instancetype)initWithPath:(NSString *)path key:(NSData *)key {
+    self = [super init];
+    if (self) {
+        int fd = open(path.fileSystemRepresentation, O_RDONLY);
+        if (fd < 0) {
+            return nil;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(DIIndexCacheHeader)) {
+            close(fd);
+            return nil;
+        }
+        void *bytes = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (bytes == MAP_FAILED) {
+            return nil;
+        }
+        _bytes = bytes;
+        _length = (size_t)info.st_size;
+
+        if (![self validateWithKey:key]) {
+            return nil;
+        }
+    }
+    return self;
+}
+
+- (void)dealloc {
+    if (_bytes) {
+        munmap((void *)_bytes, _length);
+    }
+}
+
+- (BOOL)validateWithKey:(NSData *)key {
+    const DIIndexCacheHeader *header = (const DIIndexCacheHeader *)self.bytes;
+    if (header->magic != DIIndexCacheMagic ||
+        header->version != DIIndexCacheVersion ||
+        header->keyLength != DIIndexCachePaddedLength(key.length)) {
+        return NO;
+    }
+
+    uint64_t expectedLength = sizeof(DIIndexCacheHeader) + (uint64_t)header->keyLength + (uint64_t)header->entriesCount * sizeof(DIIndexCacheEntry) + header->stringsLength;
+    if (expectedLength != self.length) {
+        return NO;
+    }
+
+    const uint8_t *cursor = self.bytes + sizeof(DIIndexCacheHeader);
+    if (memcmp(cursor, key.bytes, key.length) != 0) {
+        return NO;
+    }
+    cursor += header->keyLength;
+
+    self.entries = (const DIIndexCacheEntry *)cursor;
+    self.strings = (const char *)(cursor + header->entriesCount * sizeof(DIIndexCacheEntry));
+    self.stringsLength = header->stringsLength;
+    if (self.stringsLength == 0 || self.strings[self.stringsLength - 1] != '\0') {
+        return NO;
+    }
+    for (uint32_t i = 0; i < header->entriesCount; i++) {
+        const DIIndexCacheEntry *entry = &self.entries[i];
+        if (entry->className >= self.stringsLength ||
+            entry->propertyName >= self.stringsLength ||
+            entry->getterName >= self.stringsLength ||
+            entry->setterName >= self.stringsLength) {
+            return NO;
+        }
+    }
+    _count = header->entriesCount;
+    return YES;
+}
+
+- (void)enumerateEntries:(void (^)(const char *className, const char *propertyName, const char *getterName, const char *setterName, BOOL metaClass))block {
+    for (NSUInteger i = 0; i < self.count; i++) {
+        const DIIndexCacheEntry *entry = &self.entries[i];
+        block(self.strings + entry->className,
+              self.strings + entry->propertyName,
+              self.strings + entry->getterName,
+              self.strings + entry->setterName,
+              (entry->flags & DIIndexCacheEntryMetaClass) != 0);
+    }
+}
+
++ (BOOL)writeDescriptors:(NSArray<DIPropertyDescriptor *> *)descriptors key:(NSData *)key toPath:(NSString *)path {
+    NSMutableData *paddedKey = [key mutableCopy];
+    paddedKey.length = DIIndexCachePaddedLength(key.length);
+
+    NSMutableData *strings = [NSMutableData data];
+    NSMutableDictionary<NSString *, NSNumber *> *offsets = [NSMutableDictionary dictionary];
+    uint32_t (^offsetOf)(NSString *) = ^uint32_t(NSString *string) {
+        NSNumber *offset = offsets[string];
+        if (offset == nil) {
+            offset = @(strings.length);
+            offsets[string] = offset;
+            const char *str = string.UTF8String;
+            [strings appendBytes:str length:strlen(str) + 1];
+        }
+        return offset.unsignedIntValue;
+    };
+
+    NSMutableData *entries = [NSMutableData dataWithCapacity:descriptors.count * sizeof(DIIndexCacheEntry)];
+    for (DIPropertyDescriptor *descriptor in descriptors) {
+        DIIndexCacheEntry entry = {
+            .className = offsetOf(@(class_getName(descriptor.targetClass))),
+            .propertyName = offsetOf(descriptor.propertyName),
+            .getterName = offsetOf(NSStringFromSelector(descriptor.getter)),
+            .setterName = offsetOf(NSStringFromSelector(descriptor.setter)),
+            .flags = class_isMetaClass(descriptor.targetClass) ? DIIndexCacheEntryMetaClass : 0,
+        };
+        [entries appendBytes:&entry length:sizeof(entry)];
+    }
+    if (strings.length == 0) {
+        [strings appendBytes:"" length:1];
+    }
+
+    DIIndexCacheHeader header = {
+        .magic = DIIndexCacheMagic,
+        .version = DIIndexCacheVersion,
+        .keyLength = (uint32_t)paddedKey.length,
+        .entriesCount = (uint32_t)descriptors.count,
+        .stringsLength = (uint32_t)strings.length,
+    };
+    NSMutableData *data = [NSMutableData dataWithBytes:&header length:sizeof(header)];
+    [data appendData:paddedKey];
+    [data appendData:entries];
+    [data appendData:strings];
+    return [data writeToFile:path atomically:YES];
+}
+
+@end
@@ -179,6 +179,14 @@ DIImperativeSetter DIImperativeSetterFromSetter(DISetter getter);
  */
 - (instancetype)getterValueLazyByClass:(Class)lazyClass;
 
+/**
+ *  Set value to be built once per \c DIScope by block, value is shared by all matching properties
+ *  inside scope and released when scope ends, getter returns \c nil outside of any scope
+ *
+ *  @param scopedBlock Block to be called on first access inside every scope
+ */
+- (instancetype)getterValueScoped:(id(^)(void))scopedBlock;
+
 #pragma mark - Property injection value or blocks
 
 /**
@@ -195,6 +203,21 @@ DIImperativeSetter DIImperativeSetterFromSetter(DISetter getter);
  */
 - (instancetype)setterBlock:(DIImperativeSetter)setterBlock;
 
+/**
+ *  Set block creating getter and setter once for every matching property, when injection is resolved,
+ *  instead of calling same getter and setter blocks for all properties on every access
+ *
+ *  @param accessorsBlock Block returning \c nil, \c [DeluxeInjection doNotInject] or array with getter and setter blocks
+ */
+- (instancetype)accessorsBlock:(DIPropertyBlock)accessorsBlock;
+
+/**
+ *  Set storage of values of injected properties without ivar, \c DIAssociationStorageRuntime by default
+ *
+ *  @param storage Storage to be used by injected getters and setters
+ */
+- (instancetype)associationStorage:(DIAssociationStorage)storage;
+
 #pragma mark - Property injection filtering
 
 /**
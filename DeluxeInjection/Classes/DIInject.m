@@ -21,6 +21,10 @@
 
 #import "DIDeluxeInjectionPlugin.h"
 #import "DIImperativePlugin.h"
+#import "DIPrewarmPlugin.h"
+#import "DIScope.h"
+#import "DIStatsPlugin.h"
+#import "DITracePlugin.h"
 
 #import "DIInjectPlugin.h"
 
@@ -35,15 +39,15 @@ DIImperativeSetter DIImperativeSetterMake(DIImperativeSetter setter) {
 }
 
 DIImperativeGetter DIImperativeGetterFromGetter(DIGetter di_getter) {
-    return ^id _Nullable(Class targetClass, SEL getter, NSString *propertyName, Class propertyClass, NSSet<Protocol *> *propertyProtocols, id target, id *ivar, DIOriginalGetter originalGetter) {
+    return DIBlockCopyShape(^id _Nullable(Class targetClass, SEL getter, NSString *propertyName, Class propertyClass, NSSet<Protocol *> *propertyProtocols, id target, id *ivar, DIOriginalGetter originalGetter) {
         return di_getter(target, getter, ivar, originalGetter);
-    };
+    }, di_getter);
 }
 
 DIImperativeSetter DIImperativeSetterFromSetter(DISetter di_setter) {
-    return ^(Class targetClass, SEL setter, NSString *propertyName, Class propertyClass, NSSet<Protocol *> *propertyProtocols, id target, id *ivar, id value, DIOriginalSetter originalSetter) {
+    return DIBlockCopyShape(^(Class targetClass, SEL setter, NSString *propertyName, Class propertyClass, NSSet<Protocol *> *propertyProtocols, id target, id *ivar, id value, DIOriginalSetter originalSetter) {
         return di_setter(target, setter, ivar, value, originalSetter);
-    };
+    }, di_setter);
 }
 
 //
@@ -61,16 +65,15 @@ DIImperativeSetter DIImperativeSetterFromSetter(DISetter di_setter) {
             return nil;
         }
         
-        objc_property_t property = RRClassGetPropertyByName(targetClass, propertyName);
-        if (RRPropertyGetIsWeak(property)) {
+        DIPropertyAttributes attributes;
+        DIPropertyAttributesParse(RRClassGetPropertyByName(targetClass, propertyName), &attributes);
+        if (attributes.flags & DIPropertyAttributeWeak) {
             __weak id weakValue = value;
             return @[DIGetterIfIvarIsNil(^id(id target, SEL cmd) {
                 return weakValue;
             }), [DeluxeInjection doNotInject]];
         } else {
-            return @[DIGetterIfIvarIsNil(^id(id target, SEL cmd) {
-                return value;
-            }), [DeluxeInjection doNotInject]];
+            return @[DIGetterIfIvarIsNilWithValue(value), [DeluxeInjection doNotInject]];
         }
     } conformingProtocols:@[@protocol(DIInject)]];
 }
@@ -105,7 +108,10 @@ DIImperativeSetter DIImperativeSetterFromSetter(DISetter di_setter) {
 @property (assign, nonatomic) Protocol *savedPropertyProtocol;
 @property (copy, nonatomic) DIImperativeGetter savedGetterBlock;
 @property (copy, nonatomic) DIImperativeSetter savedSetterBlock;
+@property (copy, nonatomic) DIPropertyBlock savedAccessorsBlock;
 @property (copy, nonatomic) DIPropertyFilterBlock savedFilterBlock;
+@property (assign, nonatomic) Class savedContainerClass;
+@property (assign, nonatomic) DIAssociationStorage savedStorage;
 
 @end
 
@@ -131,29 +137,22 @@ DIImperativeSetter DIImperativeSetterFromSetter(DISetter di_setter) {
 }
 
 - (instancetype)getterValue:(id)getterValue {
-    return [self getterBlock:^id(Class targetClass, SEL getter, NSString *propertyName, Class propertyClass, NSSet<Protocol *> *propertyProtocols, id target, id *ivar, DIOriginalGetter originalGetter) {
-        if (*ivar == nil) {
-            *ivar = getterValue;
-        }
-        return *ivar;
-    }];
+    return [self getterBlock:DIImperativeGetterFromGetter(DIGetterIfIvarIsNilWithValue(getterValue))];
 }
 
 - (instancetype)getterValueLazy:(id(^)(void))lazyBlock {
-    __block id(^lazyBlockCopy)(void) = [lazyBlock copy];
-    __block id lazyValue = nil;
-    __block dispatch_once_t onceToken = 0;
-    [self getterBlock:^id(Class targetClass, SEL getter, NSString *propertyName, Class propertyClass, NSSet<Protocol *> *propertyProtocols, id target, id *ivar, DIOriginalGetter originalGetter) {
+    DILazyProvider *provider = [[DILazyProvider alloc] initWithBlock:lazyBlock];
+    return [self getterBlock:DILazyProviderAttach(^id(Class targetClass, SEL getter, NSString *propertyName, Class propertyClass, NSSet<Protocol *> *propertyProtocols, id target, id *ivar, DIOriginalGetter originalGetter) {
         if (*ivar == nil) {
-            dispatch_once(&onceToken, ^{
-                lazyValue = lazyBlockCopy();
-                lazyBlockCopy = nil;
-            });
-            *ivar = lazyValue;
+            DIStatsNoteSlowPath();
+            uint64_t traceStart = DITraceBegin();
+            *ivar = [provider value];
+            if (traceStart) {
+                DITraceEnd(traceStart, "lazy", @"lazy value", @{ @"class" : NSStringFromClass(targetClass), @"property" : propertyName });
+            }
         }
         return *ivar;
-    }];
-    return self;
+    }, provider)];
 }
 
 - (instancetype)getterValueLazyByClass:(Class)lazyClass {
@@ -162,6 +161,12 @@ DIImperativeSetter DIImperativeSetterFromSetter(DISetter di_setter) {
     }];
 }
 
+- (instancetype)getterValueScoped:(id(^)(void))scopedBlock {
+    return [self getterBlock:DIImperativeGetterFromGetter(DIGetterScoped(^id(id target, SEL cmd) {
+        return scopedBlock();
+    }))];
+}
+
 - (instancetype)getterBlock:(DIImperativeGetter)getterBlock {
     NSAssert(self.savedGetterBlock == nil, @"You should call getterValue: or getterBlock: only once");
     self.savedGetterBlock = getterBlock;
@@ -174,16 +179,50 @@ DIImperativeSetter DIImperativeSetterFromSetter(DISetter di_setter) {
     return self;
 }
 
+- (instancetype)accessorsBlock:(DIPropertyBlock)accessorsBlock {
+    NSAssert(self.savedGetterBlock == nil && self.savedSetterBlock == nil && self.savedAccessorsBlock == nil, @"You should call accessorsBlock: only once and without getterBlock: or setterBlock:");
+    self.savedAccessorsBlock = accessorsBlock;
+    return self;
+}
+
+- (instancetype)associationStorage:(DIAssociationStorage)storage {
+    self.savedStorage = storage;
+    return self;
+}
+
 - (instancetype)filterBlock:(DIPropertyFilterBlock)filterBlock {
-    NSAssert(self.savedFilterBlock == nil, @"You should call filterContainerClass: or filterBlock: only once");
+    NSAssert(self.savedFilterBlock == nil && self.savedContainerClass == nil, @"You should call filterContainerClass: or filterBlock: only once");
     self.savedFilterBlock = filterBlock;
     return self;
 }
 
 - (instancetype)filterContainerClass:(Class)filterContainerClass {
-    return [self filterBlock:^BOOL(Class targetClass, SEL getter, NSString *propertyName, Class propertyClass, NSSet<Protocol *> *propertyProtocols) {
-        return [targetClass isSubclassOfClass:filterContainerClass];
-    }];
+    NSAssert(self.savedFilterBlock == nil && self.savedContainerClass == nil, @"You should call filterContainerClass: or filterBlock: only once");
+    self.savedContainerClass = filterContainerClass;
+    return self;
+}
+
+- (DIPropertyFilterBlock)matcher {
+    Class savedPropertyClass = self.savedPropertyClass;
+    Protocol *savedPropertyProtocol = self.savedPropertyProtocol;
+    BOOL shouldSkipDIInjectProtocolFilter = self.shouldSkipDIInjectProtocolFilter;
+    DIPropertyFilterBlock savedFilterBlock = self.savedFilterBlock;
+    Class savedContainerClass = self.savedContainerClass;
+    return ^BOOL(Class targetClass, SEL getter, NSString *propertyName, Class propertyClass, NSSet<Protocol *> *propertyProtocols) {
+        if (savedPropertyClass ? (propertyClass != savedPropertyClass) : ![propertyProtocols containsObject:savedPropertyProtocol]) {
+            return NO;
+        }
+        if (!shouldSkipDIInjectProtocolFilter && ![propertyProtocols containsObject:@protocol(DIInject)]) {
+            return NO;
+        }
+        if (savedContainerClass && ![targetClass isSubclassOfClass:savedContainerClass]) {
+            return NO;
+        }
+        if (savedFilterBlock && !savedFilterBlock(targetClass, getter, propertyName, propertyClass, propertyProtocols)) {
+            return NO;
+        }
+        return YES;
+    };
 }
 
 - (void)resolve {
@@ -192,49 +231,114 @@ DIImperativeSetter DIImperativeSetterFromSetter(DISetter di_setter) {
     }
     
     if (self.injector) {
-        NSAssert(self.savedGetterBlock || self.savedSetterBlock, @"You should call getterValue: or getterBlock: or setterBlock:");
+        NSAssert(self.savedGetterBlock || self.savedSetterBlock || self.savedAccessorsBlock, @"You should call getterValue: or getterBlock: or setterBlock: or accessorsBlock:");
     } else {
-        NSAssert(self.savedGetterBlock == nil && self.savedSetterBlock == nil, @"You should NOT call getterValue: or getterBlock: or setterBlock: when trying to reject");
+        NSAssert(self.savedGetterBlock == nil && self.savedSetterBlock == nil && self.savedAccessorsBlock == nil, @"You should NOT call getterValue: or getterBlock: or setterBlock: or accessorsBlock: when trying to reject");
     }
     
-    NSValue *key = [NSValue valueWithPointer:(__bridge void *)(self.savedPropertyProtocol)];
-    NSArray *holders = self.savedPropertyClass ? self.lets.byClass[self.savedPropertyClass] : self.lets.byProtocol[key];
+    uint64_t traceStart = DITraceBegin();
+    DIImperativeIndex *index = self.lets.index;
+    NSIndexSet *indexes = self.savedPropertyClass ? [index holdersForPropertyClass:self.savedPropertyClass] : [index holdersForProtocol:self.savedPropertyProtocol];
+    NSIndexSet *otherIndexes = nil;
+    if (self.savedContainerClass) {
+        // Walk smaller of two sets and check membership in other one
+        NSIndexSet *containerIndexes = [index holdersForContainerClass:self.savedContainerClass];
+        if (containerIndexes.count < indexes.count) {
+            otherIndexes = indexes;
+            indexes = containerIndexes;
+        }
+        else {
+            otherIndexes = containerIndexes;
+        }
+    }
+    DIPropertyFilterBlock matcher = [self matcher];
+    DIImperativeGetter savedGetterBlock = [self.savedGetterBlock copy];
+    DIImperativeSetter savedSetterBlock = [self.savedSetterBlock copy];
+    DIPropertyBlock savedAccessorsBlock = [self.savedAccessorsBlock copy];
+    NSMutableArray<DIPropertyDescriptor *> *injected = [NSMutableArray array];
+    NSUInteger matchedCount = 0;
     
-    for (DIPropertyHolder *holder in holders) {
-        if (!self.shouldSkipDIInjectProtocolFilter && ![holder.propertyProtocols containsObject:@protocol(DIInject)]) {
+    for (NSUInteger i = indexes ? indexes.firstIndex : NSNotFound; i != NSNotFound; i = [indexes indexGreaterThanIndex:i]) {
+        if (otherIndexes && ![otherIndexes containsIndex:i]) {
             continue;
         }
-        if (self.savedFilterBlock && !self.savedFilterBlock(holder.targetClass, holder.getter, holder.propertyName, holder.propertyClass, holder.propertyProtocols)) {
+        DIImperativeHolder *holder = &index.holders[i];
+        Class targetClass = holder->targetClass;
+        Class propertyClass = holder->propertyClass;
+        NSString *propertyName = holder->propertyName;
+        NSSet<Protocol *> *propertyProtocols = holder->propertyProtocols;
+        SEL getter = holder->getter;
+        SEL setter = holder->setter;
+        if (!matcher(targetClass, getter, propertyName, propertyClass, propertyProtocols)) {
             continue;
         }
-        if (self.injector) {
+        matchedCount++;
+        if (self.injector && savedAccessorsBlock) {
+            NSArray *blocks = savedAccessorsBlock(targetClass, getter, setter, propertyName, propertyClass, propertyProtocols);
+            DIGetter getterBlock = (blocks.firstObject != [DeluxeInjection doNotInject]) ? blocks.firstObject : nil;
+            DISetter setterBlock = (blocks.lastObject != [DeluxeInjection doNotInject]) ? blocks.lastObject : nil;
+            if (getterBlock || setterBlock) {
+                [DeluxeInjection inject:targetClass property:holder->property getterBlock:getterBlock setterBlock:setterBlock storage:self.savedStorage];
+                [self.lets markHolder:holder injectedGetter:(getterBlock != nil) injectedSetter:(setterBlock != nil)];
+                [injected addObject:holder->descriptor];
+            }
+        }
+        else if (self.injector) {
             if (self.savedGetterBlock || self.savedSetterBlock) {
-                if (self.savedGetterBlock && holder.wasInjectedGetter) {
-                    NSLog(@"Warning: Reinjecting property getter [%@ %@]", holder.targetClass, NSStringFromSelector(holder.getter));
+                if (self.savedGetterBlock && [self.lets wasInjectedGetter:holder]) {
+                    NSLog(@"Warning: Reinjecting property getter [%@ %@]", targetClass, NSStringFromSelector(getter));
                 }
-                if (self.savedSetterBlock && holder.wasInjectedSetter) {
-                    NSLog(@"Warning: Reinjecting property setter [%@ %@]", holder.targetClass, NSStringFromSelector(holder.setter));
+                if (self.savedSetterBlock && [self.lets wasInjectedSetter:holder]) {
+                    NSLog(@"Warning: Reinjecting property setter [%@ %@]", targetClass, NSStringFromSelector(setter));
                 }
-                DIImperativeGetter savedGetterBlock = [self.savedGetterBlock copy];
-                DIImperativeSetter savedSetterBlock = [self.savedSetterBlock copy];
-                objc_property_t property = RRClassGetPropertyByName(holder.targetClass, holder.propertyName);
-                [DeluxeInjection inject:holder.targetClass property:property getterBlock:!savedGetterBlock ? nil : ^id(id target, SEL cmd, id *ivar, DIOriginalGetter originalGetter) {
-                    return savedGetterBlock(holder.targetClass, holder.getter, holder.propertyName, holder.propertyClass, holder.propertyProtocols, target, ivar, originalGetter);
-                } setterBlock:!savedSetterBlock ? nil : ^void(id target, SEL cmd, id *ivar, id value, DIOriginalSetter originalSetter) {
-                    return savedSetterBlock(holder.targetClass, holder.setter, holder.propertyName, holder.propertyClass, holder.propertyProtocols, target, ivar, value, originalSetter);
-                }];
-                holder.wasInjectedGetter = (self.savedGetterBlock != nil);
-                holder.wasInjectedSetter = (self.savedSetterBlock != nil);
+                [DeluxeInjection inject:targetClass property:holder->property getterBlock:!savedGetterBlock ? nil : DIBlockCopyShape(^id(id target, SEL cmd, id *ivar, DIOriginalGetter originalGetter) {
+                    return savedGetterBlock(targetClass, getter, propertyName, propertyClass, propertyProtocols, target, ivar, originalGetter);
+                }, savedGetterBlock) setterBlock:!savedSetterBlock ? nil : DIBlockCopyShape(^void(id target, SEL cmd, id *ivar, id value, DIOriginalSetter originalSetter) {
+                    return savedSetterBlock(targetClass, setter, propertyName, propertyClass, propertyProtocols, target, ivar, value, originalSetter);
+                }, savedSetterBlock) storage:self.savedStorage];
+                [self.lets markHolder:holder injectedGetter:(self.savedGetterBlock != nil) injectedSetter:(self.savedSetterBlock != nil)];
+                DILazyProviderRegister(savedGetterBlock, targetClass, propertyName);
+                [injected addObject:holder->descriptor];
             }
         }
         else {
-            objc_property_t property = class_getProperty(holder.targetClass, holder.propertyName.UTF8String);
-            [DeluxeInjection reject:holder.targetClass property:property];
-            holder.wasInjectedGetter = NO;
-            holder.wasInjectedSetter = NO;
+            [DeluxeInjection reject:targetClass property:holder->property];
+            [self.lets markHolder:holder injectedGetter:NO injectedSetter:NO];
         }
     }
     
+    // Remember to apply same injection or rejection to classes of images loaded later,
+    // sessions which matched nothing are not remembered to not grow rules on every session
+    NSArray<Protocol *> *ruleProtocols = self.shouldSkipDIInjectProtocolFilter ? [DIImperative pluginProtocols] : @[@protocol(DIInject)];
+    if (matchedCount > 0) {
+        if (self.injector) {
+            [DeluxeInjection recordInjection:^NSArray *(Class targetClass, SEL getter, SEL setter, NSString *propertyName, Class propertyClass, NSSet<Protocol *> *propertyProtocols) {
+                if (!matcher(targetClass, getter, propertyName, propertyClass, propertyProtocols)) {
+                    return nil;
+                }
+                if (savedAccessorsBlock) {
+                    return savedAccessorsBlock(targetClass, getter, setter, propertyName, propertyClass, propertyProtocols);
+                }
+                return @[!savedGetterBlock ? [DeluxeInjection doNotInject] : DIBlockCopyShape(^id(id target, SEL cmd, id *ivar, DIOriginalGetter originalGetter) {
+                             return savedGetterBlock(targetClass, getter, propertyName, propertyClass, propertyProtocols, target, ivar, originalGetter);
+                         }, savedGetterBlock),
+                         !savedSetterBlock ? [DeluxeInjection doNotInject] : DIBlockCopyShape(^void(id target, SEL cmd, id *ivar, id value, DIOriginalSetter originalSetter) {
+                             return savedSetterBlock(targetClass, setter, propertyName, propertyClass, propertyProtocols, target, ivar, value, originalSetter);
+                         }, savedSetterBlock)];
+            } conformingProtocols:ruleProtocols storage:self.savedStorage injected:injected];
+        }
+        else {
+            [DeluxeInjection recordRejection:^BOOL(Class targetClass, NSString *propertyName, Class propertyClass, NSSet<Protocol *> *propertyProtocols) {
+                SEL getter = RRPropertyGetGetter(RRClassGetPropertyByName(targetClass, propertyName));
+                return matcher(targetClass, getter, propertyName, propertyClass, propertyProtocols);
+            } conformingProtocols:ruleProtocols];
+        }
+    }
+    
+    if (traceStart) {
+        NSString *filter = self.savedPropertyClass ? NSStringFromClass(self.savedPropertyClass) : NSStringFromProtocol(self.savedPropertyProtocol);
+        DITraceEnd(traceStart, "imperative", self.injector ? @"resolve inject" : @"resolve reject", @{ @"by" : filter ?: @"", @"properties" : @(matchedCount) });
+    }
     self.resolved = YES;
 }
 
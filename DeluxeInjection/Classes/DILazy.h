@@ -43,6 +43,21 @@ NS_ASSUME_NONNULL_BEGIN
  */
 + (void)injectLazy;
 
+/**
+ *  Inject properties marked with \c <DILazy> protocol storing values of properties without ivar in \c storage
+ *
+ *  @param storage Storage of values, \c DIAssociationStorageSideTable for properties accessed from many threads
+ */
++ (void)injectLazyWithStorage:(DIAssociationStorage)storage;
+
+/**
+ *  Inject properties marked with \c <DILazy> protocol safe for concurrent first access:
+ *  every racing thread creates instance, only one of them is published with compare-and-swap
+ *  to strong ivar or side table slot and returned to all threads, others are released.
+ *  Weak properties and properties with custom accessors are injected the same way as by \c injectLazy.
+ */
++ (void)injectLazyAtomic;
+
 /**
  *  Reject all injections marked explicitly with \c <DILazy> protocol.
  */
@@ -63,6 +78,21 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (void)injectLazy;
 
+/**
+ *  Inject properties marked with \c <DILazy> protocol storing values of properties without ivar in \c storage
+ *
+ *  @param storage Storage of values, \c DIAssociationStorageSideTable for properties accessed from many threads
+ */
+- (void)injectLazyWithStorage:(DIAssociationStorage)storage;
+
+/**
+ *  Inject properties marked with \c <DILazy> protocol safe for concurrent first access:
+ *  every racing thread creates instance, only one of them is published with compare-and-swap
+ *  to strong ivar or side table slot and returned to all threads, others are released.
+ *  Weak properties and properties with custom accessors are injected the same way as by \c injectLazy.
+ */
+- (void)injectLazyAtomic;
+
 /**
  *  Reject all injections marked explicitly with \c <DILazy> protocol.
  */
@@ -28,12 +28,25 @@
 }
 
 + (void)injectLazy {
+    [self injectLazyWithStorage:DIAssociationStorageRuntime];
+}
+
++ (void)injectLazyWithStorage:(DIAssociationStorage)storage {
     [self inject:^NSArray *(Class targetClass, SEL getter, SEL setter, NSString *propertyName, Class propertyClass, NSSet<Protocol *> *propertyProtocols) {
         NSAssert(propertyClass, @"DILazy can not be applied to unknown class (id)");
         return @[DIGetterIfIvarIsNil(^id(id target, SEL cmd) {
             return [[propertyClass alloc] init];
         }), [DeluxeInjection doNotInject]];
-    } conformingProtocols:@[@protocol(DILazy)]];
+    } conformingProtocols:@[@protocol(DILazy)] storage:storage];
+}
+
++ (void)injectLazyAtomic {
+    [self inject:^NSArray *(Class targetClass, SEL getter, SEL setter, NSString *propertyName, Class propertyClass, NSSet<Protocol *> *propertyProtocols) {
+        NSAssert(propertyClass, @"DILazy can not be applied to unknown class (id)");
+        return @[DIGetterIfIvarIsNilAtomic(^id(id target, SEL cmd) {
+            return [[propertyClass alloc] init];
+        }), [DeluxeInjection doNotInject]];
+    } conformingProtocols:@[@protocol(DILazy)] storage:DIAssociationStorageSideTable];
 }
 
 + (void)rejectLazy {
@@ -49,13 +62,27 @@
 @implementation DIImperative (DILazy)
 
 - (void)injectLazy {
-    [[[[self inject] byPropertyProtocol:@protocol(DILazy)] getterBlock:^id(Class targetClass, SEL getter, NSString *propertyName, Class propertyClass, NSSet<Protocol *> *propertyProtocols, id target, id *ivar, DIOriginalGetter originalGetter) {
+    [self injectLazyWithStorage:DIAssociationStorageRuntime];
+}
+
+- (void)injectLazyWithStorage:(DIAssociationStorage)storage {
+    [[[[[self inject] byPropertyProtocol:@protocol(DILazy)] getterBlock:^id(Class targetClass, SEL getter, NSString *propertyName, Class propertyClass, NSSet<Protocol *> *propertyProtocols, id target, id *ivar, DIOriginalGetter originalGetter) {
+        NSAssert(propertyClass, @"DILazy can not be applied to unknown class (id)");
+        if (*ivar == nil) {
+            *ivar = [[propertyClass alloc] init];
+        }
+        return *ivar;
+    }] associationStorage:storage] skipDIInjectProtocolFilter];
+}
+
+- (void)injectLazyAtomic {
+    [[[[[self inject] byPropertyProtocol:@protocol(DILazy)] getterBlock:DIBlockCopyIfNilAtomic(^id(Class targetClass, SEL getter, NSString *propertyName, Class propertyClass, NSSet<Protocol *> *propertyProtocols, id target, id *ivar, DIOriginalGetter originalGetter) {
         NSAssert(propertyClass, @"DILazy can not be applied to unknown class (id)");
         if (*ivar == nil) {
             *ivar = [[propertyClass alloc] init];
         }
         return *ivar;
-    }] skipDIInjectProtocolFilter];
+    })] associationStorage:DIAssociationStorageSideTable] skipDIInjectProtocolFilter];
 }
 
 - (void)rejectLazy {
@@ -0,0 +1,95 @@
+//
+//  DIManifest.h
+//  DeluxeInjection
+//
+//  Copyright (c) 2016 Anton Bukov <k06aaa@gmail.com>
+//
+//  Licensed under the MIT License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  https://opensource.org/licenses/MIT
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef NS_OPTIONS(uint32_t, DIManifestEntryFlags) {
+    DIManifestEntryClassProperty = 1 << 0,
+};
+
+/**
+ *  Record of single marked property emitted to \c __DATA,__di_manifest section of image at compile time
+ */
+typedef struct {
+    const char *className;
+    const char *propertyName;
+    const char *protocolName;
+    const char *_Nullable ivarName;
+    DIManifestEntryFlags flags;
+} DIManifestEntry;
+
+#define DIManifestSegmentName "__DATA"
+#define DIManifestSectionName "__di_manifest"
+
+#define DIManifestEmit(klass, property, protocol, ivar, entryFlags, suffix) \
+    __attribute__((used, section(DIManifestSegmentName "," DIManifestSectionName))) \
+    static DIManifestEntry DIManifestEntry_##klass##_##property##suffix = { \
+        .className = #klass, \
+        .propertyName = #property, \
+        .protocolName = #protocol, \
+        .ivarName = ivar, \
+        .flags = entryFlags, \
+    }
+
+/**
+ *  Register property marked with protocol in image manifest, should be used at file scope of \c .m file,
+ *  for example next to \c @implementation of class. Names are checked by compiler.
+ *
+ *  @code
+ *  DIManifestProperty(MYViewController, settings, DIInject);
+ *  @endcode
+ */
+#define DIManifestProperty(klass, property, protocol) \
+    static __unused void DIManifestCheck_##klass##_##property(klass *object) { \
+        (void)object.property; (void)@protocol(protocol); \
+    } \
+    DIManifestEmit(klass, property, protocol, NULL, 0, )
+
+/**
+ *  Register property marked with protocol in image manifest with name of its ivar,
+ *  index asserts property is backed by this ivar
+ */
+#define DIManifestPropertyIvar(klass, property, protocol, ivar) \
+    static __unused void DIManifestCheck_##klass##_##property(klass *object) { \
+        (void)object.property; (void)@protocol(protocol); \
+    } \
+    DIManifestEmit(klass, property, protocol, #ivar, 0, )
+
+/**
+ *  Register class property marked with protocol in image manifest
+ */
+#define DIManifestClassProperty(klass, property, protocol) \
+    static __unused void DIManifestCheck_##klass##_##property##_class(void) { \
+        (void)klass.property; (void)@protocol(protocol); \
+    } \
+    DIManifestEmit(klass, property, protocol, NULL, DIManifestEntryClassProperty, _class)
+
+/**
+ *  Enumerate manifest records of loaded image
+ *
+ *  @param imageName Path of image as returned by \c dladdr() or \c class_getImageName()
+ *  @param block     Block to be called for every record
+ *
+ *  @return \c NO if image has no manifest section
+ */
+BOOL DIManifestEnumerateImage(const char *imageName, void (^block)(const DIManifestEntry *entry));
+
+NS_ASSUME_NONNULL_END
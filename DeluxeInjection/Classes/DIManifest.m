@@ -0,0 +1,47 @@
+//
+//  DIManifest.m
+//  DeluxeInjection
+//
+//  Copyright (c) 2016 Anton Bukov <k06aaa@gmail.com>
+//
+//  Licensed under the MIT License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  https://opensource.org/licenses/MIT
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import <mach-o/getsect.h>
+
+#import "DIManifest.h"
+#import "DIScanScope.h"
+
+#ifdef __LP64__
+typedef struct mach_header_64 DIMachHeader;
+#else
+typedef struct mach_header DIMachHeader;
+#endif
+
+BOOL DIManifestEnumerateImage(const char *imageName, void (^block)(const DIManifestEntry *entry)) {
+    const DIMachHeader *header = (const DIMachHeader *)DIScanScopeImageHeader(imageName);
+    if (header == NULL) {
+        return NO;
+    }
+
+    unsigned long size = 0;
+    const DIManifestEntry *entries = (const DIManifestEntry *)getsectiondata(header, DIManifestSegmentName, DIManifestSectionName, &size);
+    if (entries == NULL || size < sizeof(DIManifestEntry)) {
+        return NO;
+    }
+
+    for (NSUInteger i = 0; i < size / sizeof(DIManifestEntry); i++) {
+        block(&entries[i]);
+    }
+    return YES;
+}
@@ -0,0 +1,66 @@
+//
+//  DIMappedStorage.h
+//  DeluxeInjection
+//
+//  Copyright (c) 2016 Anton Bukov <k06aaa@gmail.com>
+//
+//  Licensed under the MIT License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  https://opensource.org/licenses/MIT
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "DIDefaultsStorage.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ *  Defaults storage backed by memory-mapped append-only file.
+ *  Every change is appended as new record, so writes are cheap and do not rewrite other values.
+ *  \c NSData values are returned without copying bytes of mapped file, other property list objects
+ *  are decoded from mapped bytes. File is compacted when most of it is taken by outdated records.
+ *  Changes survive crash of process immediately, but survive crash of system only after \c synchronize.
+ */
+@interface DIMappedStorage : NSObject <DIDefaultsStorage>
+
+/**
+ *  Path of storage file
+ */
+@property (readonly, copy, nonatomic) NSString *path;
+
+/**
+ *  Size of file part taken by records, including outdated ones
+ */
+@property (readonly, assign, nonatomic) NSUInteger usedLength;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/**
+ *  Open storage file or create new one, incomplete record at the end of file is dropped
+ *
+ *  @param path  Path of storage file
+ *  @param error Error of file opening or reading
+ *
+ *  @return Storage or \c nil on error
+ */
+- (nullable instancetype)initWithPath:(NSString *)path error:(NSError **)error NS_DESIGNATED_INITIALIZER;
+
+/**
+ *  Rewrite file with latest records only, called automatically when outdated records take most of file
+ *
+ *  @return \c YES on success
+ */
+- (BOOL)compact;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,417 @@
+//
+//  DIMappedStorage.m
+//  DeluxeInjection
+//
+//  Copyright (c) 2016 Anton Bukov <k06aaa@gmail.com>
+//
+//  Licensed under the MIT License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  https://opensource.org/licenses/MIT
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import <fcntl.h>
+#import <pthread.h>
+#import <sys/mman.h>
+#import <sys/stat.h>
+#import <unistd.h>
+
+#import "DIMappedStorage.h"
+
+//
+// File layout:
+//   header: uint32 magic, uint32 version, uint64 used length
+//   record: uint32 key length, uint32 value length, uint8 type, key bytes, value bytes
+// Record is committed by updating used length in header after record bytes are written.
+// Both are written through shared mapping, so they survive crash of process, but order in which
+// system writes them to disk is not defined: durability on system crash comes only from synchronize.
+//
+
+static uint32_t const DIMappedStorageMagic = 0x534D4944; // "DIMS"
+static uint32_t const DIMappedStorageVersion = 1;
+static size_t const DIMappedStorageHeaderSize = 16;
+static size_t const DIMappedStorageRecordHeaderSize = 9;
+static size_t const DIMappedStorageInitialCapacity = 16 * 1024;
+static size_t const DIMappedStorageCompactionThreshold = 64 * 1024;
+
+typedef NS_ENUM(uint8_t, DIMappedStorageValueType) {
+    DIMappedStorageValueTypeRemoved = 0,
+    DIMappedStorageValueTypePropertyList = 1,
+    DIMappedStorageValueTypeData = 2,
+};
+
+/**
+ *  Mapped part of file, unmapped only after all values referencing its bytes are released
+ */
+@interface DIMappedRegion : NSObject {
+@public
+    uint8_t *bytes;
+    size_t size;
+}
+
+@end
+
+@implementation DIMappedRegion
+
+- (void)dealloc {
+    if (bytes) {
+        munmap(bytes, size);
+    }
+}
+
+@end
+
+/**
+ *  Value bytes inside mapped region, keeps region mapped while alive
+ */
+@interface DIMappedData : NSData {
+    DIMappedRegion *_region;
+    const void *_bytes;
+    NSUInteger _length;
+}
+
+@end
+
+@implementation DIMappedData
+
+- (instancetype)initWithRegion:(DIMappedRegion *)region offset:(size_t)offset length:(NSUInteger)length {
+    self = [super init];
+    if (self) {
+        _region = region;
+        _bytes = region->bytes + offset;
+        _length = length;
+    }
+    return self;
+}
+
+- (const void *)bytes {
+    return _bytes;
+}
+
+- (NSUInteger)length {
+    return _length;
+}
+
+@end
+
+//
+
+@interface DIMappedStorage () {
+    pthread_mutex_t _mutex;
+    int _fd;
+}
+
+@property (copy, nonatomic) NSString *path;
+@property (strong, nonatomic) DIMappedRegion *region;
+@property (strong, nonatomic) NSMutableDictionary<NSString *, NSValue *> *records;
+@property (assign, nonatomic) NSUInteger usedLength;
+@property (assign, nonatomic) NSUInteger liveLength;
+
+@end
+
+@implementation DIMappedStorage
+
+- (instancetype)initWithPath:(NSString *)path error:(NSError **)error {
+    self = [super init];
+    if (self) {
+        pthread_mutex_init(&_mutex, NULL);
+        _path = [path copy];
+        _fd = -1;
+        if (![self openWithError:error]) {
+            return nil;
+        }
+    }
+    return self;
+}
+
+- (void)dealloc {
+    if (_fd >= 0) {
+        close(_fd);
+    }
+    pthread_mutex_destroy(&_mutex);
+}
+
+#pragma mark - Private
+
+static NSError *DIMappedStorageError(NSString *path) {
+    return [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:@{ NSFilePathErrorKey : path }];
+}
+
+- (BOOL)openWithError:(NSError **)error {
+    _fd = open(self.path.fileSystemRepresentation, O_RDWR | O_CREAT, 0644);
+    if (_fd < 0) {
+        if (error) {
+            *error = DIMappedStorageError(self.path);
+        }
+        return NO;
+    }
+
+    struct stat info;
+    if (fstat(_fd, &info) != 0) {
+        if (error) {
+            *error = DIMappedStorageError(self.path);
+        }
+        return NO;
+    }
+
+    BOOL created = (info.st_size < (off_t)DIMappedStorageHeaderSize);
+    size_t capacity = MAX((size_t)info.st_size, DIMappedStorageInitialCapacity);
+    if (![self mapCapacity:capacity]) {
+        if (error) {
+            *error = DIMappedStorageError(self.path);
+        }
+        return NO;
+    }
+
+    uint8_t *bytes = self.region->bytes;
+    if (created) {
+        memcpy(bytes, &DIMappedStorageMagic, 4);
+        memcpy(bytes + 4, &DIMappedStorageVersion, 4);
+        [self commitUsedLength:DIMappedStorageHeaderSize];
+    }
+    else {
+        uint32_t magic;
+        uint32_t version;
+        memcpy(&magic, bytes, 4);
+        memcpy(&version, bytes + 4, 4);
+        if (magic != DIMappedStorageMagic || version > DIMappedStorageVersion) {
+            if (error) {
+                *error = [NSError errorWithDomain:NSCocoaErrorDomain code:NSFileReadCorruptFileError userInfo:@{ NSFilePathErrorKey : self.path }];
+            }
+            return NO;
+        }
+    }
+
+    [self loadRecords];
+    return YES;
+}
+
+- (nullable DIMappedRegion *)regionWithCapacity:(size_t)capacity fd:(int)fd {
+    if (ftruncate(fd, (off_t)capacity) != 0) {
+        return nil;
+    }
+    void *bytes = mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (bytes == MAP_FAILED) {
+        return nil;
+    }
+    DIMappedRegion *region = [[DIMappedRegion alloc] init];
+    region->bytes = bytes;
+    region->size = capacity;
+    return region;
+}
+
+- (BOOL)mapCapacity:(size_t)capacity {
+    DIMappedRegion *region = [self regionWithCapacity:capacity fd:_fd];
+    if (region == nil) {
+        return NO;
+    }
+    self.region = region;
+    return YES;
+}
+
+/**
+ *  Publish records written below \c usedLength, header is not ordered with record bytes on disk
+ *  until \c synchronize, which flushes both
+ */
+- (void)commitUsedLength:(NSUInteger)usedLength {
+    uint64_t length = usedLength;
+    memcpy(self.region->bytes + 8, &length, 8);
+    self.usedLength = usedLength;
+}
+
+- (void)loadRecords {
+    uint8_t *bytes = self.region->bytes;
+    uint64_t committedLength;
+    memcpy(&committedLength, bytes + 8, 8);
+    size_t end = (size_t)MIN(committedLength, (uint64_t)self.region->size);
+
+    self.records = [NSMutableDictionary dictionary];
+    self.liveLength = 0;
+    size_t offset = DIMappedStorageHeaderSize;
+    while (offset + DIMappedStorageRecordHeaderSize <= end) {
+        uint32_t keyLength;
+        uint32_t valueLength;
+        memcpy(&keyLength, bytes + offset, 4);
+        memcpy(&valueLength, bytes + offset + 4, 4);
+        size_t recordLength = DIMappedStorageRecordHeaderSize + keyLength + valueLength;
+        if (offset + recordLength > end) {
+            break; // Incomplete record
+        }
+        NSString *key = [[NSString alloc] initWithBytes:bytes + offset + DIMappedStorageRecordHeaderSize length:keyLength encoding:NSUTF8StringEncoding];
+        if (key) {
+            [self replaceRecordForKey:key offset:offset length:recordLength];
+        }
+        offset += recordLength;
+    }
+    [self commitUsedLength:offset];
+}
+
+- (void)replaceRecordForKey:(NSString *)key offset:(size_t)offset length:(size_t)length {
+    NSValue *oldRecord = self.records[key];
+    if (oldRecord) {
+        self.liveLength -= oldRecord.rangeValue.length;
+    }
+
+    DIMappedStorageValueType type = self.region->bytes[offset + 8];
+    if (type == DIMappedStorageValueTypeRemoved) {
+        [self.records removeObjectForKey:key];
+        return;
+    }
+    self.records[key] = [NSValue valueWithRange:NSMakeRange(offset, length)];
+    self.liveLength += length;
+}
+
+- (BOOL)appendKey:(NSData *)keyData type:(DIMappedStorageValueType)type value:(NSData *)valueData {
+    size_t recordLength = DIMappedStorageRecordHeaderSize + keyData.length + valueData.length;
+    size_t offset = self.usedLength;
+    if (offset + recordLength > self.region->size) {
+        size_t capacity = self.region->size;
+        while (offset + recordLength > capacity) {
+            capacity *= 2;
+        }
+        if (![self mapCapacity:capacity]) {
+            return NO;
+        }
+    }
+
+    uint8_t *bytes = self.region->bytes + offset;
+    uint32_t keyLength = (uint32_t)keyData.length;
+    uint32_t valueLength = (uint32_t)valueData.length;
+    memcpy(bytes, &keyLength, 4);
+    memcpy(bytes + 4, &valueLength, 4);
+    bytes[8] = type;
+    memcpy(bytes + DIMappedStorageRecordHeaderSize, keyData.bytes, keyLength);
+    memcpy(bytes + DIMappedStorageRecordHeaderSize + keyLength, valueData.bytes, valueLength);
+    [self commitUsedLength:offset + recordLength];
+
+    NSString *key = [[NSString alloc] initWithData:keyData encoding:NSUTF8StringEncoding];
+    [self replaceRecordForKey:key offset:offset length:recordLength];
+    return YES;
+}
+
+- (BOOL)needsCompaction {
+    NSUInteger wasted = self.usedLength - DIMappedStorageHeaderSize - self.liveLength;
+    return self.usedLength > DIMappedStorageCompactionThreshold && wasted > self.liveLength;
+}
+
+- (BOOL)compactLocked {
+    NSString *compactPath = [self.path stringByAppendingString:@".compact"];
+    int fd = open(compactPath.fileSystemRepresentation, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return NO;
+    }
+
+    // Write live records in order of their offsets to keep order of changes
+    NSArray<NSValue *> *records = [self.records.allValues sortedArrayUsingComparator:^NSComparisonResult(NSValue *a, NSValue *b) {
+        return [@(a.rangeValue.location) compare:@(b.rangeValue.location)];
+    }];
+    uint64_t usedLength = DIMappedStorageHeaderSize + self.liveLength;
+    NSMutableData *data = [NSMutableData dataWithCapacity:(NSUInteger)usedLength];
+    [data appendBytes:&DIMappedStorageMagic length:4];
+    [data appendBytes:&DIMappedStorageVersion length:4];
+    [data appendBytes:&usedLength length:8];
+    for (NSValue *record in records) {
+        NSRange range = record.rangeValue;
+        [data appendBytes:self.region->bytes + range.location length:range.length];
+    }
+
+    // New file is mapped before replacing old one, so failure leaves storage on old file and old mapping
+    DIMappedRegion *region = nil;
+    BOOL success = (write(fd, data.bytes, data.length) == (ssize_t)data.length && fsync(fd) == 0);
+    if (success) {
+        region = [self regionWithCapacity:MAX((size_t)usedLength * 2, DIMappedStorageInitialCapacity) fd:fd];
+        success = (region != nil);
+    }
+    if (success) {
+        success = (rename(compactPath.fileSystemRepresentation, self.path.fileSystemRepresentation) == 0);
+    }
+    if (!success) {
+        close(fd);
+        unlink(compactPath.fileSystemRepresentation);
+        return NO;
+    }
+
+    close(_fd);
+    _fd = fd;
+    self.region = region;
+    [self loadRecords];
+    return YES;
+}
+
+#pragma mark - Public
+
+- (BOOL)compact {
+    pthread_mutex_lock(&_mutex);
+    BOOL success = [self compactLocked];
+    pthread_mutex_unlock(&_mutex);
+    return success;
+}
+
+#pragma mark - DIDefaultsStorage
+
+- (id)objectForKey:(NSString *)key {
+    pthread_mutex_lock(&_mutex);
+    NSValue *record = self.records[key];
+    if (record == nil) {
+        pthread_mutex_unlock(&_mutex);
+        return nil;
+    }
+
+    NSRange range = record.rangeValue;
+    DIMappedRegion *region = self.region;
+    uint32_t keyLength;
+    memcpy(&keyLength, region->bytes + range.location, 4);
+    DIMappedStorageValueType type = region->bytes[range.location + 8];
+    size_t valueOffset = range.location + DIMappedStorageRecordHeaderSize + keyLength;
+    size_t valueLength = range.length - DIMappedStorageRecordHeaderSize - keyLength;
+    pthread_mutex_unlock(&_mutex);
+
+    // Records are never overwritten, so bytes can be used without copying
+    NSData *data = [[DIMappedData alloc] initWithRegion:region offset:valueOffset length:valueLength];
+    if (type == DIMappedStorageValueTypeData) {
+        return data;
+    }
+    return [NSPropertyListSerialization propertyListWithData:data options:NSPropertyListImmutable format:NULL error:NULL];
+}
+
+- (void)setObject:(id)value forKey:(NSString *)key {
+    NSData *keyData = [key dataUsingEncoding:NSUTF8StringEncoding];
+    DIMappedStorageValueType type = DIMappedStorageValueTypeRemoved;
+    NSData *valueData = [NSData data];
+    if ([value isKindOfClass:[NSData class]]) {
+        type = DIMappedStorageValueTypeData;
+        valueData = value;
+    }
+    else if (value) {
+        type = DIMappedStorageValueTypePropertyList;
+        valueData = [NSPropertyListSerialization dataWithPropertyList:value format:NSPropertyListBinaryFormat_v1_0 options:0 error:NULL];
+        NSAssert(valueData, @"DIMappedStorage can store property list objects only");
+        if (valueData == nil) {
+            return;
+        }
+    }
+
+    pthread_mutex_lock(&_mutex);
+    if ([self appendKey:keyData type:type value:valueData] && [self needsCompaction]) {
+        [self compactLocked];
+    }
+    pthread_mutex_unlock(&_mutex);
+
+    [[NSNotificationCenter defaultCenter] postNotificationName:DIDefaultsStorageDidChangeNotification object:self];
+}
+
+- (BOOL)synchronize {
+    pthread_mutex_lock(&_mutex);
+    BOOL success = (msync(self.region->bytes, self.usedLength, MS_SYNC) == 0);
+    pthread_mutex_unlock(&_mutex);
+    return success;
+}
+
+@end
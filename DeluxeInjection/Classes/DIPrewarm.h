@@ -0,0 +1,120 @@
+//
+//  DIPrewarm.h
+//  DeluxeInjection
+//
+//  Copyright (c) 2016 Anton Bukov <k06aaa@gmail.com>
+//
+//  Licensed under the MIT License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  https://opensource.org/licenses/MIT
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import "DIDeluxeInjection.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef NS_ENUM(NSInteger, DIPrewarmState) {
+    DIPrewarmStateScheduled,
+    DIPrewarmStateInProgress,
+    DIPrewarmStateFinished,
+};
+
+/**
+ *  Prewarming progress of single lazy value, shared by all properties injected with it
+ */
+@interface DIPrewarmEntry : NSObject
+
+/**
+ *  Properties injected with value as \c "Class.property" strings
+ */
+@property (readonly, copy, nonatomic) NSArray<NSString *> *properties;
+
+/**
+ *  Current state of prewarming
+ */
+@property (readonly, assign, nonatomic) DIPrewarmState state;
+
+/**
+ *  Time taken to build value, \c 0 if not built yet
+ */
+@property (readonly, assign, nonatomic) NSTimeInterval buildDuration;
+
+/**
+ *  \c YES if value was built by prewarming and first access was plain read
+ */
+@property (readonly, assign, nonatomic) BOOL finishedInTime;
+
+/**
+ *  \c YES if value was accessed at least once
+ */
+@property (readonly, assign, nonatomic) BOOL accessed;
+
+/**
+ *  Time first access waited for prewarming in progress, \c 0 if access did not wait
+ */
+@property (readonly, assign, nonatomic) NSTimeInterval accessWaitDuration;
+
+@end
+
+//
+
+@interface DeluxeInjection (DIPrewarm)
+
+/**
+ *  Build values of \c getterValueLazy: and \c getterValueLazyByClass: injections of properties
+ *  of given classes and their subclasses on concurrent background queue. Values are built
+ *  in order of classes list, so it works as priority list. Value is built only once,
+ *  first access during prewarming waits for it instead of building own value.
+ *  Should be called right after injection.
+ *
+ *  @param classes Classes in order of priority
+ */
++ (void)prewarmClasses:(NSArray<Class> *)classes;
+
+/**
+ *  Build values of \c getterValueLazy: and \c getterValueLazyByClass: injections
+ *  of given properties of class on concurrent background queue in order of list
+ *
+ *  @param propertyNames Property names in order of priority
+ *  @param klass         Class owning properties
+ */
++ (void)prewarmProperties:(NSArray<NSString *> *)propertyNames ofClass:(Class)klass;
+
+/**
+ *  Access given properties of target on concurrent background queue in order of list,
+ *  builds \c <DILazy> values of already existing object. Properties should be injected
+ *  with \c injectLazyAtomic to keep single value when accessed concurrently.
+ *
+ *  @param propertyNames Property names in order of priority
+ *  @param target        Object owning properties
+ */
++ (void)prewarmProperties:(NSArray<NSString *> *)propertyNames ofTarget:(id)target;
+
+/**
+ *  Wait for all scheduled prewarming to finish
+ *
+ *  @param timeout Maximum time to wait
+ *
+ *  @return \c YES if all prewarming finished
+ */
++ (BOOL)waitForPrewarmWithTimeout:(NSTimeInterval)timeout;
+
+/**
+ *  Progress of all values scheduled for prewarming,
+ *  check \c finishedInTime to find values accessed before they were prewarmed
+ *
+ *  @return Entries in order of scheduling
+ */
++ (NSArray<DIPrewarmEntry *> *)prewarmReport;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,304 @@
+//
+//  DIPrewarm.m
+//  DeluxeInjection
+//
+//  Copyright (c) 2016 Anton Bukov <k06aaa@gmail.com>
+//
+//  Licensed under the MIT License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  https://opensource.org/licenses/MIT
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import <objc/runtime.h>
+#import <stdatomic.h>
+
+#import "DIPrewarm.h"
+#import "DIPrewarmPlugin.h"
+#import "DITracePlugin.h"
+
+@interface DIPrewarmEntry ()
+
+@property (copy, nonatomic) NSArray<NSString *> *properties;
+@property (assign, nonatomic) DIPrewarmState state;
+@property (assign, nonatomic) NSTimeInterval buildDuration;
+@property (assign, nonatomic) BOOL finishedInTime;
+@property (assign, nonatomic) BOOL accessed;
+@property (assign, nonatomic) NSTimeInterval accessWaitDuration;
+
+@end
+
+@implementation DIPrewarmEntry
+
+- (NSString *)description {
+    static NSArray<NSString *> *states;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        states = @[ @"scheduled", @"in progress", @"finished" ];
+    });
+    return [NSString stringWithFormat:@"<%@ %@: %@, built in %.3f sec, %@>",
+            NSStringFromClass([self class]), [self.properties componentsJoinedByString:@", "], states[self.state], self.buildDuration,
+            !self.accessed ? @"not accessed" : self.finishedInTime ? @"in time" : [NSString stringWithFormat:@"access waited %.3f sec", self.accessWaitDuration]];
+}
+
+@end
+
+//
+
+@interface DILazyProvider () {
+    dispatch_once_t _onceToken;
+    _Atomic(BOOL) _built;
+    _Atomic(BOOL) _accessed;
+    _Atomic(BOOL) _scheduled;
+    id (^_block)(void);
+    id _value;
+}
+
+@property (strong, nonatomic) NSMutableArray<NSString *> *properties;
+@property (assign, nonatomic) BOOL started;
+@property (assign, nonatomic) BOOL builtByPrewarm;
+@property (assign, nonatomic) NSTimeInterval buildDuration;
+@property (assign, nonatomic) BOOL finishedInTime;
+@property (assign, nonatomic) NSTimeInterval accessWaitDuration;
+
+@end
+
+@implementation DILazyProvider
+
+- (instancetype)initWithBlock:(id (^)(void))block {
+    self = [super init];
+    if (self) {
+        _block = [block copy];
+        _properties = [NSMutableArray array];
+    }
+    return self;
+}
+
+- (BOOL)markScheduled {
+    return !atomic_exchange(&_scheduled, YES);
+}
+
+- (id)buildValueForPrewarm:(BOOL)prewarm {
+    dispatch_once(&_onceToken, ^{
+        @synchronized(self) {
+            self.started = YES;
+            self.builtByPrewarm = prewarm;
+        }
+        CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+        uint64_t traceStart = DITraceBegin();
+        self->_value = self->_block();
+        self->_block = nil;
+        if (traceStart) {
+            NSString *properties;
+            @synchronized(self) {
+                properties = [self.properties componentsJoinedByString:@","];
+            }
+            DITraceEnd(traceStart, "lazy", prewarm ? @"prewarm build" : @"build", @{ @"properties" : properties });
+        }
+        @synchronized(self) {
+            self.buildDuration = CFAbsoluteTimeGetCurrent() - startTime;
+        }
+        atomic_store_explicit(&self->_built, YES, memory_order_release);
+    });
+    return _value;
+}
+
+- (id)value {
+    BOOL built = atomic_load_explicit(&_built, memory_order_acquire);
+    if (built && atomic_load_explicit(&_accessed, memory_order_relaxed)) {
+        return _value;
+    }
+    
+    CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+    id value = [self buildValueForPrewarm:NO];
+    if (!atomic_exchange(&_accessed, YES)) {
+        @synchronized(self) {
+            self.finishedInTime = built && self.builtByPrewarm;
+            self.accessWaitDuration = (!built && self.builtByPrewarm) ? CFAbsoluteTimeGetCurrent() - startTime : 0;
+        }
+    }
+    return value;
+}
+
+- (DIPrewarmEntry *)entry {
+    DIPrewarmEntry *entry = [[DIPrewarmEntry alloc] init];
+    @synchronized(self) {
+        entry.properties = self.properties;
+        entry.state = atomic_load(&_built) ? DIPrewarmStateFinished : self.started ? DIPrewarmStateInProgress : DIPrewarmStateScheduled;
+        entry.buildDuration = self.buildDuration;
+        entry.finishedInTime = self.finishedInTime;
+        entry.accessed = atomic_load(&_accessed);
+        entry.accessWaitDuration = self.accessWaitDuration;
+    }
+    return entry;
+}
+
+@end
+
+//
+
+static void *DILazyProviderKey = &DILazyProviderKey;
+static NSMutableDictionary<Class, NSMutableDictionary<NSString *, DILazyProvider *> *> *DIPrewarmProviders;
+static NSMutableArray<DILazyProvider *> *DIPrewarmScheduled;
+
+static id DIPrewarmLock() {
+    static id lock;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        lock = [NSObject new];
+        DIPrewarmProviders = [NSMutableDictionary dictionary];
+        DIPrewarmScheduled = [NSMutableArray array];
+    });
+    return lock;
+}
+
+static dispatch_group_t DIPrewarmGroup() {
+    static dispatch_group_t group;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        group = dispatch_group_create();
+    });
+    return group;
+}
+
+id DILazyProviderAttach(id block, DILazyProvider *provider) {
+    id copiedBlock = [block copy];
+    objc_setAssociatedObject(copiedBlock, DILazyProviderKey, provider, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    return copiedBlock;
+}
+
+void DILazyProviderRegister(id block, Class targetClass, NSString *propertyName) {
+    DILazyProvider *provider = block ? objc_getAssociatedObject(block, DILazyProviderKey) : nil;
+    if (provider == nil) {
+        return;
+    }
+    
+    @synchronized(DIPrewarmLock()) {
+        NSMutableDictionary<NSString *, DILazyProvider *> *providers = DIPrewarmProviders[(id)targetClass];
+        if (providers == nil) {
+            providers = [NSMutableDictionary dictionary];
+            DIPrewarmProviders[(id)targetClass] = providers;
+        }
+        providers[propertyName] = provider;
+    }
+    NSString *property = [NSString stringWithFormat:@"%@.%@", targetClass, propertyName];
+    @synchronized(provider) {
+        if (![provider.properties containsObject:property]) {
+            [provider.properties addObject:property];
+        }
+    }
+}
+
+void DILazyProviderUnregister(Class targetClass, NSString *propertyName) {
+    @synchronized(DIPrewarmLock()) {
+        NSMutableDictionary<NSString *, DILazyProvider *> *providers = DIPrewarmProviders[(id)targetClass];
+        DILazyProvider *provider = providers[propertyName];
+        if (provider == nil) {
+            return;
+        }
+        [providers removeObjectForKey:propertyName];
+        if (providers.count == 0) {
+            [DIPrewarmProviders removeObjectForKey:(id)targetClass];
+        }
+        
+        // Provider and its value are released when no more properties use it
+        NSString *property = [NSString stringWithFormat:@"%@.%@", targetClass, propertyName];
+        BOOL unused;
+        @synchronized(provider) {
+            [provider.properties removeObject:property];
+            unused = (provider.properties.count == 0);
+        }
+        if (unused) {
+            [DIPrewarmScheduled removeObjectIdenticalTo:provider];
+        }
+    }
+}
+
+/**
+ *  Build values on concurrent queue, values are started in order of list and scheduled only once
+ */
+static void DIPrewarmSchedule(NSArray<DILazyProvider *> *providers) {
+    dispatch_queue_t queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+    for (DILazyProvider *provider in providers) {
+        @synchronized(DIPrewarmLock()) {
+            if (![provider markScheduled]) {
+                continue;
+            }
+            [DIPrewarmScheduled addObject:provider];
+        }
+        dispatch_group_async(DIPrewarmGroup(), queue, ^{
+            [provider buildValueForPrewarm:YES];
+        });
+    }
+}
+
+@implementation DeluxeInjection (DIPrewarm)
+
++ (void)prewarmClasses:(NSArray<Class> *)classes {
+    NSMutableArray<DILazyProvider *> *providers = [NSMutableArray array];
+    @synchronized(DIPrewarmLock()) {
+        for (Class klass in classes) {
+            for (Class targetClass in DIPrewarmProviders) {
+                if (![targetClass isSubclassOfClass:klass]) {
+                    continue;
+                }
+                for (DILazyProvider *provider in DIPrewarmProviders[targetClass].allValues) {
+                    if ([providers indexOfObjectIdenticalTo:provider] == NSNotFound) {
+                        [providers addObject:provider];
+                    }
+                }
+            }
+        }
+    }
+    DIPrewarmSchedule(providers);
+}
+
++ (void)prewarmProperties:(NSArray<NSString *> *)propertyNames ofClass:(Class)klass {
+    NSMutableArray<DILazyProvider *> *providers = [NSMutableArray array];
+    @synchronized(DIPrewarmLock()) {
+        for (NSString *propertyName in propertyNames) {
+            for (Class targetClass = klass; targetClass; targetClass = class_getSuperclass(targetClass)) {
+                DILazyProvider *provider = DIPrewarmProviders[(id)targetClass][propertyName];
+                if (provider) {
+                    [providers addObject:provider];
+                    break;
+                }
+            }
+        }
+    }
+    DIPrewarmSchedule(providers);
+}
+
++ (void)prewarmProperties:(NSArray<NSString *> *)propertyNames ofTarget:(id)target {
+    dispatch_queue_t queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+    for (NSString *propertyName in propertyNames) {
+        dispatch_group_async(DIPrewarmGroup(), queue, ^{
+            [target valueForKey:propertyName];
+        });
+    }
+}
+
++ (BOOL)waitForPrewarmWithTimeout:(NSTimeInterval)timeout {
+    return dispatch_group_wait(DIPrewarmGroup(), dispatch_time(DISPATCH_TIME_NOW, (int64_t)(timeout * NSEC_PER_SEC))) == 0;
+}
+
++ (NSArray<DIPrewarmEntry *> *)prewarmReport {
+    NSArray<DILazyProvider *> *providers;
+    @synchronized(DIPrewarmLock()) {
+        providers = [DIPrewarmScheduled copy];
+    }
+    NSMutableArray<DIPrewarmEntry *> *entries = [NSMutableArray arrayWithCapacity:providers.count];
+    for (DILazyProvider *provider in providers) {
+        [entries addObject:[provider entry]];
+    }
+    return entries;
+}
+
+@end
@@ -0,0 +1,68 @@
+//
+//  DIPrewarmPlugin.h
+//  DeluxeInjection
+//
+//  Copyright (c) 2016 Anton Bukov <k06aaa@gmail.com>
+//
+//  Licensed under the MIT License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  https://opensource.org/licenses/MIT
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ *  Value built once by block, shared by all properties injected with it and available for prewarming
+ */
+@interface DILazyProvider : NSObject
+
+- (instancetype)init NS_UNAVAILABLE;
+- (instancetype)initWithBlock:(id (^)(void))block NS_DESIGNATED_INITIALIZER;
+
+/**
+ *  Get value building it on first call, concurrent calls wait for single build
+ *
+ *  @return Built value
+ */
+- (nullable id)value;
+
+@end
+
+/**
+ *  Attach provider to getter block built around it
+ *
+ *  @param block    Getter block returning provider value
+ *  @param provider Provider of value
+ *
+ *  @return Block itself
+ */
+id DILazyProviderAttach(id block, DILazyProvider *provider);
+
+/**
+ *  Remember property injected with getter block having attached provider to be able to prewarm it
+ *
+ *  @param block        Getter block injected into property
+ *  @param targetClass  Class owning property
+ *  @param propertyName Name of property
+ */
+void DILazyProviderRegister(id _Nullable block, Class targetClass, NSString *propertyName);
+
+/**
+ *  Forget provider of property being rejected or injected again, so it is not prewarmed and reported anymore
+ *
+ *  @param targetClass  Class owning property
+ *  @param propertyName Name of property
+ */
+void DILazyProviderUnregister(Class targetClass, NSString *propertyName);
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,100 @@
+//
+//  DIPropertyAttributes.h
+//  DeluxeInjection
+//
+//  Copyright (c) 2016 Anton Bukov <k06aaa@gmail.com>
+//
+//  Licensed under the MIT License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  https://opensource.org/licenses/MIT
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+
+#import <objc/runtime.h>
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef NS_OPTIONS(uint32_t, DIPropertyAttributeFlags) {
+    DIPropertyAttributeObject    = 1 << 0, // Type is object: @
+    DIPropertyAttributeReadOnly  = 1 << 1, // R
+    DIPropertyAttributeCopy      = 1 << 2, // C
+    DIPropertyAttributeRetain    = 1 << 3, // &
+    DIPropertyAttributeWeak      = 1 << 4, // W
+    DIPropertyAttributeNonatomic = 1 << 5, // N
+    DIPropertyAttributeDynamic   = 1 << 6, // D
+};
+
+/**
+ *  Parsed property attributes, all strings point inside \c property_getAttributes() result and are not null-terminated
+ */
+typedef struct {
+    DIPropertyAttributeFlags flags;
+    const char *_Nullable ivarName;
+    size_t ivarNameLength;
+    const char *_Nullable getterName;
+    size_t getterNameLength;
+    const char *_Nullable setterName;
+    size_t setterNameLength;
+    __unsafe_unretained Class _Nullable propertyClass;
+    __unsafe_unretained NSSet<Protocol *> *propertyProtocols;
+} DIPropertyAttributes;
+
+/**
+ *  Parse property attributes in single pass without heap allocations,
+ *  protocols sets are interned and shared between all properties with same protocols list
+ *
+ *  @param property   Property to parse
+ *  @param attributes Struct to fill
+ */
+void DIPropertyAttributesParse(objc_property_t property, DIPropertyAttributes *attributes);
+
+/**
+ *  Get getter selector of property
+ *
+ *  @param property   Property
+ *  @param attributes Parsed attributes of property
+ *
+ *  @return Custom getter selector or selector with property name
+ */
+SEL DIPropertyAttributesGetGetter(objc_property_t property, const DIPropertyAttributes *attributes);
+
+/**
+ *  Get setter selector of property
+ *
+ *  @param property   Property
+ *  @param attributes Parsed attributes of property
+ *
+ *  @return Custom setter selector or \c set<PropertyName>: selector
+ */
+SEL DIPropertyAttributesGetSetter(objc_property_t property, const DIPropertyAttributes *attributes);
+
+/**
+ *  Get backing instance variable of property
+ *
+ *  @param klass      Class of property
+ *  @param attributes Parsed attributes of property
+ *
+ *  @return Instance variable or \c nil for \c @dynamic properties
+ */
+Ivar _Nullable DIPropertyAttributesGetIvar(Class klass, const DIPropertyAttributes *attributes);
+
+/**
+ *  Get association policy to store property value as associated object
+ *
+ *  @param attributes Parsed attributes of property
+ *
+ *  @return Association policy matching property memory management and atomicity
+ */
+objc_AssociationPolicy DIPropertyAttributesGetAssociationPolicy(const DIPropertyAttributes *attributes);
+
+NS_ASSUME_NONNULL_END
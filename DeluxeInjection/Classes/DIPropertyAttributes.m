@@ -0,0 +1,228 @@
+//
+//  DIPropertyAttributes.m
+//  DeluxeInjection
+//
+//  Copyright (c) 2016 Anton Bukov <k06aaa@gmail.com>
+//
+//  Licensed under the MIT License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  https://opensource.org/licenses/MIT
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+
+#import <pthread.h>
+
+#import "DIPropertyAttributes.h"
+
+#define DIPropertyAttributesBufferSize 256
+
+//
+
+static Boolean DIProtocolsKeyEqual(const void *value1, const void *value2) {
+    return strcmp(value1, value2) == 0;
+}
+
+static CFHashCode DIProtocolsKeyHash(const void *value) {
+    // FNV-1a
+    CFHashCode hash = 2166136261u;
+    for (const unsigned char *str = value; *str; str++) {
+        hash = (hash ^ *str) * 16777619u;
+    }
+    return hash;
+}
+
+static void DIProtocolsAddClosure(NSMutableSet<Protocol *> *protocols, Protocol *protocol) {
+    if ([protocols containsObject:protocol]) {
+        return;
+    }
+    [protocols addObject:protocol];
+
+    unsigned int count = 0;
+    Protocol *__unsafe_unretained *superprotocols = protocol_copyProtocolList(protocol, &count);
+    for (unsigned int i = 0; i < count; i++) {
+        DIProtocolsAddClosure(protocols, superprotocols[i]);
+    }
+    free(superprotocols);
+}
+
+static NSSet<Protocol *> *DIProtocolsCreateClosure(const char *list) {
+    NSMutableSet<Protocol *> *protocols = [NSMutableSet set];
+    for (const char *cursor = strchr(list, '<'); cursor; cursor = strchr(cursor, '<')) {
+        const char *end = strchr(++cursor, '>');
+        if (!end) {
+            break;
+        }
+        char name[DIPropertyAttributesBufferSize];
+        size_t length = MIN((size_t)(end - cursor), sizeof(name) - 1);
+        memcpy(name, cursor, length);
+        name[length] = '\0';
+        Protocol *protocol = objc_getProtocol(name);
+        if (protocol) {
+            DIProtocolsAddClosure(protocols, protocol);
+        }
+        cursor = end + 1;
+    }
+    return [protocols copy];
+}
+
+// Returns interned closure of protocols list like "<A><B>", it is never deallocated
+static NSSet<Protocol *> *DIProtocolsInternedClosure(const char *list, size_t length) {
+    static CFMutableDictionaryRef interned;
+    static NSSet<Protocol *> *emptySet;
+    static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        CFDictionaryKeyCallBacks keyCallBacks = {0, NULL, NULL, NULL, DIProtocolsKeyEqual, DIProtocolsKeyHash};
+        interned = CFDictionaryCreateMutable(kCFAllocatorDefault, 0, &keyCallBacks, &kCFTypeDictionaryValueCallBacks);
+        emptySet = [NSSet set];
+    });
+
+    if (length == 0) {
+        return emptySet;
+    }
+
+    char key[DIPropertyAttributesBufferSize];
+    length = MIN(length, sizeof(key) - 1);
+    memcpy(key, list, length);
+    key[length] = '\0';
+
+    pthread_mutex_lock(&mutex);
+    NSSet<Protocol *> *protocols = (__bridge NSSet *)CFDictionaryGetValue(interned, key);
+    if (protocols == nil) {
+        protocols = DIProtocolsCreateClosure(key);
+        CFDictionarySetValue(interned, strdup(key), (__bridge void *)protocols);
+    }
+    pthread_mutex_unlock(&mutex);
+    return protocols;
+}
+
+static void DIPropertyAttributesParseType(const char *type, size_t length, DIPropertyAttributes *attributes) {
+    if (length == 0 || type[0] != '@') {
+        return;
+    }
+    attributes->flags |= DIPropertyAttributeObject;
+
+    // Object types look like @"ClassName<Protocol1><Protocol2>", @"<Protocol>" or just @ for id
+    if (length < 3 || type[1] != '"') {
+        return;
+    }
+    const char *name = type + 2;
+    const char *end = type + length - 1;
+    const char *protocols = memchr(name, '<', end - name) ?: end;
+
+    if (protocols > name) {
+        char className[DIPropertyAttributesBufferSize];
+        size_t classNameLength = MIN((size_t)(protocols - name), sizeof(className) - 1);
+        memcpy(className, name, classNameLength);
+        className[classNameLength] = '\0';
+        attributes->propertyClass = objc_lookUpClass(className);
+    }
+    attributes->propertyProtocols = DIProtocolsInternedClosure(protocols, end - protocols);
+}
+
+//
+
+void DIPropertyAttributesParse(objc_property_t property, DIPropertyAttributes *attributes) {
+    memset(attributes, 0, sizeof(DIPropertyAttributes));
+    attributes->propertyProtocols = DIProtocolsInternedClosure(NULL, 0);
+
+    for (const char *item = property_getAttributes(property); item && *item; ) {
+        const char *end = strchr(item, ',') ?: item + strlen(item);
+        const char *value = item + 1;
+        size_t valueLength = end - value;
+        switch (*item) {
+            case 'T':
+                DIPropertyAttributesParseType(value, valueLength, attributes);
+                break;
+            case 'V':
+                attributes->ivarName = value;
+                attributes->ivarNameLength = valueLength;
+                break;
+            case 'G':
+                attributes->getterName = value;
+                attributes->getterNameLength = valueLength;
+                break;
+            case 'S':
+                attributes->setterName = value;
+                attributes->setterNameLength = valueLength;
+                break;
+            case 'R':
+                attributes->flags |= DIPropertyAttributeReadOnly;
+                break;
+            case 'C':
+                attributes->flags |= DIPropertyAttributeCopy;
+                break;
+            case '&':
+                attributes->flags |= DIPropertyAttributeRetain;
+                break;
+            case 'W':
+                attributes->flags |= DIPropertyAttributeWeak;
+                break;
+            case 'N':
+                attributes->flags |= DIPropertyAttributeNonatomic;
+                break;
+            case 'D':
+                attributes->flags |= DIPropertyAttributeDynamic;
+                break;
+            default:
+                break;
+        }
+        item = *end ? end + 1 : end;
+    }
+}
+
+SEL DIPropertyAttributesGetGetter(objc_property_t property, const DIPropertyAttributes *attributes) {
+    if (attributes->getterName == NULL) {
+        return sel_registerName(property_getName(property));
+    }
+    char name[DIPropertyAttributesBufferSize];
+    size_t length = MIN(attributes->getterNameLength, sizeof(name) - 1);
+    memcpy(name, attributes->getterName, length);
+    name[length] = '\0';
+    return sel_registerName(name);
+}
+
+SEL DIPropertyAttributesGetSetter(objc_property_t property, const DIPropertyAttributes *attributes) {
+    char name[DIPropertyAttributesBufferSize];
+    if (attributes->setterName) {
+        size_t length = MIN(attributes->setterNameLength, sizeof(name) - 1);
+        memcpy(name, attributes->setterName, length);
+        name[length] = '\0';
+    }
+    else {
+        const char *propertyName = property_getName(property);
+        snprintf(name, sizeof(name), "set%c%s:", toupper(propertyName[0]), propertyName + 1);
+    }
+    return sel_registerName(name);
+}
+
+Ivar DIPropertyAttributesGetIvar(Class klass, const DIPropertyAttributes *attributes) {
+    if (attributes->ivarName == NULL || attributes->ivarNameLength == 0) {
+        return nil;
+    }
+    char name[DIPropertyAttributesBufferSize];
+    size_t length = MIN(attributes->ivarNameLength, sizeof(name) - 1);
+    memcpy(name, attributes->ivarName, length);
+    name[length] = '\0';
+    return class_getInstanceVariable(klass, name);
+}
+
+objc_AssociationPolicy DIPropertyAttributesGetAssociationPolicy(const DIPropertyAttributes *attributes) {
+    BOOL nonatomic = (attributes->flags & DIPropertyAttributeNonatomic) != 0;
+    if (attributes->flags & DIPropertyAttributeCopy) {
+        return nonatomic ? OBJC_ASSOCIATION_COPY_NONATOMIC : OBJC_ASSOCIATION_COPY;
+    }
+    if (attributes->flags & (DIPropertyAttributeRetain | DIPropertyAttributeWeak)) {
+        // Weak values are stored inside retained wrapper
+        return nonatomic ? OBJC_ASSOCIATION_RETAIN_NONATOMIC : OBJC_ASSOCIATION_RETAIN;
+    }
+    return OBJC_ASSOCIATION_ASSIGN;
+}
@@ -0,0 +1,171 @@
+//
+//  DIPropertyIndex.h
+//  DeluxeInjection
+//
+//  Copyright (c) 2016 Anton Bukov <k06aaa@gmail.com>
+//
+//  Licensed under the MIT License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  https://opensource.org/licenses/MIT
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import <objc/runtime.h>
+
+#import <Foundation/Foundation.h>
+
+#import "DIPropertyAttributes.h"
+#import "DIScanScope.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ *  Parsed description of single property of some class, created once and shared by all plugins
+ */
+@interface DIPropertyDescriptor : NSObject
+
+@property (readonly, unsafe_unretained, nonatomic) Class targetClass;
+@property (readonly, assign, nonatomic) objc_property_t property;
+@property (readonly, assign, nonatomic) SEL getter;
+@property (readonly, assign, nonatomic) SEL setter;
+@property (readonly, strong, nonatomic) NSString *propertyName;
+@property (readonly, unsafe_unretained, nonatomic, nullable) Class propertyClass;
+@property (readonly, strong, nonatomic) NSSet<Protocol *> *propertyProtocols;
+@property (readonly, assign, nonatomic) DIPropertyAttributes attributes;
+
+- (instancetype)initWithClass:(Class)klass property:(objc_property_t)property;
+
+/**
+ *  Create descriptor with already known accessors selectors
+ *
+ *  @param klass    Class owning property
+ *  @param property Property of class
+ *  @param getter   Getter selector or \c NULL to take it from property attributes
+ *  @param setter   Setter selector or \c NULL to take it from property attributes
+ *
+ *  @return Descriptor of property
+ */
+- (instancetype)initWithClass:(Class)klass property:(objc_property_t)property getter:(nullable SEL)getter setter:(nullable SEL)setter;
+
+@end
+
+//
+
+/**
+ *  Index of all class properties, built with single runtime scan on first use.
+ *  Properties marked with any \c <DI***> protocol are stored as parsed descriptors
+ *  grouped by marker protocol and by property class, all other properties are stored
+ *  as raw class-property pairs and parsed on demand.
+ */
+@interface DIPropertyIndex : NSObject
+
+/**
+ *  Shared index used by all injection entry points
+ *
+ *  @return Shared index instance
+ */
++ (instancetype)sharedIndex;
+
+/**
+ *  Create index of classes of single loaded image
+ *
+ *  @param imageName Path of image as returned by \c dladdr() or \c class_getImageName()
+ *  @param scope     Scope to filter image classes
+ *
+ *  @return Index of image classes properties
+ */
+- (instancetype)initWithImage:(const char *)imageName scope:(DIScanScope *)scope;
+
+/**
+ *  Scope of classes to be indexed, changing scope drops index, \c [DIScanScope \c defaultScope] by default
+ */
+@property (copy, nonatomic) DIScanScope *scanScope;
+
+/**
+ *  Path of file to keep marked properties between launches, \c nil by default to not use cache.
+ *  Should be set before index is built: valid file replaces runtime scan, otherwise file is rewritten after scan.
+ */
+@property (copy, nonatomic, nullable) NSString *cachePath;
+
+/**
+ *  Number of threads to discover properties while building index,
+ *  \c 0 to use all active processors and \c 1 to build on calling thread only
+ */
+@property (assign, nonatomic) NSUInteger discoveryConcurrency;
+
+/**
+ *  Number incremented every time index is rebuilt or extended with classes of newly loaded image,
+ *  used to invalidate data derived from index
+ */
+@property (readonly, assign, atomic) NSUInteger generation;
+
+/**
+ *  Block to be called after classes of newly loaded image were added to shared index,
+ *  receives index of this image classes only. Called on serial queue out of dyld loader lock.
+ */
+@property (copy, atomic, nullable) void (^didIndexImageBlock)(DIPropertyIndex *imageIndex);
+
+/**
+ *  Add classes registered in runtime after index was built, classes of newly loaded images are added automatically.
+ *  Index of these classes only is passed to \c didIndexImageBlock.
+ *
+ *  @param classes Classes to be indexed
+ */
+- (void)indexClasses:(NSArray<Class> *)classes;
+
+/**
+ *  Wait until \c didIndexImageBlock returns for all already indexed images and classes
+ */
+- (void)waitForIndexedImages;
+
+/**
+ *  Enumerate indexed properties in order of runtime discovery
+ *
+ *  @param protocols Marker protocols to filter properties by or \c nil to enumerate all properties of all classes
+ *  @param block     Block to be called for every matching property
+ */
+- (void)enumerateDescriptorsConformingProtocols:(nullable NSArray<Protocol *> *)protocols usingBlock:(void (^)(DIPropertyDescriptor *descriptor))block;
+
+/**
+ *  Get marked properties by marker protocol
+ *
+ *  @param protocol Protocol explicitly declared on property
+ *
+ *  @return Array of descriptors
+ */
+- (NSArray<DIPropertyDescriptor *> *)descriptorsForProtocol:(Protocol *)protocol;
+
+/**
+ *  Get marked properties by property class
+ *
+ *  @param klass Class of property
+ *
+ *  @return Array of descriptors
+ */
+- (NSArray<DIPropertyDescriptor *> *)descriptorsForPropertyClass:(Class)klass;
+
+/**
+ *  Get indexed descriptor or create new one for unmarked property
+ *
+ *  @param klass    Class owning property
+ *  @param property Property of class
+ *
+ *  @return Descriptor of property
+ */
+- (DIPropertyDescriptor *)descriptorForClass:(Class)klass property:(objc_property_t)property;
+
+/**
+ *  Drop index to rebuild it on next access, useful after registering classes in runtime
+ */
+- (void)invalidate;
+
+@end
+
+NS_ASSUME_NONNULL_END
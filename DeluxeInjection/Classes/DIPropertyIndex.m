@@ -0,0 +1,600 @@
+//
+//  DIPropertyIndex.m
+//  DeluxeInjection
+//
+//  Copyright (c) 2016 Anton Bukov <k06aaa@gmail.com>
+//
+//  Licensed under the MIT License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  https://opensource.org/licenses/MIT
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import <dlfcn.h>
+#import <mach-o/dyld.h>
+
+#import <RuntimeRoutines/RuntimeRoutines.h>
+
+#import "DIIndexCache.h"
+#import "DIManifest.h"
+#import "DIPropertyIndex.h"
+#import "DITracePlugin.h"
+
+//
+
+static NSUInteger const DIPropertyIndexMinClassesPerChunk = 256;
+static NSUInteger const DIPropertyIndexChunksPerThread = 4;
+
+typedef struct {
+    __unsafe_unretained Class klass;
+    objc_property_t property;
+} DIClassProperty;
+
+static void DIPropertyEnumerateDeclaredProtocols(objc_property_t property, void (^block)(Protocol *protocol)) {
+    const char *attributes = property_getAttributes(property);
+    const char *typeEnd = strchr(attributes, ',') ?: attributes + strlen(attributes);
+    for (const char *cursor = strchr(attributes, '<'); cursor && cursor < typeEnd; cursor = strchr(cursor, '<')) {
+        const char *end = strchr(++cursor, '>');
+        if (!end || end > typeEnd) {
+            break;
+        }
+        char name[256];
+        size_t length = MIN((size_t)(end - cursor), sizeof(name) - 1);
+        memcpy(name, cursor, length);
+        name[length] = '\0';
+        Protocol *protocol = objc_getProtocol(name);
+        if (protocol) {
+            block(protocol);
+        }
+        cursor = end + 1;
+    }
+}
+
+static BOOL DIManifestEntryMatchesProperty(const DIManifestEntry *entry, objc_property_t property) {
+    const char *attributes = property_getAttributes(property);
+    char marker[256];
+    snprintf(marker, sizeof(marker), "<%s>", entry->protocolName);
+    if (!strstr(attributes, marker)) {
+        return NO;
+    }
+    if (entry->ivarName) {
+        DIPropertyAttributes parsed;
+        DIPropertyAttributesParse(property, &parsed);
+        return parsed.ivarName &&
+               strlen(entry->ivarName) == parsed.ivarNameLength &&
+               strncmp(entry->ivarName, parsed.ivarName, parsed.ivarNameLength) == 0;
+    }
+    return YES;
+}
+
+static DIPropertyDescriptor *DIPropertyIndexDescriptor(NSMapTable<id, DIPropertyDescriptor *> *descriptorsByProperty, Class klass, objc_property_t property) {
+    DIPropertyDescriptor *descriptor = [descriptorsByProperty objectForKey:(__bridge id)(void *)property];
+    if (descriptor.targetClass == klass) {
+        return descriptor;
+    }
+    return [[DIPropertyDescriptor alloc] initWithClass:klass property:property];
+}
+
+//
+
+@implementation DIPropertyDescriptor
+
+- (instancetype)initWithClass:(Class)klass property:(objc_property_t)property {
+    return [self initWithClass:klass property:property getter:NULL setter:NULL];
+}
+
+- (instancetype)initWithClass:(Class)klass property:(objc_property_t)property getter:(SEL)getter setter:(SEL)setter {
+    self = [super init];
+    if (self) {
+        _targetClass = klass;
+        _property = property;
+        DIPropertyAttributesParse(property, &_attributes);
+        _getter = getter ?: DIPropertyAttributesGetGetter(property, &_attributes);
+        _setter = setter ?: DIPropertyAttributesGetSetter(property, &_attributes);
+        _propertyName = [NSString stringWithUTF8String:property_getName(property)];
+        _propertyClass = _attributes.propertyClass;
+        _propertyProtocols = _attributes.propertyProtocols;
+    }
+    return self;
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %p %@.%@>", [self class], self, self.targetClass, self.propertyName];
+}
+
+@end
+
+//
+
+@interface DIPropertyIndex () {
+    DIClassProperty *_allProperties;
+    NSUInteger _allPropertiesCount;
+    NSUInteger _allPropertiesCapacity;
+}
+
+@property (assign, nonatomic) BOOL built;
+@property (assign, nonatomic) BOOL markedPropertiesOnly;
+@property (assign, nonatomic) BOOL allPropertiesRequired;
+@property (assign, atomic) NSUInteger generation;
+@property (strong, nonatomic) NSMutableArray<DIPropertyDescriptor *> *descriptors;
+@property (strong, nonatomic) NSMapTable<id, DIPropertyDescriptor *> *descriptorsByProperty;
+@property (strong, nonatomic) NSHashTable *indexedClasses;
+@property (strong, nonatomic) NSMutableArray<NSString *> *pendingImages;
+@property (strong, nonatomic) NSMutableArray<Class> *pendingClasses;
+@property (strong, nonatomic) NSMutableDictionary<NSValue *, NSMutableIndexSet *> *byProtocol;
+@property (strong, nonatomic) NSMutableDictionary<id, NSMutableIndexSet *> *byPropertyClass;
+
+@end
+
+//
+
+static __thread BOOL DIPropertyIndexRegistering;
+
+static void *DIPropertyIndexImageQueueKey = &DIPropertyIndexImageQueueKey;
+
+static dispatch_queue_t DIPropertyIndexImageQueue() {
+    static dispatch_queue_t queue;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        queue = dispatch_queue_create("com.deluxeinjection.images", DISPATCH_QUEUE_SERIAL);
+        dispatch_queue_set_specific(queue, DIPropertyIndexImageQueueKey, DIPropertyIndexImageQueueKey, NULL);
+    });
+    return queue;
+}
+
+static void DIPropertyIndexDidAddImage(const struct mach_header *header, intptr_t slide) {
+    // Already loaded images are reported synchronously while registering, they are covered by full scan
+    if (DIPropertyIndexRegistering) {
+        return;
+    }
+
+    // Callback is called on dyld loader thread holding dyld lock, so image is indexed out of it
+    Dl_info info;
+    if (dladdr(header, &info) && info.dli_fname) {
+        char *imageName = strdup(info.dli_fname);
+        dispatch_async(DIPropertyIndexImageQueue(), ^{
+            [[DIPropertyIndex sharedIndex] indexImage:imageName];
+            free(imageName);
+        });
+    }
+}
+
+@implementation DIPropertyIndex
+
++ (instancetype)sharedIndex {
+    static DIPropertyIndex *sharedIndex;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedIndex = [[DIPropertyIndex alloc] init];
+    });
+    return sharedIndex;
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _scanScope = [DIScanScope defaultScope];
+    }
+    return self;
+}
+
+- (instancetype)initWithImage:(const char *)imageName scope:(DIScanScope *)scope {
+    return [self initWithImage:imageName scope:scope manifest:scope.usesManifest];
+}
+
+- (instancetype)initWithImage:(const char *)imageName scope:(DIScanScope *)scope manifest:(BOOL)manifest {
+    self = [super init];
+    if (self) {
+        _scanScope = scope;
+        [self reset];
+        if (!manifest || ![self addManifestOfImage:imageName]) {
+            [scope enumerateClassesOfImage:imageName usingBlock:^(Class klass) {
+                [self addClass:klass];
+            }];
+        }
+        self.built = YES;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(_allProperties);
+}
+
+#pragma mark - Private
+
+- (void)reset {
+    free(_allProperties);
+    _allPropertiesCapacity = 1024;
+    _allPropertiesCount = 0;
+    _allProperties = malloc(_allPropertiesCapacity * sizeof(DIClassProperty));
+
+    self.descriptors = [NSMutableArray array];
+    self.descriptorsByProperty = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsOpaqueMemory | NSPointerFunctionsOpaquePersonality valueOptions:NSPointerFunctionsStrongMemory];
+    self.indexedClasses = [NSHashTable hashTableWithOptions:NSPointerFunctionsOpaqueMemory | NSPointerFunctionsOpaquePersonality];
+    self.byProtocol = [NSMutableDictionary dictionary];
+    self.byPropertyClass = [NSMutableDictionary dictionary];
+}
+
+- (void)buildIfNeeded {
+    // Registration takes dyld lock, so it is done out of index lock.
+    // Images loaded before scan ends are indexed after it on image queue
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        DIPropertyIndexRegistering = YES;
+        _dyld_register_func_for_add_image(DIPropertyIndexDidAddImage);
+        DIPropertyIndexRegistering = NO;
+    });
+
+    NSArray<NSString *> *pendingImages;
+    NSArray<Class> *pendingClasses;
+    @synchronized(self) {
+        if (self.built) {
+            return;
+        }
+
+        uint64_t traceStart = DITraceBegin();
+        NSString *source = [self build];
+        self.built = YES;
+        self.generation++;
+        if (traceStart) {
+            DITraceEnd(traceStart, "index", @"scan", @{ @"source" : source, @"properties" : @(_allPropertiesCount), @"marked" : @(self.descriptors.count) });
+        }
+        pendingImages = self.pendingImages;
+        pendingClasses = self.pendingClasses;
+        self.pendingImages = nil;
+        self.pendingClasses = nil;
+    }
+
+    // Scan has already found classes of images loaded while index was not built,
+    // they are indexed again only to be passed to didIndexImageBlock
+    for (NSString *imageName in pendingImages) {
+        [self indexImage:imageName.UTF8String];
+    }
+    if (pendingClasses.count) {
+        [self indexClasses:pendingClasses];
+    }
+}
+
+/**
+ *  Fill index from cache, manifests or runtime scan
+ *
+ *  @return Source of properties for tracing
+ */
+- (NSString *)build {
+    [self reset];
+    self.markedPropertiesOnly = NO;
+
+    NSData *cacheKey = nil;
+    if (self.cachePath && !self.allPropertiesRequired) {
+        cacheKey = [DIIndexCache keyForScope:self.scanScope];
+        DIIndexCache *cache = [[DIIndexCache alloc] initWithPath:self.cachePath key:cacheKey];
+        if (cache) {
+            [self addCache:cache];
+            self.markedPropertiesOnly = YES;
+            return @"cache";
+        }
+    }
+
+    NSMutableArray<Class> *classes = [NSMutableArray array];
+    if (self.scanScope.usesManifest && !self.allPropertiesRequired) {
+        [self.scanScope enumerateImages:^(const char *imageName) {
+            if ([self addManifestOfImage:imageName]) {
+                self.markedPropertiesOnly = YES;
+                return;
+            }
+            [self.scanScope enumerateClassesOfImage:imageName usingBlock:^(Class klass) {
+                [classes addObject:klass];
+            }];
+        }];
+    }
+    else {
+        [self.scanScope enumerateClasses:^(Class klass) {
+            [classes addObject:klass];
+        }];
+    }
+    [self addClasses:classes];
+    if (cacheKey) {
+        [DIIndexCache writeDescriptors:self.descriptors key:cacheKey toPath:self.cachePath];
+    }
+    return self.markedPropertiesOnly ? @"manifest" : @"runtime";
+}
+
+- (void)addClasses:(NSArray<Class> *)classes {
+    NSUInteger threadsCount = self.discoveryConcurrency ?: [NSProcessInfo processInfo].activeProcessorCount;
+    NSUInteger chunksCount = MIN(threadsCount * DIPropertyIndexChunksPerThread, classes.count / DIPropertyIndexMinClassesPerChunk);
+    if (threadsCount <= 1 || chunksCount <= 1) {
+        for (Class klass in classes) {
+            [self addClass:klass];
+        }
+        return;
+    }
+
+    // Discovery is read-only, so chunks are indexed in parallel
+    // and merged in chunk order to keep order of runtime discovery
+    threadsCount = MIN(threadsCount, chunksCount);
+    NSUInteger chunkSize = (classes.count + chunksCount - 1) / chunksCount;
+    void **chunks = calloc(chunksCount, sizeof(void *));
+    dispatch_apply(threadsCount, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_HIGH, 0), ^(size_t thread) {
+        for (NSUInteger chunk = thread; chunk < chunksCount; chunk += threadsCount) {
+            DIPropertyIndex *chunkIndex = [[DIPropertyIndex alloc] init];
+            [chunkIndex reset];
+            NSUInteger end = MIN((chunk + 1) * chunkSize, classes.count);
+            for (NSUInteger i = chunk * chunkSize; i < end; i++) {
+                [chunkIndex addClass:classes[i]];
+            }
+            chunks[chunk] = (__bridge_retained void *)chunkIndex;
+        }
+    });
+
+    for (NSUInteger chunk = 0; chunk < chunksCount; chunk++) {
+        [self mergeIndex:(__bridge_transfer DIPropertyIndex *)chunks[chunk]];
+    }
+    free(chunks);
+}
+
+- (void)mergeIndex:(DIPropertyIndex *)index {
+    // Classes of image loaded concurrently with full scan may be already indexed
+    NSHashTable *skippedClasses = nil;
+    for (NSUInteger i = 0; i < index->_allPropertiesCount; i++) {
+        Class klass = index->_allProperties[i].klass;
+        if ([self.indexedClasses containsObject:(__bridge id)(void *)klass]) {
+            skippedClasses = skippedClasses ?: [NSHashTable hashTableWithOptions:NSPointerFunctionsOpaqueMemory | NSPointerFunctionsOpaquePersonality];
+            [skippedClasses addObject:(__bridge id)(void *)klass];
+        }
+    }
+
+    for (NSUInteger i = 0; i < index->_allPropertiesCount; i++) {
+        DIClassProperty pair = index->_allProperties[i];
+        if ([skippedClasses containsObject:(__bridge id)(void *)pair.klass]) {
+            continue;
+        }
+        DIPropertyDescriptor *descriptor = [index.descriptorsByProperty objectForKey:(__bridge id)(void *)pair.property];
+        [self addClass:pair.klass property:pair.property descriptor:descriptor];
+    }
+}
+
+- (void)addCache:(DIIndexCache *)cache {
+    // Only names are resolved, no class and property lists are copied
+    [cache enumerateEntries:^(const char *className, const char *propertyName, const char *getterName, const char *setterName, BOOL metaClass) {
+        Class klass = objc_getClass(className);
+        if (klass && metaClass) {
+            klass = object_getClass(klass);
+        }
+        objc_property_t property = klass ? class_getProperty(klass, propertyName) : NULL;
+        if (!property) {
+            return;
+        }
+        DIPropertyDescriptor *descriptor = [[DIPropertyDescriptor alloc] initWithClass:klass property:property getter:sel_registerName(getterName) setter:sel_registerName(setterName)];
+        [self addClass:klass property:property descriptor:descriptor];
+    }];
+}
+
+- (BOOL)addManifestOfImage:(const char *)imageName {
+    DIScanScope *scope = self.scanScope;
+    return DIManifestEnumerateImage(imageName, ^(const DIManifestEntry *entry) {
+        if (![scope containsClassName:entry->className]) {
+            return;
+        }
+        Class klass = objc_getClass(entry->className);
+        if (klass && (entry->flags & DIManifestEntryClassProperty)) {
+            klass = scope.includeMetaClasses ? object_getClass(klass) : nil;
+        }
+        objc_property_t property = klass ? class_getProperty(klass, entry->propertyName) : NULL;
+        if (!property || [self.descriptorsByProperty objectForKey:(__bridge id)(void *)property]) {
+            return;
+        }
+        NSAssert(DIManifestEntryMatchesProperty(entry, property), @"Manifest record %s.%s does not match property declaration", entry->className, entry->propertyName);
+        [self addClass:klass property:property descriptor:nil];
+    });
+}
+
+- (void)addClass:(Class)klass {
+    RRClassEnumerateProperties(klass, ^(objc_property_t property) {
+        [self addClass:klass property:property descriptor:nil];
+    });
+}
+
+- (void)addClass:(Class)klass property:(objc_property_t)property descriptor:(DIPropertyDescriptor *)descriptor {
+    if (_allPropertiesCount == _allPropertiesCapacity) {
+        _allPropertiesCapacity *= 2;
+        _allProperties = realloc(_allProperties, _allPropertiesCapacity * sizeof(DIClassProperty));
+    }
+    _allProperties[_allPropertiesCount++] = (DIClassProperty){klass, property};
+    [self.indexedClasses addObject:(__bridge id)(void *)klass];
+
+    if (descriptor || strstr(property_getAttributes(property), "<DI")) {
+        [self addDescriptor:descriptor ?: [[DIPropertyDescriptor alloc] initWithClass:klass property:property]];
+    }
+}
+
+- (void)addDescriptor:(DIPropertyDescriptor *)descriptor {
+    NSUInteger ordinal = self.descriptors.count;
+    [self.descriptors addObject:descriptor];
+    [self.descriptorsByProperty setObject:descriptor forKey:(__bridge id)(void *)descriptor.property];
+
+    DIPropertyEnumerateDeclaredProtocols(descriptor.property, ^(Protocol *protocol) {
+        NSValue *key = [NSValue valueWithPointer:(__bridge void *)protocol];
+        if (self.byProtocol[key] == nil) {
+            self.byProtocol[key] = [NSMutableIndexSet indexSet];
+        }
+        [self.byProtocol[key] addIndex:ordinal];
+    });
+
+    if (descriptor.propertyClass) {
+        Class propertyClass = descriptor.propertyClass;
+        if (self.byPropertyClass[(id)propertyClass] == nil) {
+            self.byPropertyClass[(id)propertyClass] = [NSMutableIndexSet indexSet];
+        }
+        [self.byPropertyClass[(id)propertyClass] addIndex:ordinal];
+    }
+}
+
+- (void)indexImage:(const char *)imageName {
+    DIPropertyIndex *imageIndex = nil;
+    @synchronized(self) {
+        if (!self.built) {
+            // Index is being rebuilt, image is indexed after that to apply rules to its classes
+            self.pendingImages = self.pendingImages ?: [NSMutableArray array];
+            [self.pendingImages addObject:@(imageName)];
+            return;
+        }
+        if (![self.scanScope containsImage:imageName]) {
+            return;
+        }
+
+        uint64_t traceStart = DITraceBegin();
+        imageIndex = [[DIPropertyIndex alloc] initWithImage:imageName scope:self.scanScope manifest:self.scanScope.usesManifest && !self.allPropertiesRequired];
+        [self mergeIndex:imageIndex];
+        self.generation++;
+        if (traceStart) {
+            DITraceEnd(traceStart, "index", @"scan image", @{ @"image" : @(imageName), @"properties" : @(imageIndex->_allPropertiesCount) });
+        }
+    }
+    [self didIndexImage:imageIndex];
+}
+
+- (void)didIndexImage:(DIPropertyIndex *)imageIndex {
+    void (^didIndexImageBlock)(DIPropertyIndex *) = self.didIndexImageBlock;
+    if (didIndexImageBlock == nil || imageIndex->_allPropertiesCount == 0) {
+        return;
+    }
+
+    // Block is called on image queue only, images are already indexed on it
+    if (dispatch_get_specific(DIPropertyIndexImageQueueKey)) {
+        didIndexImageBlock(imageIndex);
+        return;
+    }
+    dispatch_async(DIPropertyIndexImageQueue(), ^{
+        didIndexImageBlock(imageIndex);
+    });
+}
+
+#pragma mark - Public
+
+- (void)indexClasses:(NSArray<Class> *)classes {
+    DIPropertyIndex *classesIndex = [[DIPropertyIndex alloc] init];
+    [classesIndex reset];
+    for (Class klass in classes) {
+        [classesIndex addClass:klass];
+    }
+    classesIndex.built = YES;
+
+    @synchronized(self) {
+        if (!self.built) {
+            // Classes registered at runtime belong to no image, so they are indexed after rebuild
+            self.pendingClasses = self.pendingClasses ?: [NSMutableArray array];
+            [self.pendingClasses addObjectsFromArray:classes];
+            return;
+        }
+        [self mergeIndex:classesIndex];
+        self.generation++;
+    }
+    [self didIndexImage:classesIndex];
+}
+
+- (void)waitForIndexedImages {
+    dispatch_sync(DIPropertyIndexImageQueue(), ^{});
+}
+
+- (void)enumerateDescriptorsConformingProtocols:(NSArray<Protocol *> *)protocols usingBlock:(void (^)(DIPropertyDescriptor *descriptor))block {
+    if (protocols == nil) {
+        // Manifest and cache list marked properties only, so enumeration of all properties needs runtime scan
+        @synchronized(self) {
+            if (!self.allPropertiesRequired) {
+                self.allPropertiesRequired = YES;
+                if (self.markedPropertiesOnly) {
+                    self.built = NO;
+                }
+            }
+        }
+    }
+    [self buildIfNeeded];
+
+    // Newly loaded images extend index concurrently, so blocks are called for snapshot taken under lock
+    if (protocols == nil) {
+        DIClassProperty *pairs;
+        NSUInteger pairsCount;
+        NSMapTable<id, DIPropertyDescriptor *> *descriptorsByProperty;
+        @synchronized(self) {
+            pairsCount = _allPropertiesCount;
+            pairs = malloc(MAX(pairsCount, (NSUInteger)1) * sizeof(DIClassProperty));
+            memcpy(pairs, _allProperties, pairsCount * sizeof(DIClassProperty));
+            descriptorsByProperty = [self.descriptorsByProperty copy];
+        }
+        for (NSUInteger i = 0; i < pairsCount; i++) {
+            block(DIPropertyIndexDescriptor(descriptorsByProperty, pairs[i].klass, pairs[i].property));
+        }
+        free(pairs);
+        return;
+    }
+
+    NSArray<DIPropertyDescriptor *> *descriptors;
+    @synchronized(self) {
+        NSMutableIndexSet *ordinals = [NSMutableIndexSet indexSet];
+        for (Protocol *protocol in protocols) {
+            NSIndexSet *indexes = self.byProtocol[[NSValue valueWithPointer:(__bridge void *)protocol]];
+            if (indexes) {
+                [ordinals addIndexes:indexes];
+            }
+        }
+        descriptors = [self.descriptors objectsAtIndexes:ordinals];
+    }
+    for (DIPropertyDescriptor *descriptor in descriptors) {
+        block(descriptor);
+    }
+}
+
+- (NSArray<DIPropertyDescriptor *> *)descriptorsForProtocol:(Protocol *)protocol {
+    [self buildIfNeeded];
+    @synchronized(self) {
+        NSIndexSet *indexes = self.byProtocol[[NSValue valueWithPointer:(__bridge void *)protocol]];
+        return indexes ? [self.descriptors objectsAtIndexes:indexes] : @[];
+    }
+}
+
+- (NSArray<DIPropertyDescriptor *> *)descriptorsForPropertyClass:(Class)klass {
+    [self buildIfNeeded];
+    @synchronized(self) {
+        NSIndexSet *indexes = self.byPropertyClass[(id)klass];
+        return indexes ? [self.descriptors objectsAtIndexes:indexes] : @[];
+    }
+}
+
+- (DIPropertyDescriptor *)descriptorForClass:(Class)klass property:(objc_property_t)property {
+    DIPropertyDescriptor *descriptor;
+    @synchronized(self) {
+        descriptor = [self.descriptorsByProperty objectForKey:(__bridge id)(void *)property];
+    }
+    if (descriptor.targetClass == klass) {
+        return descriptor;
+    }
+    return [[DIPropertyDescriptor alloc] initWithClass:klass property:property];
+}
+
+- (void)setScanScope:(DIScanScope *)scanScope {
+    @synchronized(self) {
+        if ([_scanScope isEqual:scanScope]) {
+            return;
+        }
+        _scanScope = [scanScope copy];
+        self.built = NO;
+        self.generation++;
+    }
+}
+
+- (void)invalidate {
+    @synchronized(self) {
+        self.built = NO;
+        self.generation++;
+    }
+}
+
+@end
@@ -0,0 +1,73 @@
+//
+//  DIRegistry.h
+//  DeluxeInjection
+//
+//  Copyright (c) 2016 Anton Bukov <k06aaa@gmail.com>
+//
+//  Licensed under the MIT License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  https://opensource.org/licenses/MIT
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+
+#import <objc/runtime.h>
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ *  Concurrent hash table mapping (Class, SEL) pairs to pointers.
+ *  Reads are lock-free, writes are serialized with mutex.
+ *  Memory of replaced tables is never freed, since readers may still use them,
+ *  it is bounded by size of current table because tables grow twice.
+ */
+typedef struct DIRegistry DIRegistry;
+
+/**
+ *  Create empty registry, registries are never destroyed
+ *
+ *  @return New registry
+ */
+DIRegistry *DIRegistryCreate(void);
+
+/**
+ *  Get value without locking
+ *
+ *  @param registry Registry
+ *  @param klass    Class part of key
+ *  @param selector Selector part of key
+ *
+ *  @return Value or \c NULL if not exists
+ */
+void *_Nullable DIRegistryGet(DIRegistry *registry, Class klass, SEL selector);
+
+/**
+ *  Atomically replace value with result of block called under lock
+ *
+ *  @param registry Registry
+ *  @param klass    Class part of key
+ *  @param selector Selector part of key
+ *  @param block    Block receiving current value or \c NULL and returning new value or \c NULL to remove
+ *
+ *  @return Value returned by block
+ */
+void *_Nullable DIRegistryUpdate(DIRegistry *registry, Class klass, SEL selector, void *_Nullable (^block)(void *_Nullable value));
+
+/**
+ *  Enumerate all keys with values under lock, block should not modify registry
+ *
+ *  @param registry Registry
+ *  @param block    Block to be called for every value
+ */
+void DIRegistryEnumerate(DIRegistry *registry, void (^block)(Class klass, SEL selector, void *value));
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,146 @@
+//
+//  DIRegistry.m
+//  DeluxeInjection
+//
+//  Copyright (c) 2016 Anton Bukov <k06aaa@gmail.com>
+//
+//  Licensed under the MIT License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  https://opensource.org/licenses/MIT
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+
+#import <pthread.h>
+#import <stdatomic.h>
+
+#import "DIRegistry.h"
+
+#define DIRegistryInitialCapacity 64
+
+typedef struct {
+    _Atomic(uintptr_t) klass;    // Written last, non-zero means key is complete
+    _Atomic(uintptr_t) selector;
+    _Atomic(void *) value;       // NULL means removed, slot keeps its key forever
+} DIRegistrySlot;
+
+typedef struct DIRegistryTable {
+    size_t capacity;             // Power of two
+    size_t used;                 // Slots with keys, including removed values
+    struct DIRegistryTable *retired;
+    DIRegistrySlot slots[];
+} DIRegistryTable;
+
+struct DIRegistry {
+    _Atomic(DIRegistryTable *) table;
+    pthread_mutex_t mutex;
+};
+
+static size_t DIRegistryHash(uintptr_t klass, uintptr_t selector) {
+    uintptr_t hash = (klass >> 3) * 31 + (selector >> 2);
+    hash ^= hash >> 16;
+    return (size_t)(hash * 0x45d9f3b);
+}
+
+static DIRegistryTable *DIRegistryTableCreate(size_t capacity) {
+    DIRegistryTable *table = calloc(1, sizeof(DIRegistryTable) + capacity * sizeof(DIRegistrySlot));
+    table->capacity = capacity;
+    return table;
+}
+
+static DIRegistrySlot *DIRegistryTableFind(DIRegistryTable *table, uintptr_t klass, uintptr_t selector, BOOL returnEmpty) {
+    size_t mask = table->capacity - 1;
+    for (size_t i = DIRegistryHash(klass, selector) & mask; ; i = (i + 1) & mask) {
+        DIRegistrySlot *slot = &table->slots[i];
+        uintptr_t slotClass = atomic_load_explicit(&slot->klass, memory_order_acquire);
+        if (slotClass == 0) {
+            return returnEmpty ? slot : NULL;
+        }
+        if (slotClass == klass && atomic_load_explicit(&slot->selector, memory_order_relaxed) == selector) {
+            return slot;
+        }
+    }
+}
+
+static void DIRegistryTableInsert(DIRegistryTable *table, DIRegistrySlot *slot, uintptr_t klass, uintptr_t selector, void *value) {
+    atomic_store_explicit(&slot->value, value, memory_order_relaxed);
+    atomic_store_explicit(&slot->selector, selector, memory_order_relaxed);
+    atomic_store_explicit(&slot->klass, klass, memory_order_release);
+    table->used++;
+}
+
+//
+
+DIRegistry *DIRegistryCreate(void) {
+    DIRegistry *registry = calloc(1, sizeof(DIRegistry));
+    pthread_mutex_init(&registry->mutex, NULL);
+    atomic_init(&registry->table, DIRegistryTableCreate(DIRegistryInitialCapacity));
+    return registry;
+}
+
+void *DIRegistryGet(DIRegistry *registry, Class klass, SEL selector) {
+    DIRegistryTable *table = atomic_load_explicit(&registry->table, memory_order_acquire);
+    DIRegistrySlot *slot = DIRegistryTableFind(table, (uintptr_t)(__bridge void *)klass, (uintptr_t)selector, NO);
+    return slot ? atomic_load_explicit(&slot->value, memory_order_acquire) : NULL;
+}
+
+void *DIRegistryUpdate(DIRegistry *registry, Class klass, SEL selector, void *(^block)(void *value)) {
+    uintptr_t klassKey = (uintptr_t)(__bridge void *)klass;
+    uintptr_t selectorKey = (uintptr_t)selector;
+
+    pthread_mutex_lock(&registry->mutex);
+    DIRegistryTable *table = atomic_load_explicit(&registry->table, memory_order_relaxed);
+    DIRegistrySlot *slot = DIRegistryTableFind(table, klassKey, selectorKey, YES);
+    BOOL exists = (atomic_load_explicit(&slot->klass, memory_order_relaxed) != 0);
+    void *oldValue = exists ? atomic_load_explicit(&slot->value, memory_order_relaxed) : NULL;
+    void *newValue = block(oldValue);
+
+    if (exists) {
+        atomic_store_explicit(&slot->value, newValue, memory_order_release);
+    }
+    else if (newValue) {
+        // Keep load factor below 1/2, old table is kept for concurrent readers
+        if ((table->used + 1) * 2 > table->capacity) {
+            DIRegistryTable *newTable = DIRegistryTableCreate(table->capacity * 2);
+            for (size_t i = 0; i < table->capacity; i++) {
+                DIRegistrySlot *oldSlot = &table->slots[i];
+                void *value = atomic_load_explicit(&oldSlot->value, memory_order_relaxed);
+                if (value) {
+                    uintptr_t oldClass = atomic_load_explicit(&oldSlot->klass, memory_order_relaxed);
+                    uintptr_t oldSelector = atomic_load_explicit(&oldSlot->selector, memory_order_relaxed);
+                    DIRegistryTableInsert(newTable, DIRegistryTableFind(newTable, oldClass, oldSelector, YES), oldClass, oldSelector, value);
+                }
+            }
+            newTable->retired = table;
+            atomic_store_explicit(&registry->table, newTable, memory_order_release);
+            table = newTable;
+            slot = DIRegistryTableFind(table, klassKey, selectorKey, YES);
+        }
+        DIRegistryTableInsert(table, slot, klassKey, selectorKey, newValue);
+    }
+    pthread_mutex_unlock(&registry->mutex);
+
+    return newValue;
+}
+
+void DIRegistryEnumerate(DIRegistry *registry, void (^block)(Class klass, SEL selector, void *value)) {
+    pthread_mutex_lock(&registry->mutex);
+    DIRegistryTable *table = atomic_load_explicit(&registry->table, memory_order_relaxed);
+    for (size_t i = 0; i < table->capacity; i++) {
+        DIRegistrySlot *slot = &table->slots[i];
+        void *value = atomic_load_explicit(&slot->value, memory_order_relaxed);
+        if (value) {
+            block((__bridge Class)(void *)atomic_load_explicit(&slot->klass, memory_order_relaxed),
+                  (SEL)atomic_load_explicit(&slot->selector, memory_order_relaxed),
+                  value);
+        }
+    }
+    pthread_mutex_unlock(&registry->mutex);
+}
@@ -0,0 +1,147 @@
+//
+//  DIScanScope.h
+//  DeluxeInjection
+//
+//  Copyright (c) 2016 Anton Bukov <k06aaa@gmail.com>
+//
+//  Licensed under the MIT License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  https://opensource.org/licenses/MIT
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+
+#import <mach-o/loader.h>
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ *  Find Mach-O header of loaded image
+ *
+ *  @param imageName Path of image as returned by \c dladdr() or \c class_getImageName()
+ *
+ *  @return Header or \c NULL if image is not loaded
+ */
+const struct mach_header *_Nullable DIScanScopeImageHeader(const char *imageName);
+
+/**
+ *  Describes which classes are enumerated when looking for properties to inject.
+ *  Restricting scope to own images and class prefixes allows to never touch system frameworks.
+ */
+@interface DIScanScope : NSObject <NSCopying>
+
+/**
+ *  Paths or file names of images to scan, \c nil to scan all loaded images
+ */
+@property (readonly, copy, nonatomic, nullable) NSArray<NSString *> *images;
+
+/**
+ *  Prefixes of class names to scan, \c nil to scan classes with any name
+ */
+@property (readonly, copy, nonatomic, nullable) NSArray<NSString *> *classPrefixes;
+
+/**
+ *  Scan metaclasses to support class properties injection
+ */
+@property (readonly, assign, nonatomic) BOOL includeMetaClasses;
+
+/**
+ *  Take marked properties from \c DIManifest section of images instead of runtime scan,
+ *  images without manifest are still scanned
+ */
+@property (readonly, assign, nonatomic) BOOL usesManifest;
+
+/**
+ *  Scope of all classes of all images including metaclasses
+ *
+ *  @return Default scope instance
+ */
++ (instancetype)defaultScope;
+
+/**
+ *  Create scope with restrictions, every \c nil argument means no restriction
+ *
+ *  @param images             Paths or file names of images like \c "MyApp" or \c "MyFramework"
+ *  @param classPrefixes      Prefixes of class names like \c "MY"
+ *  @param includeMetaClasses Pass \c NO if no class properties should be injected
+ *
+ *  @return Scope instance
+ */
++ (instancetype)scopeWithImages:(nullable NSArray<NSString *> *)images
+                  classPrefixes:(nullable NSArray<NSString *> *)classPrefixes
+             includeMetaClasses:(BOOL)includeMetaClasses;
+
+/**
+ *  Create scope with restrictions, every \c nil argument means no restriction
+ *
+ *  @param images             Paths or file names of images like \c "MyApp" or \c "MyFramework"
+ *  @param classPrefixes      Prefixes of class names like \c "MY"
+ *  @param includeMetaClasses Pass \c NO if no class properties should be injected
+ *  @param usesManifest       Pass \c YES to read marked properties from manifest of images which have it
+ *
+ *  @return Scope instance
+ */
++ (instancetype)scopeWithImages:(nullable NSArray<NSString *> *)images
+                  classPrefixes:(nullable NSArray<NSString *> *)classPrefixes
+             includeMetaClasses:(BOOL)includeMetaClasses
+                   usesManifest:(BOOL)usesManifest;
+
+/**
+ *  Path of main executable image, useful to create scope of application classes only
+ *
+ *  @return Image path
+ */
++ (nullable NSString *)mainExecutableImage;
+
+/**
+ *  Check if classes of image should be scanned
+ *
+ *  @param imageName Path of image as returned by \c dladdr() or \c class_getImageName()
+ *
+ *  @return \c YES if image is inside scope
+ */
+- (BOOL)containsImage:(const char *)imageName;
+
+/**
+ *  Check if class should be scanned by its name
+ *
+ *  @param className Name of class as returned by \c class_getName()
+ *
+ *  @return \c YES if class name matches any of prefixes
+ */
+- (BOOL)containsClassName:(const char *)className;
+
+/**
+ *  Enumerate loaded images of scope
+ *
+ *  @param block Block to be called for every image path
+ */
+- (void)enumerateImages:(void (^)(const char *imageName))block;
+
+/**
+ *  Enumerate \c NSObject subclasses of scope and their metaclasses if needed
+ *
+ *  @param block Block to be called for every class
+ */
+- (void)enumerateClasses:(void (^)(Class klass))block;
+
+/**
+ *  Enumerate \c NSObject subclasses of single image matching scope prefixes and their metaclasses if needed
+ *
+ *  @param imageName Path of image as returned by \c dladdr() or \c class_getImageName()
+ *  @param block     Block to be called for every class
+ */
+- (void)enumerateClassesOfImage:(const char *)imageName usingBlock:(void (^)(Class klass))block;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,218 @@
+//
+//  DIScanScope.m
+//  DeluxeInjection
+//
+//  Copyright (c) 2016 Anton Bukov <k06aaa@gmail.com>
+//
+//  Licensed under the MIT License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  https://opensource.org/licenses/MIT
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+
+#import <mach-o/dyld.h>
+#import <objc/runtime.h>
+
+#import "DIScanScope.h"
+
+static BOOL DIClassIsNSObjectSubclass(Class klass) {
+    Class rootClass = [NSObject class];
+    for (Class superclass = klass; superclass; superclass = class_getSuperclass(superclass)) {
+        if (superclass == rootClass) {
+            return YES;
+        }
+    }
+    return NO;
+}
+
+const struct mach_header *DIScanScopeImageHeader(const char *imageName) {
+    uint32_t imagesCount = _dyld_image_count();
+    for (uint32_t i = 0; i < imagesCount; i++) {
+        const char *name = _dyld_get_image_name(i);
+        if (name && strcmp(name, imageName) == 0) {
+            return _dyld_get_image_header(i);
+        }
+    }
+    return NULL;
+}
+
+//
+
+@interface DIScanScope ()
+
+@property (copy, nonatomic, nullable) NSArray<NSString *> *images;
+@property (copy, nonatomic, nullable) NSArray<NSString *> *classPrefixes;
+@property (assign, nonatomic) BOOL includeMetaClasses;
+@property (assign, nonatomic) BOOL usesManifest;
+
+@end
+
+@implementation DIScanScope {
+    char **_prefixes;
+    size_t *_prefixLengths;
+    NSUInteger _prefixesCount;
+}
+
++ (instancetype)defaultScope {
+    return [self scopeWithImages:nil classPrefixes:nil includeMetaClasses:YES];
+}
+
++ (instancetype)scopeWithImages:(NSArray<NSString *> *)images classPrefixes:(NSArray<NSString *> *)classPrefixes includeMetaClasses:(BOOL)includeMetaClasses {
+    return [self scopeWithImages:images classPrefixes:classPrefixes includeMetaClasses:includeMetaClasses usesManifest:NO];
+}
+
++ (instancetype)scopeWithImages:(NSArray<NSString *> *)images classPrefixes:(NSArray<NSString *> *)classPrefixes includeMetaClasses:(BOOL)includeMetaClasses usesManifest:(BOOL)usesManifest {
+    DIScanScope *scope = [[self alloc] init];
+    scope.images = images;
+    scope.classPrefixes = classPrefixes;
+    scope.includeMetaClasses = includeMetaClasses;
+    scope.usesManifest = usesManifest;
+    return scope;
+}
+
++ (NSString *)mainExecutableImage {
+    return [NSBundle mainBundle].executablePath;
+}
+
+- (void)dealloc {
+    for (NSUInteger i = 0; i < _prefixesCount; i++) {
+        free(_prefixes[i]);
+    }
+    free(_prefixes);
+    free(_prefixLengths);
+}
+
+- (void)setClassPrefixes:(NSArray<NSString *> *)classPrefixes {
+    _classPrefixes = [classPrefixes copy];
+
+    // Keep C strings to match class names without creating NSString for every class
+    _prefixesCount = classPrefixes.count;
+    _prefixes = calloc(_prefixesCount, sizeof(char *));
+    _prefixLengths = calloc(_prefixesCount, sizeof(size_t));
+    for (NSUInteger i = 0; i < _prefixesCount; i++) {
+        _prefixes[i] = strdup(classPrefixes[i].UTF8String);
+        _prefixLengths[i] = strlen(_prefixes[i]);
+    }
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    return self;
+}
+
+- (BOOL)isEqual:(id)object {
+    if (![object isKindOfClass:[DIScanScope class]]) {
+        return NO;
+    }
+    DIScanScope *scope = object;
+    return (self.images == scope.images || [self.images isEqualToArray:scope.images]) &&
+           (self.classPrefixes == scope.classPrefixes || [self.classPrefixes isEqualToArray:scope.classPrefixes]) &&
+           self.includeMetaClasses == scope.includeMetaClasses &&
+           self.usesManifest == scope.usesManifest;
+}
+
+- (NSUInteger)hash {
+    return self.images.hash ^ self.classPrefixes.hash ^ self.includeMetaClasses ^ (self.usesManifest << 1);
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %p images: %@, classPrefixes: %@, includeMetaClasses: %@, usesManifest: %@>",
+            [self class], self,
+            self.images ? [self.images componentsJoinedByString:@","] : @"all",
+            self.classPrefixes ? [self.classPrefixes componentsJoinedByString:@","] : @"all",
+            self.includeMetaClasses ? @"YES" : @"NO",
+            self.usesManifest ? @"YES" : @"NO"];
+}
+
+#pragma mark - Matching
+
+- (BOOL)containsImage:(const char *)imageName {
+    if (self.images == nil) {
+        return YES;
+    }
+    if (imageName == NULL) {
+        return NO;
+    }
+
+    const char *fileName = strrchr(imageName, '/');
+    fileName = fileName ? fileName + 1 : imageName;
+    for (NSString *image in self.images) {
+        const char *str = image.UTF8String;
+        if (strcmp(str, imageName) == 0 || strcmp(str, fileName) == 0) {
+            return YES;
+        }
+    }
+    return NO;
+}
+
+- (BOOL)containsClassName:(const char *)className {
+    if (self.classPrefixes == nil) {
+        return YES;
+    }
+    for (NSUInteger i = 0; i < _prefixesCount; i++) {
+        if (strncmp(className, _prefixes[i], _prefixLengths[i]) == 0) {
+            return YES;
+        }
+    }
+    return NO;
+}
+
+#pragma mark - Enumeration
+
+- (void)enumerateClasses:(void (^)(Class klass))block {
+    if (self.images == nil) {
+        unsigned int count = 0;
+        Class *classes = objc_copyClassList(&count);
+        for (unsigned int i = 0; i < count; i++) {
+            [self enumerateClass:classes[i] name:class_getName(classes[i]) usingBlock:block];
+        }
+        free(classes);
+        return;
+    }
+
+    [self enumerateImages:^(const char *imageName) {
+        [self enumerateClassesOfImage:imageName usingBlock:block];
+    }];
+}
+
+- (void)enumerateImages:(void (^)(const char *imageName))block {
+    unsigned int imagesCount = 0;
+    const char **imageNames = objc_copyImageNames(&imagesCount);
+    for (unsigned int i = 0; i < imagesCount; i++) {
+        if ([self containsImage:imageNames[i]]) {
+            block(imageNames[i]);
+        }
+    }
+    free(imageNames);
+}
+
+- (void)enumerateClassesOfImage:(const char *)imageName usingBlock:(void (^)(Class klass))block {
+    unsigned int count = 0;
+    const char **classNames = objc_copyClassNamesForImage(imageName, &count);
+    for (unsigned int i = 0; i < count; i++) {
+        // Check name before touching class to not realize classes out of scope
+        if ([self containsClassName:classNames[i]]) {
+            [self enumerateClass:objc_getClass(classNames[i]) name:classNames[i] usingBlock:block];
+        }
+    }
+    free(classNames);
+}
+
+- (void)enumerateClass:(Class)klass name:(const char *)className usingBlock:(void (^)(Class klass))block {
+    if (!klass || ![self containsClassName:className] || !DIClassIsNSObjectSubclass(klass)) {
+        return;
+    }
+    block(klass);
+    if (self.includeMetaClasses) {
+        block(object_getClass(klass));
+    }
+}
+
+@end
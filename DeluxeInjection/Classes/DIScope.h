@@ -0,0 +1,91 @@
+//
+//  DIScope.h
+//  DeluxeInjection
+//
+//  Copyright (c) 2016 Anton Bukov <k06aaa@gmail.com>
+//
+//  Licensed under the MIT License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  https://opensource.org/licenses/MIT
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import "DIDeluxeInjection.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ *  Identifier of value inside every scope
+ */
+typedef NSUInteger DIScopeSlot;
+
+/**
+ *  Allocate new slot, slots are never reused
+ *
+ *  @return Slot identifier
+ */
+DIScopeSlot DIScopeSlotCreate(void);
+
+/**
+ *  Lifetime of scoped values, like request or session. Values injected with \c DIGetterScoped
+ *  or \c getterValueScoped: are built once per scope and shared inside it,
+ *  all of them are released together when scope ends or deallocates.
+ */
+@interface DIScope : NSObject
+
+/**
+ *  Scope entered on current thread by innermost \c perform: call
+ *
+ *  @return Current scope or \c nil
+ */
++ (nullable DIScope *)currentScope;
+
+/**
+ *  Number of values stored in scope
+ */
+@property (readonly, assign, nonatomic) NSUInteger count;
+
+/**
+ *  Make scope current on current thread while block is running, calls can be nested
+ *
+ *  @param block Block to perform
+ */
+- (void)perform:(void (^)(void))block;
+
+/**
+ *  Get value of slot building it on first access
+ *
+ *  @param slot  Slot identifier created with \c DIScopeSlotCreate
+ *  @param block Block to build value, called out of scope lock and may be called
+ *               by several threads accessing slot at once, first built value is kept
+ *
+ *  @return Stored value
+ */
+- (nullable id)objectForSlot:(DIScopeSlot)slot building:(id _Nullable (^)(void))block;
+
+/**
+ *  Release all values of scope at once, scope stays usable and builds values again on next access
+ */
+- (void)end;
+
+@end
+
+/**
+ *  Transforms getter block without \c ivar argument to block returning value built once per current scope,
+ *  values are not stored in instance variables and getter returns \c nil outside of any scope.
+ *  All properties injected with the same returned getter share single value inside scope.
+ *
+ *  @param getter Block to build value
+ *
+ *  @return Block with \c ivar argument
+ */
+DIGetter DIGetterScoped(DIGetterWithoutIvar getter);
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,177 @@
+//
+//  DIScope.m
+//  DeluxeInjection
+//
+//  Copyright (c) 2016 Anton Bukov <k06aaa@gmail.com>
+//
+//  Licensed under the MIT License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  https://opensource.org/licenses/MIT
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import <pthread.h>
+#import <stdatomic.h>
+
+#import "DIScope.h"
+
+static _Atomic(NSUInteger) DIScopeSlotsCount = 0;
+
+DIScopeSlot DIScopeSlotCreate(void) {
+    return atomic_fetch_add(&DIScopeSlotsCount, 1);
+}
+
+static pthread_key_t DIScopeCurrentKey() {
+    static pthread_key_t key;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        pthread_key_create(&key, NULL);
+    });
+    return key;
+}
+
+//
+
+typedef struct {
+    DIScopeSlot slot;
+    void *value; // Retained, entry is empty when NULL
+} DIScopeEntry;
+
+/**
+ *  Find entry of slot or empty entry to insert it, capacity is power of two and table is never full
+ */
+static DIScopeEntry *DIScopeEntryFind(DIScopeEntry *entries, NSUInteger capacity, DIScopeSlot slot) {
+    NSUInteger mask = capacity - 1;
+    for (NSUInteger i = (NSUInteger)((slot * 0x9E3779B97F4A7C15ull) >> 32) & mask; ; i = (i + 1) & mask) {
+        if (entries[i].value == NULL || entries[i].slot == slot) {
+            return &entries[i];
+        }
+    }
+}
+
+//
+
+@interface DIScope () {
+    pthread_mutex_t _mutex;
+    DIScopeEntry *_entries; // Open addressing table sized by values of this scope, not by slots count
+    NSUInteger _capacity;
+    NSUInteger _count;
+}
+
+@end
+
+@implementation DIScope
+
++ (DIScope *)currentScope {
+    return (__bridge DIScope *)pthread_getspecific(DIScopeCurrentKey());
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        pthread_mutex_init(&_mutex, NULL);
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [self end];
+    pthread_mutex_destroy(&_mutex);
+}
+
+- (NSUInteger)count {
+    pthread_mutex_lock(&_mutex);
+    NSUInteger count = _count;
+    pthread_mutex_unlock(&_mutex);
+    return count;
+}
+
+- (void)perform:(void (^)(void))block {
+    pthread_key_t key = DIScopeCurrentKey();
+    void *previousScope = pthread_getspecific(key);
+    pthread_setspecific(key, (__bridge void *)self);
+    @try {
+        block();
+    }
+    @finally {
+        pthread_setspecific(key, previousScope);
+    }
+}
+
+- (id)objectForSlot:(DIScopeSlot)slot building:(id (^)(void))block {
+    pthread_mutex_lock(&_mutex);
+    DIScopeEntry *found = _capacity ? DIScopeEntryFind(_entries, _capacity, slot) : NULL;
+    if (found && found->value) {
+        id value = (__bridge id)found->value;
+        pthread_mutex_unlock(&_mutex);
+        return value;
+    }
+    pthread_mutex_unlock(&_mutex);
+    
+    // Built out of lock, so building can wait for other threads accessing scope
+    id value = block();
+    if (value) {
+        pthread_mutex_lock(&_mutex);
+        if ((_count + 1) * 4 > _capacity * 3) {
+            NSUInteger capacity = MAX(_capacity * 2, (NSUInteger)8);
+            DIScopeEntry *entries = calloc(capacity, sizeof(DIScopeEntry));
+            for (NSUInteger i = 0; i < _capacity; i++) {
+                if (_entries[i].value) {
+                    *DIScopeEntryFind(entries, capacity, _entries[i].slot) = _entries[i];
+                }
+            }
+            free(_entries);
+            _entries = entries;
+            _capacity = capacity;
+        }
+        DIScopeEntry *entry = DIScopeEntryFind(_entries, _capacity, slot);
+        if (entry->value == NULL) {
+            entry->slot = slot;
+            entry->value = (__bridge_retained void *)value;
+            _count++;
+        }
+        else {
+            value = (__bridge id)entry->value; // Built recursively or concurrently while building
+        }
+        pthread_mutex_unlock(&_mutex);
+    }
+    return value;
+}
+
+- (void)end {
+    pthread_mutex_lock(&_mutex);
+    DIScopeEntry *entries = _entries;
+    NSUInteger capacity = _capacity;
+    _entries = NULL;
+    _capacity = 0;
+    _count = 0;
+    pthread_mutex_unlock(&_mutex);
+    
+    // Released out of lock, values may access scope in their dealloc
+    for (NSUInteger i = 0; i < capacity; i++) {
+        if (entries[i].value) {
+            CFRelease(entries[i].value);
+        }
+    }
+    free(entries);
+}
+
+@end
+
+//
+
+DIGetter DIGetterScoped(DIGetterWithoutIvar getter) {
+    DIScopeSlot slot = DIScopeSlotCreate();
+    return DIGetterWithOriginalMake(^id _Nullable(id  _Nonnull target, SEL cmd, id  _Nullable __autoreleasing * _Nonnull ivar, id  _Nullable (* _Nullable originalGetter)(id  _Nonnull __strong, SEL _Nonnull)) {
+        return [[DIScope currentScope] objectForSlot:slot building:^id {
+            return getter(target, cmd);
+        }];
+    });
+}
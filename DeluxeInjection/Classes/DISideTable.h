@@ -0,0 +1,63 @@
+//
+//  DISideTable.h
+//  DeluxeInjection
+//
+//  Copyright (c) 2016 Anton Bukov <k06aaa@gmail.com>
+//
+//  Licensed under the MIT License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  https://opensource.org/licenses/MIT
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+
+#import <objc/runtime.h>
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ *  Get value stored for object by key in sharded side table,
+ *  works like \c objc_getAssociatedObject but locks only one of many shards
+ *
+ *  @param object Object owning value
+ *  @param key    Unique key pointer
+ *
+ *  @return Stored value or \c nil
+ */
+id _Nullable DISideTableGet(id object, const void *key);
+
+/**
+ *  Store value for object by key in sharded side table,
+ *  works like \c objc_setAssociatedObject, all values of object are released when it deallocates.
+ *  First value stored for every object installs dealloc sentinel with \c objc_setAssociatedObject,
+ *  so first touch of object costs as much as runtime association, only later accesses are cheaper.
+ *
+ *  @param object Object owning value
+ *  @param key    Unique key pointer
+ *  @param value  Value to store or \c nil to remove stored value
+ *  @param policy Memory management policy of value, atomic and nonatomic policies behave the same way
+ */
+void DISideTableSet(id object, const void *key, id _Nullable value, objc_AssociationPolicy policy);
+
+/**
+ *  Store value for object by key only if nothing is stored yet, check and store are atomic
+ *
+ *  @param object Object owning value
+ *  @param key    Unique key pointer
+ *  @param value  Value to store
+ *  @param policy Memory management policy of value
+ *
+ *  @return Value stored before call or \c value if nothing was stored
+ */
+id DISideTableSetIfNil(id object, const void *key, id value, objc_AssociationPolicy policy);
+
+NS_ASSUME_NONNULL_END
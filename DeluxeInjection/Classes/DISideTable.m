@@ -0,0 +1,173 @@
+//
+//  DISideTable.m
+//  DeluxeInjection
+//
+//  Copyright (c) 2016 Anton Bukov <k06aaa@gmail.com>
+//
+//  Licensed under the MIT License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  https://opensource.org/licenses/MIT
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+
+#import <pthread.h>
+
+#import "DISideTable.h"
+
+#define DISideTableShardsCount 64
+
+typedef struct {
+    pthread_mutex_t mutex;
+    CFMutableDictionaryRef objects; // Object address -> CFMutableDictionary of key -> value
+} DISideTableShard;
+
+static DISideTableShard DISideTableShards[DISideTableShardsCount];
+
+static DISideTableShard *DISideTableShardForAddress(uintptr_t address) {
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        for (NSUInteger i = 0; i < DISideTableShardsCount; i++) {
+            pthread_mutex_init(&DISideTableShards[i].mutex, NULL);
+            DISideTableShards[i].objects = CFDictionaryCreateMutable(kCFAllocatorDefault, 0, NULL, &kCFTypeDictionaryValueCallBacks);
+        }
+    });
+
+    // Skip low bits which are same for all objects because of alignment
+    return &DISideTableShards[((address >> 4) ^ (address >> 10)) % DISideTableShardsCount];
+}
+
+//
+
+@interface DISideTableUnretained : NSObject {
+@public
+    __unsafe_unretained id object;
+}
+
+@end
+
+@implementation DISideTableUnretained
+
+@end
+
+//
+
+/**
+ *  Associated once with every object having values in side table to release them on object dealloc,
+ *  this is the only runtime association lock taken per object, later values of object reuse it
+ */
+@interface DISideTableSentinel : NSObject {
+@public
+    uintptr_t address;
+}
+
+@end
+
+@implementation DISideTableSentinel
+
+- (void)dealloc {
+    DISideTableShard *shard = DISideTableShardForAddress(address);
+    pthread_mutex_lock(&shard->mutex);
+    id values = (__bridge id)CFDictionaryGetValue(shard->objects, (const void *)address);
+    CFDictionaryRemoveValue(shard->objects, (const void *)address);
+    pthread_mutex_unlock(&shard->mutex);
+
+    // Values are released here, out of lock, they may use side table in their dealloc
+    values = nil;
+}
+
+@end
+
+static void *DISideTableSentinelKey = &DISideTableSentinelKey;
+
+//
+
+static id DISideTableUnwrap(id value) {
+    if (object_getClass(value) == [DISideTableUnretained class]) {
+        return ((DISideTableUnretained *)value)->object;
+    }
+    return value;
+}
+
+id DISideTableGet(id object, const void *key) {
+    uintptr_t address = (uintptr_t)(__bridge void *)object;
+    DISideTableShard *shard = DISideTableShardForAddress(address);
+
+    pthread_mutex_lock(&shard->mutex);
+    CFDictionaryRef values = CFDictionaryGetValue(shard->objects, (const void *)address);
+    id value = values ? (__bridge id)CFDictionaryGetValue(values, key) : nil;
+    pthread_mutex_unlock(&shard->mutex);
+
+    return DISideTableUnwrap(value);
+}
+
+/**
+ *  Store value, when \c onlyIfNil is set value is stored only if nothing is stored yet
+ *
+ *  @return Value stored after call
+ */
+static id DISideTableStore(id object, const void *key, id value, objc_AssociationPolicy policy, BOOL onlyIfNil) {
+    if (value) {
+        if (policy == OBJC_ASSOCIATION_COPY || policy == OBJC_ASSOCIATION_COPY_NONATOMIC) {
+            value = [value copy];
+        }
+        else if (policy == OBJC_ASSOCIATION_ASSIGN) {
+            DISideTableUnretained *wrapper = [[DISideTableUnretained alloc] init];
+            wrapper->object = value;
+            value = wrapper;
+        }
+    }
+
+    uintptr_t address = (uintptr_t)(__bridge void *)object;
+    DISideTableShard *shard = DISideTableShardForAddress(address);
+    BOOL needsSentinel = NO;
+    id oldValue = nil;
+
+    pthread_mutex_lock(&shard->mutex);
+    CFMutableDictionaryRef values = (CFMutableDictionaryRef)CFDictionaryGetValue(shard->objects, (const void *)address);
+    if (values == NULL && value) {
+        values = CFDictionaryCreateMutable(kCFAllocatorDefault, 0, NULL, &kCFTypeDictionaryValueCallBacks);
+        CFDictionarySetValue(shard->objects, (const void *)address, values);
+        CFRelease(values);
+        needsSentinel = YES;
+    }
+    if (values) {
+        oldValue = (__bridge id)CFDictionaryGetValue(values, key);
+        if (oldValue && onlyIfNil) {
+            value = oldValue;
+        }
+        else if (value) {
+            CFDictionarySetValue(values, key, (__bridge const void *)value);
+        }
+        else {
+            CFDictionaryRemoveValue(values, key);
+        }
+    }
+    pthread_mutex_unlock(&shard->mutex);
+
+    if (needsSentinel) {
+        DISideTableSentinel *sentinel = [[DISideTableSentinel alloc] init];
+        sentinel->address = address;
+        objc_setAssociatedObject(object, DISideTableSentinelKey, sentinel, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    }
+
+    // Old value is released out of lock
+    oldValue = nil;
+
+    return DISideTableUnwrap(value);
+}
+
+void DISideTableSet(id object, const void *key, id value, objc_AssociationPolicy policy) {
+    DISideTableStore(object, key, value, policy, NO);
+}
+
+id DISideTableSetIfNil(id object, const void *key, id value, objc_AssociationPolicy policy) {
+    return DISideTableStore(object, key, value, policy, YES);
+}
@@ -0,0 +1,105 @@
+//
+//  DIStats.h
+//  DeluxeInjection
+//
+//  Copyright (c) 2016 Anton Bukov <k06aaa@gmail.com>
+//
+//  Licensed under the MIT License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  https://opensource.org/licenses/MIT
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import "DIDeluxeInjection.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ *  Number of latency histogram buckets, bucket \c i counts sampled calls taking less than \c 2^i nanoseconds
+ */
+extern NSUInteger const DIAccessorStatsBucketsCount;
+
+/**
+ *  Counters of single injected accessor merged from all threads
+ */
+@interface DIAccessorStats : NSObject
+
+@property (readonly, unsafe_unretained, nonatomic) Class targetClass;
+@property (readonly, assign, nonatomic) SEL selector;
+@property (readonly, assign, nonatomic, getter=isSetter) BOOL setter;
+
+/**
+ *  Number of calls
+ */
+@property (readonly, assign, nonatomic) uint64_t calls;
+
+/**
+ *  Number of getter calls which found value missing and invoked provider block
+ */
+@property (readonly, assign, nonatomic) uint64_t slowPaths;
+
+/**
+ *  Number of calls with measured latency, every \c sampleInterval call of every thread is measured
+ */
+@property (readonly, assign, nonatomic) uint64_t sampledCalls;
+
+/**
+ *  Latency histogram of sampled calls with \c DIAccessorStatsBucketsCount counts
+ */
+@property (readonly, copy, nonatomic) NSArray<NSNumber *> *latencyHistogram;
+
+/**
+ *  Upper bound of latency of given part of sampled calls estimated by histogram
+ *
+ *  @param percentile Value from \c 0 to \c 1, like \c 0.5 for median
+ *
+ *  @return Latency upper bound in seconds or \c 0 if there are no sampled calls
+ */
+- (NSTimeInterval)latencyAtPercentile:(double)percentile;
+
+@end
+
+//
+
+@interface DeluxeInjection (DIStats)
+
+/**
+ *  Instrument accessors injected after enabling with per-thread call counters and sampled latency,
+ *  accessors injected while stats are disabled have no instrumentation at all.
+ *  Disabling stops counting of instrumented accessors right away.
+ *
+ *  @param enabled Pass \c YES to start collecting stats
+ */
++ (void)setStatsEnabled:(BOOL)enabled;
+
++ (BOOL)statsEnabled;
+
+/**
+ *  Measure latency of every \c sampleInterval call of every thread, \c 64 by default, \c 1 to measure every call
+ *
+ *  @param sampleInterval Interval of sampling
+ */
++ (void)setStatsSampleInterval:(NSUInteger)sampleInterval;
+
+/**
+ *  Merge counters of all threads
+ *
+ *  @return Stats of accessors called at least once since last reset sorted by number of calls
+ */
++ (NSArray<DIAccessorStats *> *)statsSnapshot;
+
+/**
+ *  Start counting from zero, counters of running threads are kept and subtracted on read
+ */
++ (void)resetStats;
+
+@end
+
+NS_ASSUME_NONNULL_END
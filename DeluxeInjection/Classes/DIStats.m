@@ -0,0 +1,379 @@
+//
+//  DIStats.m
+//  DeluxeInjection
+//
+//  Copyright (c) 2016 Anton Bukov <k06aaa@gmail.com>
+//
+//  Licensed under the MIT License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  https://opensource.org/licenses/MIT
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import <mach/mach_time.h>
+#import <pthread.h>
+
+#import "DIStats.h"
+#import "DIStatsPlugin.h"
+
+#define DIStatsBucketsCount 32
+#define DIStatsSitesPerChunk 64
+#define DIStatsMaxChunks 256
+
+NSUInteger const DIAccessorStatsBucketsCount = DIStatsBucketsCount;
+
+typedef uint32_t DIStatsSite;
+
+static DIStatsSite const DIStatsSiteNone = UINT32_MAX;
+
+_Atomic(BOOL) DIStatsEnabled = NO;
+static _Atomic(NSUInteger) DIStatsSampleInterval = 64;
+
+typedef struct {
+    _Atomic(uint64_t) calls;
+    _Atomic(uint64_t) slowPaths;
+    _Atomic(uint64_t) sampledCalls;
+    _Atomic(uint64_t) histogram[DIStatsBucketsCount];
+} DIStatsCounters;
+
+/**
+ *  Counters of all sites in chunks allocated on first use, chunks are never moved,
+ *  so other threads can read counters while owner thread keeps writing them
+ */
+typedef struct {
+    _Atomic(DIStatsCounters *) chunks[DIStatsMaxChunks];
+} DIStatsTable;
+
+typedef struct DIStatsThread {
+    DIStatsTable table;
+    NSUInteger callsUntilSample;
+    BOOL slowPath;
+    struct DIStatsThread *prev;
+    struct DIStatsThread *next;
+} DIStatsThread;
+
+typedef struct {
+    __unsafe_unretained Class klass;
+    SEL selector;
+    BOOL setter;
+} DIStatsSiteInfo;
+
+// Guards sites, list of threads, counters of exited threads and reset baseline
+static pthread_mutex_t DIStatsMutex = PTHREAD_MUTEX_INITIALIZER;
+static DIStatsSiteInfo *DIStatsSites;
+static NSUInteger DIStatsSitesCount;
+static NSMutableDictionary<NSString *, NSNumber *> *DIStatsSitesByKey;
+static DIStatsThread *DIStatsThreads;
+static DIStatsTable DIStatsExitedThreads;
+static DIStatsTable DIStatsBaseline;
+
+#pragma mark - Counters
+
+static inline void DIStatsIncrement(_Atomic(uint64_t) *counter, uint64_t value) {
+    // Only owner thread writes counter, so plain load and store are enough
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + value, memory_order_relaxed);
+}
+
+static DIStatsCounters *DIStatsTableCounters(DIStatsTable *table, DIStatsSite site) {
+    _Atomic(DIStatsCounters *) *chunk = &table->chunks[site / DIStatsSitesPerChunk];
+    DIStatsCounters *counters = atomic_load_explicit(chunk, memory_order_acquire);
+    if (counters == NULL) {
+        counters = calloc(DIStatsSitesPerChunk, sizeof(DIStatsCounters));
+        atomic_store_explicit(chunk, counters, memory_order_release);
+    }
+    return &counters[site % DIStatsSitesPerChunk];
+}
+
+static void DIStatsTableAdd(DIStatsTable *table, DIStatsTable *other, int64_t sign) {
+    for (NSUInteger chunk = 0; chunk < DIStatsMaxChunks; chunk++) {
+        DIStatsCounters *otherCounters = atomic_load_explicit(&other->chunks[chunk], memory_order_acquire);
+        if (otherCounters == NULL) {
+            continue;
+        }
+        for (NSUInteger i = 0; i < DIStatsSitesPerChunk; i++) {
+            DIStatsCounters *counters = DIStatsTableCounters(table, (DIStatsSite)(chunk * DIStatsSitesPerChunk + i));
+            DIStatsCounters *source = &otherCounters[i];
+            DIStatsIncrement(&counters->calls, sign * atomic_load_explicit(&source->calls, memory_order_relaxed));
+            DIStatsIncrement(&counters->slowPaths, sign * atomic_load_explicit(&source->slowPaths, memory_order_relaxed));
+            DIStatsIncrement(&counters->sampledCalls, sign * atomic_load_explicit(&source->sampledCalls, memory_order_relaxed));
+            for (NSUInteger bucket = 0; bucket < DIStatsBucketsCount; bucket++) {
+                DIStatsIncrement(&counters->histogram[bucket], sign * atomic_load_explicit(&source->histogram[bucket], memory_order_relaxed));
+            }
+        }
+    }
+}
+
+static void DIStatsTableClear(DIStatsTable *table) {
+    for (NSUInteger chunk = 0; chunk < DIStatsMaxChunks; chunk++) {
+        free(atomic_load_explicit(&table->chunks[chunk], memory_order_relaxed));
+        atomic_store_explicit(&table->chunks[chunk], NULL, memory_order_relaxed);
+    }
+}
+
+static void DIStatsTableAddAllThreads(DIStatsTable *table) {
+    DIStatsTableAdd(table, &DIStatsExitedThreads, 1);
+    for (DIStatsThread *thread = DIStatsThreads; thread; thread = thread->next) {
+        DIStatsTableAdd(table, &thread->table, 1);
+    }
+}
+
+#pragma mark - Threads
+
+static void DIStatsThreadExit(void *value) {
+    DIStatsThread *thread = value;
+    pthread_mutex_lock(&DIStatsMutex);
+    DIStatsTableAdd(&DIStatsExitedThreads, &thread->table, 1);
+    if (thread->prev) {
+        thread->prev->next = thread->next;
+    }
+    else {
+        DIStatsThreads = thread->next;
+    }
+    if (thread->next) {
+        thread->next->prev = thread->prev;
+    }
+    pthread_mutex_unlock(&DIStatsMutex);
+
+    DIStatsTableClear(&thread->table);
+    free(thread);
+}
+
+static pthread_key_t DIStatsThreadKey() {
+    static pthread_key_t key;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        pthread_key_create(&key, DIStatsThreadExit);
+    });
+    return key;
+}
+
+static DIStatsThread *DIStatsCurrentThread() {
+    pthread_key_t key = DIStatsThreadKey();
+    DIStatsThread *thread = pthread_getspecific(key);
+    if (thread) {
+        return thread;
+    }
+
+    thread = calloc(1, sizeof(DIStatsThread));
+    pthread_setspecific(key, thread);
+    pthread_mutex_lock(&DIStatsMutex);
+    thread->next = DIStatsThreads;
+    if (DIStatsThreads) {
+        DIStatsThreads->prev = thread;
+    }
+    DIStatsThreads = thread;
+    pthread_mutex_unlock(&DIStatsMutex);
+    return thread;
+}
+
+#pragma mark - Recording
+
+static uint64_t DIStatsNanoseconds(uint64_t ticks) {
+    static mach_timebase_info_data_t timebase;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        mach_timebase_info(&timebase);
+    });
+    return ticks * timebase.numer / timebase.denom;
+}
+
+static inline BOOL DIStatsShouldSample(DIStatsThread *thread) {
+    if (thread->callsUntilSample == 0) {
+        thread->callsUntilSample = atomic_load_explicit(&DIStatsSampleInterval, memory_order_relaxed) - 1;
+        return YES;
+    }
+    thread->callsUntilSample--;
+    return NO;
+}
+
+static void DIStatsRecord(DIStatsThread *thread, DIStatsSite site, BOOL sampled, uint64_t start, BOOL slowPath) {
+    DIStatsCounters *counters = DIStatsTableCounters(&thread->table, site);
+    DIStatsIncrement(&counters->calls, 1);
+    if (slowPath) {
+        DIStatsIncrement(&counters->slowPaths, 1);
+    }
+    if (sampled) {
+        uint64_t nanoseconds = DIStatsNanoseconds(mach_absolute_time() - start);
+        NSUInteger bucket = nanoseconds ? MIN((NSUInteger)(64 - __builtin_clzll(nanoseconds)), DIStatsBucketsCount - 1) : 0;
+        DIStatsIncrement(&counters->sampledCalls, 1);
+        DIStatsIncrement(&counters->histogram[bucket], 1);
+    }
+}
+
+void DIStatsMarkSlowPath(void) {
+    DIStatsCurrentThread()->slowPath = YES;
+}
+
+static DIStatsSite DIStatsSiteRegister(Class klass, SEL selector, BOOL setter) {
+    NSString *key = [NSString stringWithFormat:@"%p %s", (__bridge void *)klass, sel_getName(selector)];
+    pthread_mutex_lock(&DIStatsMutex);
+    NSNumber *existingSite = DIStatsSitesByKey[key];
+    DIStatsSite site = existingSite ? existingSite.unsignedIntValue : DIStatsSiteNone;
+    if (existingSite == nil && DIStatsSitesCount < DIStatsMaxChunks * DIStatsSitesPerChunk) {
+        if (DIStatsSitesByKey == nil) {
+            DIStatsSitesByKey = [NSMutableDictionary dictionary];
+        }
+        site = (DIStatsSite)DIStatsSitesCount++;
+        DIStatsSites = realloc(DIStatsSites, DIStatsSitesCount * sizeof(DIStatsSiteInfo));
+        DIStatsSites[site] = (DIStatsSiteInfo){klass, selector, setter};
+        DIStatsSitesByKey[key] = @(site);
+    }
+    pthread_mutex_unlock(&DIStatsMutex);
+    return site;
+}
+
+id (^DIStatsGetterBlock(id (^block)(id), Class klass, SEL getter))(id) {
+    if (!atomic_load_explicit(&DIStatsEnabled, memory_order_relaxed)) {
+        return block;
+    }
+    DIStatsSite site = DIStatsSiteRegister(klass, getter, NO);
+    if (site == DIStatsSiteNone) {
+        return block;
+    }
+    return ^id(id target) {
+        if (!atomic_load_explicit(&DIStatsEnabled, memory_order_relaxed)) {
+            return block(target);
+        }
+        DIStatsThread *thread = DIStatsCurrentThread();
+        BOOL outerSlowPath = thread->slowPath; // Getter can be called by provider of other getter
+        thread->slowPath = NO;
+        BOOL sampled = DIStatsShouldSample(thread);
+        uint64_t start = sampled ? mach_absolute_time() : 0;
+        id result = block(target);
+        DIStatsRecord(thread, site, sampled, start, thread->slowPath);
+        thread->slowPath = outerSlowPath;
+        return result;
+    };
+}
+
+void (^DIStatsSetterBlock(void (^block)(id, id), Class klass, SEL setter))(id, id) {
+    if (!atomic_load_explicit(&DIStatsEnabled, memory_order_relaxed)) {
+        return block;
+    }
+    DIStatsSite site = DIStatsSiteRegister(klass, setter, YES);
+    if (site == DIStatsSiteNone) {
+        return block;
+    }
+    return ^void(id target, id value) {
+        if (!atomic_load_explicit(&DIStatsEnabled, memory_order_relaxed)) {
+            block(target, value);
+            return;
+        }
+        DIStatsThread *thread = DIStatsCurrentThread();
+        BOOL sampled = DIStatsShouldSample(thread);
+        uint64_t start = sampled ? mach_absolute_time() : 0;
+        block(target, value);
+        DIStatsRecord(thread, site, sampled, start, NO);
+    };
+}
+
+//
+
+@interface DIAccessorStats ()
+
+@property (unsafe_unretained, nonatomic) Class targetClass;
+@property (assign, nonatomic) SEL selector;
+@property (assign, nonatomic) BOOL setter;
+@property (assign, nonatomic) uint64_t calls;
+@property (assign, nonatomic) uint64_t slowPaths;
+@property (assign, nonatomic) uint64_t sampledCalls;
+@property (copy, nonatomic) NSArray<NSNumber *> *latencyHistogram;
+
+@end
+
+@implementation DIAccessorStats
+
+- (NSTimeInterval)latencyAtPercentile:(double)percentile {
+    if (self.sampledCalls == 0) {
+        return 0;
+    }
+    uint64_t target = MAX((uint64_t)ceil(percentile * self.sampledCalls), 1);
+    uint64_t count = 0;
+    for (NSUInteger bucket = 0; bucket < self.latencyHistogram.count; bucket++) {
+        count += self.latencyHistogram[bucket].unsignedLongLongValue;
+        if (count >= target) {
+            return (double)(1ull << bucket) / NSEC_PER_SEC;
+        }
+    }
+    return (double)(1ull << (DIStatsBucketsCount - 1)) / NSEC_PER_SEC;
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %p %c[%@ %@] calls: %llu, slowPaths: %llu, p50: %.0fns, p99: %.0fns>",
+            [self class], self, class_isMetaClass(self.targetClass) ? '+' : '-',
+            self.targetClass, NSStringFromSelector(self.selector),
+            self.calls, self.slowPaths,
+            [self latencyAtPercentile:0.5] * NSEC_PER_SEC, [self latencyAtPercentile:0.99] * NSEC_PER_SEC];
+}
+
+@end
+
+//
+
+@implementation DeluxeInjection (DIStats)
+
++ (void)setStatsEnabled:(BOOL)enabled {
+    atomic_store(&DIStatsEnabled, enabled);
+}
+
++ (BOOL)statsEnabled {
+    return atomic_load(&DIStatsEnabled);
+}
+
++ (void)setStatsSampleInterval:(NSUInteger)sampleInterval {
+    atomic_store(&DIStatsSampleInterval, MAX(sampleInterval, 1));
+}
+
++ (NSArray<DIAccessorStats *> *)statsSnapshot {
+    NSMutableArray<DIAccessorStats *> *snapshot = [NSMutableArray array];
+    DIStatsTable *table = calloc(1, sizeof(DIStatsTable));
+
+    pthread_mutex_lock(&DIStatsMutex);
+    DIStatsTableAddAllThreads(table);
+    DIStatsTableAdd(table, &DIStatsBaseline, -1);
+    for (DIStatsSite site = 0; site < DIStatsSitesCount; site++) {
+        DIStatsCounters *counters = DIStatsTableCounters(table, site);
+        uint64_t calls = atomic_load_explicit(&counters->calls, memory_order_relaxed);
+        if (calls == 0) {
+            continue;
+        }
+        DIAccessorStats *stats = [[DIAccessorStats alloc] init];
+        stats.targetClass = DIStatsSites[site].klass;
+        stats.selector = DIStatsSites[site].selector;
+        stats.setter = DIStatsSites[site].setter;
+        stats.calls = calls;
+        stats.slowPaths = atomic_load_explicit(&counters->slowPaths, memory_order_relaxed);
+        stats.sampledCalls = atomic_load_explicit(&counters->sampledCalls, memory_order_relaxed);
+        NSMutableArray<NSNumber *> *histogram = [NSMutableArray arrayWithCapacity:DIStatsBucketsCount];
+        for (NSUInteger bucket = 0; bucket < DIStatsBucketsCount; bucket++) {
+            [histogram addObject:@(atomic_load_explicit(&counters->histogram[bucket], memory_order_relaxed))];
+        }
+        stats.latencyHistogram = histogram;
+        [snapshot addObject:stats];
+    }
+    pthread_mutex_unlock(&DIStatsMutex);
+
+    DIStatsTableClear(table);
+    free(table);
+
+    [snapshot sortUsingComparator:^NSComparisonResult(DIAccessorStats *stats1, DIAccessorStats *stats2) {
+        return (stats1.calls > stats2.calls) ? NSOrderedAscending : (stats1.calls < stats2.calls) ? NSOrderedDescending : NSOrderedSame;
+    }];
+    return snapshot;
+}
+
++ (void)resetStats {
+    pthread_mutex_lock(&DIStatsMutex);
+    DIStatsTableClear(&DIStatsBaseline);
+    DIStatsTableAddAllThreads(&DIStatsBaseline);
+    pthread_mutex_unlock(&DIStatsMutex);
+}
+
+@end
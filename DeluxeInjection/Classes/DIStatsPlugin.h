@@ -0,0 +1,47 @@
+//
+//  DIStatsPlugin.h
+//  DeluxeInjection
+//
+//  Copyright (c) 2016 Anton Bukov <k06aaa@gmail.com>
+//
+//  Licensed under the MIT License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  https://opensource.org/licenses/MIT
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import <objc/runtime.h>
+#import <stdatomic.h>
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+extern _Atomic(BOOL) DIStatsEnabled;
+
+/**
+ *  Wrap injected accessor blocks to count their calls, blocks are returned as is while stats are disabled
+ */
+id (^DIStatsGetterBlock(id (^block)(id), Class klass, SEL getter))(id);
+void (^DIStatsSetterBlock(void (^block)(id, id), Class klass, SEL setter))(id, id);
+
+void DIStatsMarkSlowPath(void);
+
+/**
+ *  Mark current accessor call as slow path, should be called right before invoking provider block,
+ *  costs single relaxed load while stats are disabled
+ */
+static inline void DIStatsNoteSlowPath(void) {
+    if (atomic_load_explicit(&DIStatsEnabled, memory_order_relaxed)) {
+        DIStatsMarkSlowPath();
+    }
+}
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,52 @@
+//
+//  DITrace.h
+//  DeluxeInjection
+//
+//  Copyright (c) 2016 Anton Bukov <k06aaa@gmail.com>
+//
+//  Licensed under the MIT License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  https://opensource.org/licenses/MIT
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import "DIDeluxeInjection.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface DeluxeInjection (DITrace)
+
+/**
+ *  Start recording spans of index building, injections and rejections, accessors replacement,
+ *  imperative resolving and lazy values construction inside injected getters.
+ *  Every span carries names of classes and properties and is attributed to its thread.
+ *
+ *  @param path Path of Chrome trace-event JSON file to be written by \c stopTracing,
+ *              open it in \c chrome://tracing or Perfetto
+ */
++ (void)startTracingToPath:(NSString *)path;
+
+/**
+ *  Stop recording spans and write them to file passed to \c startTracingToPath:
+ *
+ *  @return \c YES if file was written
+ */
++ (BOOL)stopTracing;
+
+/**
+ *  Check if spans are being recorded
+ *
+ *  @return \c YES between \c startTracingToPath: and \c stopTracing calls
+ */
++ (BOOL)isTracing;
+
+@end
+
+NS_ASSUME_NONNULL_END
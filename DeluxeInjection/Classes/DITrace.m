@@ -0,0 +1,150 @@
+//
+//  DITrace.m
+//  DeluxeInjection
+//
+//  Copyright (c) 2016 Anton Bukov <k06aaa@gmail.com>
+//
+//  Licensed under the MIT License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  https://opensource.org/licenses/MIT
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import <pthread.h>
+
+#import "DITrace.h"
+#import "DITracePlugin.h"
+
+_Atomic(BOOL) DITraceEnabled = NO;
+
+@interface DITraceEvent : NSObject {
+@public
+    const char *_category;
+    NSString *_name;
+    NSDictionary<NSString *, id> *_args;
+    uint64_t _start;
+    uint64_t _end;
+    uint64_t _tid;
+}
+
+@end
+
+@implementation DITraceEvent
+
+@end
+
+//
+
+// Guards all trace state, spans are recorded when they end
+static pthread_mutex_t DITraceMutex = PTHREAD_MUTEX_INITIALIZER;
+static NSMutableArray<DITraceEvent *> *DITraceEvents;
+static NSMutableDictionary<NSNumber *, NSString *> *DITraceThreadNames;
+static NSString *DITracePath;
+static uint64_t DITraceStartTime;
+
+static double DITraceMicroseconds(uint64_t ticks) {
+    static mach_timebase_info_data_t timebase;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        mach_timebase_info(&timebase);
+    });
+    return (double)ticks * timebase.numer / timebase.denom / NSEC_PER_USEC;
+}
+
+static NSString *DITraceCurrentThreadName(void) {
+    if (pthread_main_np()) {
+        return @"Main Thread";
+    }
+    char name[256] = {0};
+    pthread_getname_np(pthread_self(), name, sizeof(name));
+    if (name[0] == '\0') {
+        const char *label = dispatch_queue_get_label(DISPATCH_CURRENT_QUEUE_LABEL);
+        if (label) {
+            strlcpy(name, label, sizeof(name));
+        }
+    }
+    return name[0] ? @(name) : [NSString stringWithFormat:@"Thread %u", pthread_mach_thread_np(pthread_self())];
+}
+
+void DITraceEnd(uint64_t start, const char *category, NSString *name, NSDictionary<NSString *, id> *args) {
+    DITraceEvent *event = [[DITraceEvent alloc] init];
+    event->_category = category;
+    event->_name = name;
+    event->_args = args;
+    event->_start = start;
+    event->_end = mach_absolute_time();
+    event->_tid = pthread_mach_thread_np(pthread_self());
+
+    pthread_mutex_lock(&DITraceMutex);
+    // Spans started before current tracing session are dropped
+    if (DITraceEvents && start >= DITraceStartTime) {
+        [DITraceEvents addObject:event];
+        if (DITraceThreadNames[@(event->_tid)] == nil) {
+            DITraceThreadNames[@(event->_tid)] = DITraceCurrentThreadName();
+        }
+    }
+    pthread_mutex_unlock(&DITraceMutex);
+}
+
+//
+
+@implementation DeluxeInjection (DITrace)
+
++ (void)startTracingToPath:(NSString *)path {
+    pthread_mutex_lock(&DITraceMutex);
+    DITraceEvents = [NSMutableArray array];
+    DITraceThreadNames = [NSMutableDictionary dictionary];
+    DITracePath = [path copy];
+    DITraceStartTime = mach_absolute_time();
+    atomic_store(&DITraceEnabled, YES);
+    pthread_mutex_unlock(&DITraceMutex);
+}
+
++ (BOOL)stopTracing {
+    pthread_mutex_lock(&DITraceMutex);
+    atomic_store(&DITraceEnabled, NO);
+    NSArray<DITraceEvent *> *events = DITraceEvents;
+    NSDictionary<NSNumber *, NSString *> *threadNames = DITraceThreadNames;
+    NSString *path = DITracePath;
+    uint64_t startTime = DITraceStartTime;
+    DITraceEvents = nil;
+    DITraceThreadNames = nil;
+    DITracePath = nil;
+    pthread_mutex_unlock(&DITraceMutex);
+
+    if (path == nil) {
+        return NO;
+    }
+
+    NSNumber *pid = @([NSProcessInfo processInfo].processIdentifier);
+    NSMutableArray<NSDictionary *> *traceEvents = [NSMutableArray arrayWithCapacity:events.count + threadNames.count];
+    [threadNames enumerateKeysAndObjectsUsingBlock:^(NSNumber *tid, NSString *name, BOOL *stop) {
+        [traceEvents addObject:@{ @"name" : @"thread_name", @"ph" : @"M", @"pid" : pid, @"tid" : tid, @"args" : @{ @"name" : name } }];
+    }];
+    for (DITraceEvent *event in events) {
+        [traceEvents addObject:@{ @"name" : event->_name,
+                                  @"cat" : @(event->_category),
+                                  @"ph" : @"X",
+                                  @"ts" : @(DITraceMicroseconds(event->_start - startTime)),
+                                  @"dur" : @(DITraceMicroseconds(event->_end - event->_start)),
+                                  @"pid" : pid,
+                                  @"tid" : @(event->_tid),
+                                  @"args" : event->_args ?: @{} }];
+    }
+
+    NSData *data = [NSJSONSerialization dataWithJSONObject:@{ @"traceEvents" : traceEvents, @"displayTimeUnit" : @"ms" } options:0 error:NULL];
+    return [data writeToFile:path atomically:YES];
+}
+
++ (BOOL)isTracing {
+    return atomic_load(&DITraceEnabled);
+}
+
+@end
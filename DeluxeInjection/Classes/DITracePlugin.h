@@ -0,0 +1,55 @@
+//
+//  DITracePlugin.h
+//  DeluxeInjection
+//
+//  Copyright (c) 2016 Anton Bukov <k06aaa@gmail.com>
+//
+//  Licensed under the MIT License (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  https://opensource.org/licenses/MIT
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+//
+
+#import <mach/mach_time.h>
+#import <stdatomic.h>
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+extern _Atomic(BOOL) DITraceEnabled;
+
+/**
+ *  Begin span, costs single relaxed load while tracing is stopped
+ *
+ *  @return Start time of span or \c 0 if tracing is stopped
+ */
+static inline uint64_t DITraceBegin(void) {
+    return atomic_load_explicit(&DITraceEnabled, memory_order_relaxed) ? mach_absolute_time() : 0;
+}
+
+/**
+ *  End span started with \c DITraceBegin, should be called only for nonzero \c start,
+ *  so name and arguments are not created while tracing is stopped: \code
+ *uint64_t traceStart = DITraceBegin();
+ *...
+ *if (traceStart) {
+ *    DITraceEnd(traceStart, "inject", @"inject", @{ @"class" : NSStringFromClass(klass) });
+ *}
+ *  \endcode
+ *
+ *  @param start    Start time returned by \c DITraceBegin
+ *  @param category Category of span
+ *  @param name     Name of span
+ *  @param args     Arguments shown for span, like class and property names
+ */
+void DITraceEnd(uint64_t start, const char *category, NSString *name, NSDictionary<NSString *, id> *_Nullable args);
+
+NS_ASSUME_NONNULL_END
@@ -27,6 +27,12 @@
 #import "DILazy.h"
 #import "DIDefaults.h"
 #import "DIAssociate.h"
+#import "DIPrewarm.h"
+#import "DIScope.h"
+#import "DIDependencyGraph.h"
+#import "DIManifest.h"
+#import "DIStats.h"
+#import "DITrace.h"
 
 #import "DIImperative.h"
 
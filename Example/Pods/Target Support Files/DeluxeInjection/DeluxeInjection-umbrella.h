@@ -13,14 +13,32 @@
 #import "DeluxeInjection.h"
 #import "DIAssociate.h"
 #import "DIDefaults.h"
+#import "DIDefaultsCodec.h"
+#import "DIDefaultsStorage.h"
 #import "DIDeluxeInjection.h"
 #import "DIDeluxeInjectionPlugin.h"
+#import "DIDependencyGraph.h"
 #import "DIForceInject.h"
 #import "DIImperative.h"
 #import "DIImperativePlugin.h"
+#import "DIIndexCache.h"
 #import "DIInject.h"
 #import "DIInjectPlugin.h"
 #import "DILazy.h"
+#import "DIManifest.h"
+#import "DIMappedStorage.h"
+#import "DIPrewarm.h"
+#import "DIPrewarmPlugin.h"
+#import "DIPropertyAttributes.h"
+#import "DIPropertyIndex.h"
+#import "DIRegistry.h"
+#import "DIScanScope.h"
+#import "DIScope.h"
+#import "DISideTable.h"
+#import "DIStats.h"
+#import "DIStatsPlugin.h"
+#import "DITrace.h"
+#import "DITracePlugin.h"
 
 FOUNDATION_EXPORT double DeluxeInjectionVersionNumber;
 FOUNDATION_EXPORT const unsigned char DeluxeInjectionVersionString[];
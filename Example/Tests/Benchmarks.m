@@ -6,10 +6,148 @@
 //  Copyright © 2016 Anton Bukov. All rights reserved.
 //
 
+#import <malloc/malloc.h>
+#import <objc/runtime.h>
+
+#import <RuntimeRoutines/RuntimeRoutines.h>
+
 #import <DeluxeInjection/DeluxeInjection.h>
+#import <DeluxeInjection/DIPropertyIndex.h>
+#import <DeluxeInjection/DISideTable.h>
 
 #import "AbstractTests.h"
 
+@protocol DIBenchmarksMarker <NSObject>
+
+@end
+
+static NSUInteger const DIBenchmarksSyntheticClassesCount = 20000;
+
+static void DIBenchmarksRegisterSyntheticClasses() {
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        objc_property_attribute_t markedAttributes[] = {{"T", "@\"NSObject<DIBenchmarksMarker>\""}, {"&", ""}, {"N", ""}};
+        objc_property_attribute_t plainAttributes[] = {{"T", "@\"NSString\""}, {"C", ""}, {"N", ""}};
+        for (NSUInteger i = 0; i < DIBenchmarksSyntheticClassesCount; i++) {
+            NSString *className = [NSString stringWithFormat:@"DIBenchmarksSynthetic%05lu", (unsigned long)i];
+            Class klass = objc_allocateClassPair([NSObject class], className.UTF8String, 0);
+            class_addProperty(klass, "marked", markedAttributes, 3);
+            for (NSUInteger j = 0; j < 4; j++) {
+                class_addProperty(klass, [NSString stringWithFormat:@"plain%lu", (unsigned long)j].UTF8String, plainAttributes, 3);
+            }
+            objc_registerClassPair(klass);
+        }
+    });
+}
+
+@interface DIBenchmarksImperativeValue : NSObject
+
+@end
+
+@implementation DIBenchmarksImperativeValue
+
+@end
+
+static NSUInteger const DIBenchmarksImperativeRootsCount = 100;
+static NSUInteger const DIBenchmarksImperativeSubclassesCount = 39;
+
+static Class DIBenchmarksImperativeRoot(NSUInteger i) {
+    return NSClassFromString([NSString stringWithFormat:@"DIBenchmarksImperative%03lu", (unsigned long)i]);
+}
+
+static void DIBenchmarksRegisterImperativeClasses() {
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        objc_property_attribute_t attributes[] = {{"T", "@\"DIBenchmarksImperativeValue<DIInject>\""}, {"&", ""}, {"N", ""}};
+        for (NSUInteger i = 0; i < DIBenchmarksImperativeRootsCount; i++) {
+            NSString *rootName = [NSString stringWithFormat:@"DIBenchmarksImperative%03lu", (unsigned long)i];
+            Class root = objc_allocateClassPair([NSObject class], rootName.UTF8String, 0);
+            class_addProperty(root, "value", attributes, 3);
+            objc_registerClassPair(root);
+            for (NSUInteger j = 0; j < DIBenchmarksImperativeSubclassesCount; j++) {
+                NSString *className = [NSString stringWithFormat:@"%@_%02lu", rootName, (unsigned long)j];
+                Class klass = objc_allocateClassPair(root, className.UTF8String, 0);
+                class_addProperty(klass, [NSString stringWithFormat:@"value%02lu", (unsigned long)j].UTF8String, attributes, 3);
+                objc_registerClassPair(klass);
+            }
+        }
+        [[DIPropertyIndex sharedIndex] invalidate];
+    });
+}
+
+@interface DIBenchmarksAccessors : NSObject
+
+@property (strong, nonatomic) NSObject *plainObject;
+@property (strong, nonatomic) NSObject<DIInject> *injectedObject;
+@property (strong, nonatomic) NSObject<DIAssociate> *associatedObject;
+
+@end
+
+@implementation DIBenchmarksAccessors
+
+@end
+
+static NSUInteger const DIBenchmarksGetterCallsCount = 1000000;
+
+static CFAbsoluteTime DIBenchmarksMeasureGetter(DIBenchmarksAccessors *object, SEL getter) {
+    id (*getterImp)(id, SEL) = (id (*)(id, SEL))[object methodForSelector:getter];
+    CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+    for (NSUInteger i = 0; i < DIBenchmarksGetterCallsCount; i++) {
+        @autoreleasepool {
+            getterImp(object, getter);
+        }
+    }
+    return CFAbsoluteTimeGetCurrent() - startTime;
+}
+
+//
+
+@interface DIBenchmarksSettings : NSObject <NSCoding>
+
+@property (copy, nonatomic) NSString *username;
+@property (strong, nonatomic) NSDate *lastLogin;
+@property (assign, nonatomic) NSInteger launchCount;
+@property (assign, nonatomic) BOOL notificationsEnabled;
+
+@end
+
+@implementation DIBenchmarksSettings
+
+- (instancetype)initWithCoder:(NSCoder *)coder {
+    self = [super init];
+    if (self) {
+        _username = [coder decodeObjectForKey:@"username"];
+        _lastLogin = [coder decodeObjectForKey:@"lastLogin"];
+        _launchCount = [coder decodeIntegerForKey:@"launchCount"];
+        _notificationsEnabled = [coder decodeBoolForKey:@"notificationsEnabled"];
+    }
+    return self;
+}
+
+- (void)encodeWithCoder:(NSCoder *)coder {
+    [coder encodeObject:self.username forKey:@"username"];
+    [coder encodeObject:self.lastLogin forKey:@"lastLogin"];
+    [coder encodeInteger:self.launchCount forKey:@"launchCount"];
+    [coder encodeBool:self.notificationsEnabled forKey:@"notificationsEnabled"];
+}
+
+@end
+
+static NSUInteger const DIBenchmarksCodecIterationsCount = 10000;
+
+static CFAbsoluteTime DIBenchmarksMeasureCodec(id<DIDefaultsCodec> codec, id value, NSUInteger *size) {
+    *size = [codec encodeObject:value].length;
+    CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+    for (NSUInteger i = 0; i < DIBenchmarksCodecIterationsCount; i++) {
+        @autoreleasepool {
+            [codec decodeData:[codec encodeObject:value]];
+        }
+    }
+    return CFAbsoluteTimeGetCurrent() - startTime;
+}
+
+//
+
 @interface Benchmarks : AbstractTests
 
 @end
@@ -32,6 +170,221 @@
     }];
 }
 
+- (void)testInjectSeveralPlugins {
+    [self measureBlock:^{
+        [DeluxeInjection injectLazy];
+        [DeluxeInjection injectDefaults];
+        [DeluxeInjection injectAssociate];
+        [DeluxeInjection inject:^id(Class targetClass, SEL getter, NSString *propertyName, Class propertyClass, NSSet<Protocol *> *propertyProtocols) {
+            return [DeluxeInjection doNotInject];
+        }];
+        [DeluxeInjection forceInject:^id(Class targetClass, SEL getter, NSString *propertyName, Class propertyClass, NSSet<Protocol *> *propertyProtocols) {
+            return [DeluxeInjection doNotInject];
+        }];
+        
+        [DeluxeInjection rejectLazy];
+        [DeluxeInjection rejectDefaults];
+        [DeluxeInjection rejectAssociate];
+    }];
+}
+
+- (void)testInjectSeveralPluginsInPlan {
+    [self measureBlock:^{
+        [DeluxeInjection injectPlan:^{
+            [DeluxeInjection injectLazy];
+            [DeluxeInjection injectDefaults];
+            [DeluxeInjection injectAssociate];
+            [DeluxeInjection inject:^id(Class targetClass, SEL getter, NSString *propertyName, Class propertyClass, NSSet<Protocol *> *propertyProtocols) {
+                return [DeluxeInjection doNotInject];
+            }];
+            [DeluxeInjection forceInject:^id(Class targetClass, SEL getter, NSString *propertyName, Class propertyClass, NSSet<Protocol *> *propertyProtocols) {
+                return [DeluxeInjection doNotInject];
+            }];
+        }];
+        
+        [DeluxeInjection injectPlan:^{
+            [DeluxeInjection rejectLazy];
+            [DeluxeInjection rejectDefaults];
+            [DeluxeInjection rejectAssociate];
+        }];
+    }];
+}
+
+- (void)testDiscoveryScaling {
+    DIBenchmarksRegisterSyntheticClasses();
+    DIScanScope *scope = [DIScanScope scopeWithImages:nil classPrefixes:@[@"DIBenchmarksSynthetic"] includeMetaClasses:YES];
+    
+    NSArray<DIPropertyDescriptor *> *serialDescriptors = nil;
+    NSUInteger processorsCount = [NSProcessInfo processInfo].activeProcessorCount;
+    for (NSUInteger threadsCount = 1; ; threadsCount = MIN(threadsCount * 2, processorsCount)) {
+        DIPropertyIndex *index = [[DIPropertyIndex alloc] init];
+        index.scanScope = scope;
+        index.discoveryConcurrency = threadsCount;
+        
+        CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+        NSArray<DIPropertyDescriptor *> *descriptors = [index descriptorsForProtocol:@protocol(DIBenchmarksMarker)];
+        NSLog(@"Discovery of %lu classes with %lu threads took %.3f sec",
+              (unsigned long)DIBenchmarksSyntheticClassesCount,
+              (unsigned long)threadsCount,
+              CFAbsoluteTimeGetCurrent() - startTime);
+        
+        XCTAssertEqual(descriptors.count, DIBenchmarksSyntheticClassesCount);
+        if (serialDescriptors == nil) {
+            serialDescriptors = descriptors;
+        }
+        else {
+            XCTAssertEqualObjects([descriptors valueForKey:@"targetClass"], [serialDescriptors valueForKey:@"targetClass"], @"Parallel discovery should keep order");
+        }
+        
+        if (threadsCount == processorsCount) {
+            break;
+        }
+    }
+}
+
+- (void)testPropertyAttributesAllocations {
+    DIBenchmarksRegisterSyntheticClasses();
+    
+    __block NSUInteger propertiesCount = 0;
+    objc_property_t *properties = malloc(DIBenchmarksSyntheticClassesCount * 5 * sizeof(objc_property_t));
+    for (NSUInteger i = 0; i < DIBenchmarksSyntheticClassesCount; i++) {
+        NSString *className = [NSString stringWithFormat:@"DIBenchmarksSynthetic%05lu", (unsigned long)i];
+        RRClassEnumerateProperties(NSClassFromString(className), ^(objc_property_t property) {
+            properties[propertiesCount++] = property;
+        });
+    }
+    
+    // Warm up interned protocols sets
+    DIPropertyAttributes attributes;
+    for (NSUInteger i = 0; i < propertiesCount; i++) {
+        DIPropertyAttributesParse(properties[i], &attributes);
+    }
+    
+    malloc_statistics_t before;
+    malloc_statistics_t after;
+    
+    @autoreleasepool {
+        CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+        malloc_zone_statistics(NULL, &before);
+        for (NSUInteger i = 0; i < propertiesCount; i++) {
+            objc_property_t property = properties[i];
+            char *attributeNames[] = {"V", "R", "W", "N", "C", "&"};
+            for (NSUInteger j = 0; j < sizeof(attributeNames)/sizeof(attributeNames[0]); j++) {
+                RRPropertyGetAttribute(property, attributeNames[j]);
+            }
+            RRPropertyGetClassAndProtocols(property, ^(Class klass, NSSet<Protocol *> *protocols) {});
+        }
+        malloc_zone_statistics(NULL, &after);
+        NSLog(@"RuntimeRoutines: %.2f blocks per property, %.3f sec",
+              ((double)after.blocks_in_use - (double)before.blocks_in_use) / propertiesCount,
+              CFAbsoluteTimeGetCurrent() - startTime);
+    }
+    
+    @autoreleasepool {
+        CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+        malloc_zone_statistics(NULL, &before);
+        for (NSUInteger i = 0; i < propertiesCount; i++) {
+            DIPropertyAttributesParse(properties[i], &attributes);
+        }
+        malloc_zone_statistics(NULL, &after);
+        double blocksPerProperty = ((double)after.blocks_in_use - (double)before.blocks_in_use) / propertiesCount;
+        NSLog(@"DIPropertyAttributes: %.2f blocks per property, %.3f sec",
+              blocksPerProperty,
+              CFAbsoluteTimeGetCurrent() - startTime);
+        XCTAssertLessThan(blocksPerProperty, 0.01);
+    }
+    
+    free(properties);
+}
+
+- (void)testInjectedGetterCost {
+    NSObject *value = [NSObject new];
+    [DeluxeInjection inject:^id(Class targetClass, SEL getter, NSString *propertyName, Class propertyClass, NSSet<Protocol *> *propertyProtocols) {
+        return (targetClass == [DIBenchmarksAccessors class]) ? value : [DeluxeInjection doNotInject];
+    }];
+    [DeluxeInjection injectAssociate];
+    
+    DIBenchmarksAccessors *object = [DIBenchmarksAccessors new];
+    object.plainObject = value;
+    object.associatedObject = value;
+    XCTAssertEqual(object.injectedObject, value);
+    XCTAssertEqual(object.associatedObject, value);
+    
+    CFAbsoluteTime plainTime = DIBenchmarksMeasureGetter(object, @selector(plainObject));
+    CFAbsoluteTime injectedTime = DIBenchmarksMeasureGetter(object, @selector(injectedObject));
+    CFAbsoluteTime associatedTime = DIBenchmarksMeasureGetter(object, @selector(associatedObject));
+    NSLog(@"Getter call: synthesized %.1f ns, DIInject value %.1f ns, DIAssociate %.1f ns",
+          plainTime * 1e9 / DIBenchmarksGetterCallsCount,
+          injectedTime * 1e9 / DIBenchmarksGetterCallsCount,
+          associatedTime * 1e9 / DIBenchmarksGetterCallsCount);
+    
+    [DeluxeInjection rejectAll];
+    [DeluxeInjection rejectAssociate];
+}
+
+- (void)testSideTableFreshObjects {
+    static char key;
+    static char otherKey;
+    NSUInteger const objectsCount = 100000;
+    NSObject *value = [NSObject new];
+    
+    // Every object is new, so every first store pays for dealloc sentinel association
+    CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+    @autoreleasepool {
+        for (NSUInteger i = 0; i < objectsCount; i++) {
+            objc_setAssociatedObject([NSObject new], &key, value, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+        }
+    }
+    CFAbsoluteTime associationTime = CFAbsoluteTimeGetCurrent() - startTime;
+    
+    startTime = CFAbsoluteTimeGetCurrent();
+    @autoreleasepool {
+        for (NSUInteger i = 0; i < objectsCount; i++) {
+            DISideTableSet([NSObject new], &key, value, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+        }
+    }
+    CFAbsoluteTime firstTouchTime = CFAbsoluteTimeGetCurrent() - startTime;
+    
+    NSObject *object = [NSObject new];
+    DISideTableSet(object, &key, value, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    startTime = CFAbsoluteTimeGetCurrent();
+    for (NSUInteger i = 0; i < objectsCount; i++) {
+        DISideTableSet(object, &otherKey, value, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    }
+    CFAbsoluteTime touchedTime = CFAbsoluteTimeGetCurrent() - startTime;
+    
+    NSLog(@"Store to fresh objects: runtime association %.1f ns, side table first touch %.1f ns, side table touched object %.1f ns",
+          associationTime * 1e9 / objectsCount,
+          firstTouchTime * 1e9 / objectsCount,
+          touchedTime * 1e9 / objectsCount);
+}
+
+- (void)testImperativeFilterContainerClass {
+    DIBenchmarksRegisterImperativeClasses();
+    DIBenchmarksImperativeValue *value = [DIBenchmarksImperativeValue new];
+    
+    [self measureBlock:^{
+        [DeluxeInjection imperative:^(DIImperative *lets) {
+            for (NSUInteger i = 0; i < 10; i++) {
+                [[[[lets inject] byPropertyClass:[DIBenchmarksImperativeValue class]]
+                                 filterContainerClass:DIBenchmarksImperativeRoot(i)]
+                                 getterValue:value];
+            }
+            [lets skipAsserts];
+        }];
+        
+        XCTAssertEqual([DeluxeInjection injectedClasses].count, 10 * (DIBenchmarksImperativeSubclassesCount + 1));
+        
+        [DeluxeInjection imperative:^(DIImperative *lets) {
+            for (NSUInteger i = 0; i < 10; i++) {
+                [[[lets reject] byPropertyClass:[DIBenchmarksImperativeValue class]]
+                                filterContainerClass:DIBenchmarksImperativeRoot(i)];
+            }
+            [lets skipAsserts];
+        }];
+    }];
+}
+
 - (void)testImperative {
     [self measureBlock:^{
         [DeluxeInjection imperative:^(DIImperative *lets) {
@@ -40,4 +393,32 @@
     }];
 }
 
+- (void)testDefaultsCodecs {
+    DIBenchmarksSettings *settings = [DIBenchmarksSettings new];
+    settings.username = @"k06a";
+    settings.lastLogin = [NSDate date];
+    settings.launchCount = 42;
+    settings.notificationsEnabled = YES;
+    
+    NSDictionary<NSString *, id> *values = @{
+        @"numbers" : @[@1, @2, @3, @4.5],
+        @"dictionary" : @{@"theme" : @"dark", @"fontSize" : @14, @"tags" : @[@"a", @"b"]},
+        @"object" : settings,
+        @"objects" : @[settings, settings, settings],
+    };
+    
+    id<DIDefaultsCodec> keyedCodec = [DIKeyedArchiverCodec new];
+    id<DIDefaultsCodec> binaryCodec = [DIBinaryCodec new];
+    for (NSString *name in values) {
+        NSUInteger keyedSize;
+        NSUInteger binarySize;
+        CFAbsoluteTime keyedTime = DIBenchmarksMeasureCodec(keyedCodec, values[name], &keyedSize);
+        CFAbsoluteTime binaryTime = DIBenchmarksMeasureCodec(binaryCodec, values[name], &binarySize);
+        NSLog(@"Codec %@: NSKeyedArchiver %lu bytes %.2f us, DIBinaryCodec %lu bytes %.2f us per encode+decode",
+              name, (unsigned long)keyedSize, keyedTime * 1e6 / DIBenchmarksCodecIterationsCount,
+              (unsigned long)binarySize, binaryTime * 1e6 / DIBenchmarksCodecIterationsCount);
+        XCTAssertLessThan(binarySize, keyedSize);
+    }
+}
+
 @end
@@ -0,0 +1,192 @@
+//
+//  DIAssociateTests.m
+//  DeluxeInjection
+//
+//  Created by agent on 17.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#import "AbstractTests.h"
+
+#import <DeluxeInjection/DeluxeInjection.h>
+
+//
+
+@interface DIAssociateTests_Class : NSObject
+
+@property (strong, nonatomic) NSObject<DIAssociate> *strongObject;
+@property (weak, nonatomic) NSObject<DIAssociate> *weakObject;
+@property (unsafe_unretained, nonatomic) NSObject<DIAssociate> *unsafeObject;
+@property (copy, nonatomic) NSString<DIAssociate> *copiedString;
+
+@end
+
+@implementation DIAssociateTests_Class
+
+@end
+
+/**
+ *  Readonly properties have strong ivars without ownership in property attributes
+ */
+@interface DIAssociateTests_ReadonlyClass : NSObject
+
+@property (readonly, nonatomic) NSObject<DIInject> *injectedObject;
+@property (readonly, nonatomic) NSMutableArray<DILazy> *lazyArray;
+
+@end
+
+@implementation DIAssociateTests_ReadonlyClass
+
+@end
+
+//
+
+@interface DIAssociateTests : AbstractTests
+
+@end
+
+@implementation DIAssociateTests
+
+- (void)setUp {
+    [super setUp];
+    
+    [DeluxeInjection injectAssociate];
+}
+
+- (void)tearDown {
+    [DeluxeInjection rejectAssociate];
+    
+    [super tearDown];
+}
+
+- (void)testInjected {
+    XCTAssertTrue([DeluxeInjection checkInjected:[DIAssociateTests_Class class] selector:@selector(strongObject)]);
+    XCTAssertTrue([DeluxeInjection checkInjected:[DIAssociateTests_Class class] selector:@selector(setWeakObject:)]);
+    XCTAssertTrue([DeluxeInjection checkInjected:[DIAssociateTests_Class class] selector:@selector(unsafeObject)]);
+    XCTAssertTrue([DeluxeInjection checkInjected:[DIAssociateTests_Class class] selector:@selector(setCopiedString:)]);
+}
+
+- (void)testStrongIvar {
+    __weak id weakObject = nil;
+    DIAssociateTests_Class *test = [DIAssociateTests_Class new];
+    @autoreleasepool {
+        NSObject *object = [NSObject new];
+        weakObject = object;
+        test.strongObject = object;
+        XCTAssertEqual(test.strongObject, object);
+    }
+    
+    XCTAssertNotNil(weakObject);
+    XCTAssertEqual(test.strongObject, weakObject);
+    
+    @autoreleasepool {
+        test.strongObject = nil;
+    }
+    XCTAssertNil(test.strongObject);
+    XCTAssertNil(weakObject);
+}
+
+- (void)testWeakIvar {
+    DIAssociateTests_Class *test = [DIAssociateTests_Class new];
+    NSObject *object = [NSObject new];
+    test.weakObject = object;
+    XCTAssertEqual(test.weakObject, object);
+    
+    test.weakObject = nil;
+    XCTAssertNil(test.weakObject);
+}
+
+- (void)testWeakIvarNilAfterDealloc {
+    __weak id weakObject = nil;
+    DIAssociateTests_Class *test = [DIAssociateTests_Class new];
+    @autoreleasepool {
+        NSObject *object = [NSObject new];
+        weakObject = object;
+        test.weakObject = object;
+        XCTAssertEqual(test.weakObject, object);
+    }
+    
+    XCTAssertNil(weakObject);
+    XCTAssertNil(test.weakObject);
+}
+
+- (void)testUnsafeUnretainedIvar {
+    __weak id weakObject = nil;
+    DIAssociateTests_Class *test = [DIAssociateTests_Class new];
+    NSObject *object = [NSObject new];
+    @autoreleasepool {
+        weakObject = object;
+        test.unsafeObject = object;
+        XCTAssertEqual(test.unsafeObject, object);
+    }
+    
+    // Setter must not retain value, so releasing our reference deallocates it
+    object = nil;
+    XCTAssertNil(weakObject);
+    
+    test.unsafeObject = nil;
+    XCTAssertNil(test.unsafeObject);
+}
+
+- (void)testCopyIvar {
+    DIAssociateTests_Class *test = [DIAssociateTests_Class new];
+    NSMutableString *string = [NSMutableString stringWithString:@"abc"];
+    
+    test.copiedString = (id)string;
+    [string appendString:@"def"];
+    
+    XCTAssertNotEqual((id)test.copiedString, (id)string);
+    XCTAssertEqualObjects(test.copiedString, @"abc");
+    
+    test.copiedString = nil;
+    XCTAssertNil(test.copiedString);
+}
+
+- (void)testReadonlyInjectIvar {
+    [DeluxeInjection injectBlock:^DIGetter(Class targetClass, SEL getter, NSString *propertyName, Class propertyClass, NSSet<Protocol *> *propertyProtocols) {
+        if (targetClass != [DIAssociateTests_ReadonlyClass class]) {
+            return nil;
+        }
+        return DIGetterIfIvarIsNil(^id(id target, SEL cmd) {
+            return [NSObject new];
+        });
+    }];
+    
+    __weak id weakObject = nil;
+    DIAssociateTests_ReadonlyClass *test = [DIAssociateTests_ReadonlyClass new];
+    @autoreleasepool {
+        weakObject = test.injectedObject;
+        XCTAssertNotNil(weakObject);
+    }
+    XCTAssertNotNil(weakObject, @"Value should be retained by strong ivar of readonly property");
+    XCTAssertEqual(test.injectedObject, weakObject);
+    
+    @autoreleasepool {
+        test = nil;
+    }
+    XCTAssertNil(weakObject, @"Value should be released with object");
+    
+    [DeluxeInjection rejectAll];
+}
+
+- (void)testReadonlyLazyIvar {
+    [DeluxeInjection injectLazy];
+    
+    __weak id weakArray = nil;
+    DIAssociateTests_ReadonlyClass *test = [DIAssociateTests_ReadonlyClass new];
+    @autoreleasepool {
+        weakArray = test.lazyArray;
+        XCTAssertNotNil(weakArray);
+    }
+    XCTAssertNotNil(weakArray, @"Lazy value should be retained by strong ivar of readonly property");
+    XCTAssertEqual(test.lazyArray, weakArray);
+    
+    @autoreleasepool {
+        test = nil;
+    }
+    XCTAssertNil(weakArray, @"Lazy value should be released with object");
+    
+    [DeluxeInjection rejectLazy];
+}
+
+@end
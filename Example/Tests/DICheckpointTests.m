@@ -0,0 +1,96 @@
+//
+//  DICheckpointTests.m
+//  DeluxeInjection
+//
+//  Created by agent on 17.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#import "AbstractTests.h"
+
+#import <DeluxeInjection/DeluxeInjection.h>
+
+//
+
+@interface DICheckpointTests_Class : NSObject
+
+@property (strong, nonatomic) NSMutableArray<DILazy> *lazyArray;
+@property (strong, nonatomic) NSObject<DIAssociate> *associated;
+@property (strong, nonatomic) NSString<DIInject> *injected;
+
+@end
+
+@implementation DICheckpointTests_Class
+
+@dynamic associated;
+
+- (NSString *)injected {
+    return @"original";
+}
+
+@end
+
+//
+
+@interface DICheckpointTests : AbstractTests
+
+@property (strong, nonatomic) DIInjectionCheckpoint *checkpoint;
+
+@end
+
+@implementation DICheckpointTests
+
+- (void)setUp {
+    [super setUp];
+    
+    self.checkpoint = [DeluxeInjection checkpoint];
+}
+
+- (void)tearDown {
+    [DeluxeInjection restoreCheckpoint:self.checkpoint];
+    self.checkpoint = nil;
+    
+    [super tearDown];
+}
+
+- (void)testRestoreInjections {
+    [DeluxeInjection injectLazy];
+    [DeluxeInjection injectAssociate];
+    
+    DICheckpointTests_Class *test = [DICheckpointTests_Class new];
+    NSObject *object = [NSObject new];
+    test.associated = object;
+    XCTAssertNotNil(test.lazyArray);
+    XCTAssertEqual(test.associated, object);
+    
+    [DeluxeInjection restoreCheckpoint:self.checkpoint];
+    self.checkpoint = [DeluxeInjection checkpoint];
+    
+    XCTAssertEqual([DeluxeInjection injectedClasses].count, 0);
+    XCTAssertNil([DICheckpointTests_Class new].lazyArray);
+}
+
+- (void)testRestoreReinjectionAndRejection {
+    [DeluxeInjection inject:^id(Class targetClass, SEL getter, NSString *propertyName, Class propertyClass, NSSet<Protocol *> *propertyProtocols) {
+        return (targetClass == [DICheckpointTests_Class class]) ? @"first" : [DeluxeInjection doNotInject];
+    }];
+    DIInjectionCheckpoint *nested = [DeluxeInjection checkpoint];
+    
+    [DeluxeInjection rejectAll];
+    XCTAssertEqualObjects([DICheckpointTests_Class new].injected, @"original");
+    [DeluxeInjection inject:^id(Class targetClass, SEL getter, NSString *propertyName, Class propertyClass, NSSet<Protocol *> *propertyProtocols) {
+        return (targetClass == [DICheckpointTests_Class class]) ? @"second" : [DeluxeInjection doNotInject];
+    }];
+    XCTAssertEqualObjects([DICheckpointTests_Class new].injected, @"second");
+    
+    [DeluxeInjection restoreCheckpoint:nested];
+    XCTAssertEqualObjects([DICheckpointTests_Class new].injected, @"first");
+    XCTAssertTrue([DeluxeInjection checkInjected:[DICheckpointTests_Class class] selector:@selector(injected)]);
+    
+    [DeluxeInjection restoreCheckpoint:self.checkpoint];
+    self.checkpoint = [DeluxeInjection checkpoint];
+    XCTAssertEqualObjects([DICheckpointTests_Class new].injected, @"original");
+    XCTAssertFalse([DeluxeInjection checkInjected:[DICheckpointTests_Class class] selector:@selector(injected)]);
+}
+
+@end
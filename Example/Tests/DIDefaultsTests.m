@@ -16,6 +16,8 @@
 
 @property (strong, nonatomic) NSNumber<DIDefaults> *defaultsNumber;
 @property (strong, nonatomic) NSString<DIDefaults> *defaultsString;
+@property (strong, nonatomic) NSArray<DIDefaultsArchived> *defaultsArchived;
+@property (strong, nonatomic) NSString<DIDefaultsSync> *defaultsSync;
 
 @end
 
@@ -25,6 +27,119 @@
 
 //
 
+@interface DIDefaultsTests_Value : NSObject <NSCoding>
+
+@property (copy, nonatomic) NSString *name;
+@property (assign, nonatomic) NSInteger count;
+
+@end
+
+@implementation DIDefaultsTests_Value
+
+- (instancetype)initWithCoder:(NSCoder *)coder {
+    self = [super init];
+    if (self) {
+        _name = [coder decodeObjectForKey:@"name"];
+        _count = [coder decodeIntegerForKey:@"count"];
+    }
+    return self;
+}
+
+- (void)encodeWithCoder:(NSCoder *)coder {
+    [coder encodeObject:self.name forKey:@"name"];
+    [coder encodeInteger:self.count forKey:@"count"];
+}
+
+@end
+
+/**
+ *  Newer version of value with one more field and without count
+ */
+@interface DIDefaultsTests_ValueV2 : DIDefaultsTests_Value
+
+@end
+
+@implementation DIDefaultsTests_ValueV2
+
+- (Class)classForCoder {
+    return [DIDefaultsTests_Value class];
+}
+
+- (void)encodeWithCoder:(NSCoder *)coder {
+    [coder encodeObject:self.name forKey:@"name"];
+    [coder encodeObject:@[@1, @2] forKey:@"extra"];
+}
+
+@end
+
+/**
+ *  Value supporting only non-keyed coding
+ */
+@interface DIDefaultsTests_UnkeyedValue : NSObject <NSCoding>
+
+@property (copy, nonatomic) NSString *name;
+
+@end
+
+@implementation DIDefaultsTests_UnkeyedValue
+
+- (instancetype)initWithCoder:(NSCoder *)coder {
+    self = [super init];
+    if (self) {
+        _name = [coder decodeObject];
+    }
+    return self;
+}
+
+- (void)encodeWithCoder:(NSCoder *)coder {
+    [coder encodeObject:self.name];
+}
+
+@end
+
+/**
+ *  Storage counting \c synchronize calls
+ */
+@interface DIDefaultsTests_Storage : NSObject <DIDefaultsStorage>
+
+@property (strong, nonatomic) NSMutableDictionary<NSString *, id> *values;
+@property (assign, atomic) NSInteger syncCount;
+
+@end
+
+@implementation DIDefaultsTests_Storage
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _values = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
+- (id)objectForKey:(NSString *)key {
+    @synchronized(self) {
+        return self.values[key];
+    }
+}
+
+- (void)setObject:(id)value forKey:(NSString *)key {
+    @synchronized(self) {
+        self.values[key] = value;
+    }
+}
+
+- (BOOL)synchronize {
+    @synchronized(self) {
+        self.syncCount++;
+    }
+    return YES;
+}
+
+@end
+
+//
+
 @interface DIDefaultsTests : AbstractTests
 
 @end
@@ -64,4 +179,140 @@
     XCTAssertNil([[NSUserDefaults standardUserDefaults] objectForKey:key2]);
 }
 
+- (void)testDefaultsCached {
+    NSString *key = NSStringFromSelector(@selector(defaultsArchived));
+    [[NSUserDefaults standardUserDefaults] removeObjectForKey:key];
+    
+    [DeluxeInjection injectDefaultsWithKeyBlock:^NSString *(Class targetClass, NSString *propertyName, Class propertyClass, NSSet<Protocol *> *propertyProtocols) {
+        return propertyName;
+    } defaultsBlock:^NSUserDefaults *(Class targetClass, NSString *propertyName, Class propertyClass, NSSet<Protocol *> *propertyProtocols) {
+        return [NSUserDefaults standardUserDefaults];
+    } options:DIDefaultsOptionCached];
+    
+    DIDefaultsTests_Class *test = [[DIDefaultsTests_Class alloc] init];
+    XCTAssertNil(test.defaultsArchived);
+    
+    test.defaultsArchived = @[@1, @2];
+    XCTAssertEqualObjects(test.defaultsArchived, (@[@1, @2]));
+    XCTAssertEqual(test.defaultsArchived, test.defaultsArchived, @"Decoded value should be cached");
+    
+    [[NSUserDefaults standardUserDefaults] setObject:[NSKeyedArchiver archivedDataWithRootObject:@[@3]] forKey:key];
+    XCTAssertEqualObjects(test.defaultsArchived, (@[@3]));
+    
+    test.defaultsArchived = nil;
+    XCTAssertNil(test.defaultsArchived);
+    XCTAssertNil([[NSUserDefaults standardUserDefaults] objectForKey:key]);
+}
+
+- (void)testDefaultsWriteBehind {
+    DIDefaultsTests_Storage *storage = [[DIDefaultsTests_Storage alloc] init];
+    
+    [DeluxeInjection setDefaultsWriteBehindInterval:0.2];
+    [DeluxeInjection injectDefaultsWithKeyBlock:^NSString *(Class targetClass, NSString *propertyName, Class propertyClass, NSSet<Protocol *> *propertyProtocols) {
+        return propertyName;
+    } storageBlock:^id<DIDefaultsStorage>(Class targetClass, NSString *propertyName, Class propertyClass, NSSet<Protocol *> *propertyProtocols) {
+        return storage;
+    } options:DIDefaultsOptionWriteBehind];
+    
+    DIDefaultsTests_Class *test = [[DIDefaultsTests_Class alloc] init];
+    for (NSInteger i = 0; i < 100; i++) {
+        test.defaultsSync = [NSString stringWithFormat:@"%@", @(i)];
+    }
+    XCTAssertEqualObjects(test.defaultsSync, @"99");
+    XCTAssertEqualObjects([storage objectForKey:@"defaultsSync"], @"99");
+    XCTAssertEqual(storage.syncCount, 0, @"Changes should not be synchronized before interval");
+    
+    [NSThread sleepForTimeInterval:0.6];
+    XCTAssertEqual(storage.syncCount, 1, @"All changes of interval should be synchronized once");
+    
+    for (NSInteger i = 0; i < 100; i++) {
+        test.defaultsSync = [NSString stringWithFormat:@"%@", @(i)];
+    }
+    test.defaultsSync = nil;
+    XCTAssertEqual(storage.syncCount, 1);
+    
+    [DeluxeInjection flushDefaults];
+    XCTAssertEqual(storage.syncCount, 2, @"Flush should synchronize pending changes once");
+    XCTAssertNil([storage objectForKey:@"defaultsSync"]);
+    
+    [NSThread sleepForTimeInterval:0.6];
+    XCTAssertEqual(storage.syncCount, 2, @"Flushed changes should not be synchronized again");
+    
+    [DeluxeInjection setDefaultsWriteBehindInterval:1.0];
+}
+
+- (void)testDefaultsBinaryCodec {
+    NSString *key = NSStringFromSelector(@selector(defaultsArchived));
+    [[NSUserDefaults standardUserDefaults] setObject:[NSKeyedArchiver archivedDataWithRootObject:@[@"old"]] forKey:key];
+    
+    [DeluxeInjection setDefaultsArchiveCodec:[[DIBinaryCodec alloc] init]];
+    [DeluxeInjection injectDefaults];
+    [DeluxeInjection setDefaultsArchiveCodec:nil];
+    XCTAssertTrue([[DeluxeInjection defaultsArchiveCodec] isKindOfClass:[DIKeyedArchiverCodec class]]);
+    
+    DIDefaultsTests_Class *test = [[DIDefaultsTests_Class alloc] init];
+    XCTAssertEqualObjects(test.defaultsArchived, (@[@"old"]), @"Keyed archives should be decoded");
+    
+    NSDate *date = [NSDate dateWithTimeIntervalSinceReferenceDate:12345.5];
+    NSArray *value = @[@1, @-100000, @2.5, @YES, @"abc", date, @{@"key" : [NSSet setWithObject:@"x"]}, [NSNull null]];
+    test.defaultsArchived = value;
+    XCTAssertEqualObjects(test.defaultsArchived, value);
+    
+    NSData *data = [[NSUserDefaults standardUserDefaults] objectForKey:key];
+    XCTAssertLessThan(data.length, [NSKeyedArchiver archivedDataWithRootObject:value].length);
+    
+    [[NSUserDefaults standardUserDefaults] removeObjectForKey:key];
+}
+
+- (void)testBinaryCodecSchemaTolerance {
+    DIBinaryCodec *codec = [[DIBinaryCodec alloc] init];
+    
+    DIDefaultsTests_Value *value = [[DIDefaultsTests_Value alloc] init];
+    value.name = @"name";
+    value.count = 42;
+    DIDefaultsTests_Value *decoded = [codec decodeData:[codec encodeObject:value]];
+    XCTAssertEqualObjects(decoded.name, @"name");
+    XCTAssertEqual(decoded.count, 42);
+    
+    DIDefaultsTests_ValueV2 *newValue = [[DIDefaultsTests_ValueV2 alloc] init];
+    newValue.name = @"new";
+    decoded = [codec decodeData:[codec encodeObject:@[newValue]]].firstObject;
+    XCTAssertEqual([decoded class], [DIDefaultsTests_Value class]);
+    XCTAssertEqualObjects(decoded.name, @"new");
+    XCTAssertEqual(decoded.count, 0, @"Missing field should be decoded as zero");
+    
+    NSMutableData *data = [[codec encodeObject:@"abc"] mutableCopy];
+    ((uint8_t *)data.mutableBytes)[2] = [DIBinaryCodec formatVersion] + 1;
+    XCTAssertNil([codec decodeData:data], @"Newer format should not be decoded");
+    [data setLength:data.length - 1];
+    ((uint8_t *)data.mutableBytes)[2] = [DIBinaryCodec formatVersion];
+    XCTAssertNil([codec decodeData:data], @"Truncated data should not be decoded");
+}
+
+- (void)testBinaryCodecFallbacks {
+    NSString *key = NSStringFromSelector(@selector(defaultsArchived));
+    [DeluxeInjection setDefaultsArchiveCodec:[[DIBinaryCodec alloc] init]];
+    [DeluxeInjection injectDefaults];
+    [DeluxeInjection setDefaultsArchiveCodec:nil];
+    
+    DIDefaultsTests_UnkeyedValue *value = [[DIDefaultsTests_UnkeyedValue alloc] init];
+    value.name = @"unkeyed";
+    DIDefaultsTests_Class *test = [[DIDefaultsTests_Class alloc] init];
+    test.defaultsArchived = @[value];
+    XCTAssertNotNil([[NSUserDefaults standardUserDefaults] objectForKey:key], @"Non-keyed coding value should be stored");
+    XCTAssertEqualObjects([test.defaultsArchived.firstObject name], @"unkeyed");
+    
+    NSMutableArray *cycle = [NSMutableArray array];
+    [cycle addObject:@[cycle]];
+    XCTAssertNotNil([[[DIBinaryCodec alloc] init] encodeObject:cycle], @"Cyclic graph should be stored");
+    [cycle removeAllObjects];
+    
+    NSArray *numbers = @[@(UINT64_MAX), @((unsigned long long)INT64_MAX + 1), @(INT64_MIN), @(UINT32_MAX)];
+    test.defaultsArchived = numbers;
+    XCTAssertEqualObjects(test.defaultsArchived, numbers);
+    XCTAssertEqual([test.defaultsArchived.firstObject unsignedLongLongValue], UINT64_MAX);
+    
+    [[NSUserDefaults standardUserDefaults] removeObjectForKey:key];
+}
+
 @end
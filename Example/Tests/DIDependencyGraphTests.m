@@ -0,0 +1,210 @@
+//
+//  DIDependencyGraphTests.m
+//  DeluxeInjection
+//
+//  Created by agent on 17.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#import "AbstractTests.h"
+
+#import <DeluxeInjection/DeluxeInjection.h>
+
+//
+
+@interface DIDependencyGraphTests_Config : NSObject
+
+@end
+
+@implementation DIDependencyGraphTests_Config
+
+@end
+
+@interface DIDependencyGraphTests_Network : NSObject
+
+@property (strong, nonatomic) DIDependencyGraphTests_Config<DIInject> *config;
+
+@end
+
+@implementation DIDependencyGraphTests_Network
+
+@end
+
+@interface DIDependencyGraphTests_Storage : NSObject
+
+@property (strong, nonatomic) DIDependencyGraphTests_Config<DIInject> *config;
+
+@end
+
+@implementation DIDependencyGraphTests_Storage
+
+@end
+
+@interface DIDependencyGraphTests_Api : NSObject
+
+@property (strong, nonatomic) DIDependencyGraphTests_Network<DIInject> *network;
+@property (strong, nonatomic) DIDependencyGraphTests_Storage<DIInject> *storage;
+
+@end
+
+@implementation DIDependencyGraphTests_Api
+
+@end
+
+@interface DIDependencyGraphTests_SubApi : DIDependencyGraphTests_Api
+
+@end
+
+@implementation DIDependencyGraphTests_SubApi
+
+@end
+
+@class DIDependencyGraphTests_CycleB;
+
+@interface DIDependencyGraphTests_CycleA : NSObject
+
+@property (strong, nonatomic) DIDependencyGraphTests_CycleB<DIInject> *cycleB;
+
+@end
+
+@implementation DIDependencyGraphTests_CycleA
+
+@end
+
+@interface DIDependencyGraphTests_CycleB : NSObject
+
+@property (strong, nonatomic) DIDependencyGraphTests_CycleA<DIInject> *cycleA;
+
+@end
+
+@implementation DIDependencyGraphTests_CycleB
+
+@end
+
+//
+
+@interface DIDependencyGraphTests : AbstractTests
+
+@end
+
+@implementation DIDependencyGraphTests
+
+- (void)tearDown {
+    [DeluxeInjection imperative:^(DIImperative *lets) {
+        [lets rejectAll];
+        [lets skipAsserts];
+    }];
+    
+    [super tearDown];
+}
+
+- (NSArray<Class> *)diamondClasses {
+    return @[[DIDependencyGraphTests_SubApi class],
+             [DIDependencyGraphTests_Api class],
+             [DIDependencyGraphTests_Storage class],
+             [DIDependencyGraphTests_Network class],
+             [DIDependencyGraphTests_Config class]];
+}
+
+- (void)testTopologicalOrder {
+    __block DIDependencyGraph *graph;
+    __block NSError *error;
+    [DeluxeInjection imperative:^(DIImperative *lets) {
+        graph = [lets dependencyGraphForClasses:[self diamondClasses] builder:nil error:&error];
+        [lets skipAsserts];
+    }];
+    
+    XCTAssertNotNil(graph);
+    XCTAssertNil(error);
+    XCTAssertEqual(graph.classes.count, 5);
+    for (Class klass in graph.classes) {
+        NSUInteger klassIndex = [graph.classes indexOfObject:klass];
+        for (Class dependency in [graph dependenciesOfClass:klass]) {
+            XCTAssertLessThan([graph.classes indexOfObject:dependency], klassIndex, @"%@ should go after %@", klass, dependency);
+        }
+    }
+    
+    NSSet *apiDependencies = [NSSet setWithObjects:[DIDependencyGraphTests_Network class], [DIDependencyGraphTests_Storage class], nil];
+    XCTAssertEqualObjects([graph dependenciesOfClass:[DIDependencyGraphTests_Api class]], apiDependencies);
+    XCTAssertEqualObjects([graph dependenciesOfClass:[DIDependencyGraphTests_SubApi class]], apiDependencies, @"Inherited properties should be dependencies too");
+    XCTAssertEqual([graph dependenciesOfClass:[DIDependencyGraphTests_Config class]].count, 0);
+    XCTAssertEqual([graph dependenciesOfClass:[NSObject class]].count, 0, @"Class out of graph should have no dependencies");
+}
+
+- (void)testCycle {
+    __block DIDependencyGraph *graph;
+    __block NSError *error;
+    [DeluxeInjection imperative:^(DIImperative *lets) {
+        graph = [lets dependencyGraphForClasses:@[[DIDependencyGraphTests_Config class],
+                                                  [DIDependencyGraphTests_CycleA class],
+                                                  [DIDependencyGraphTests_CycleB class]] builder:nil error:&error];
+        [lets skipAsserts];
+    }];
+    
+    XCTAssertNil(graph);
+    XCTAssertEqualObjects(error.domain, DIDependencyGraphErrorDomain);
+    XCTAssertEqual(error.code, DIDependencyGraphErrorCycle);
+    NSArray *cycleClasses = @[[DIDependencyGraphTests_CycleA class], [DIDependencyGraphTests_CycleB class]];
+    XCTAssertEqualObjects(error.userInfo[DIDependencyGraphCycleClassesKey], cycleClasses);
+}
+
+- (void)testParallelBuild {
+    NSMutableArray<Class> *built = [NSMutableArray array];
+    __block DIDependencyGraph *graph;
+    [DeluxeInjection imperative:^(DIImperative *lets) {
+        graph = [lets dependencyGraphForClasses:[self diamondClasses] builder:^id(Class klass) {
+            [NSThread sleepForTimeInterval:0.01];
+            @synchronized (built) {
+                [built addObject:klass];
+            }
+            return [[klass alloc] init];
+        } error:NULL];
+        [lets skipAsserts];
+    }];
+    
+    [graph build];
+    XCTAssertEqual(built.count, 5, @"Every class should be built once");
+    for (Class klass in built) {
+        for (Class dependency in [graph dependenciesOfClass:klass]) {
+            XCTAssertLessThan([built indexOfObject:dependency], [built indexOfObject:klass], @"%@ should be built after %@", klass, dependency);
+        }
+    }
+    
+    id config = [graph instanceOfClass:[DIDependencyGraphTests_Config class]];
+    [graph build];
+    XCTAssertEqual(built.count, 5, @"Second build should not build anything");
+    XCTAssertEqual([graph instanceOfClass:[DIDependencyGraphTests_Config class]], config);
+    XCTAssertNil([graph instanceOfClass:[NSObject class]]);
+}
+
+- (void)testInjection {
+    __block DIDependencyGraph *graph;
+    [DeluxeInjection imperative:^(DIImperative *lets) {
+        graph = [lets dependencyGraphForClasses:[self diamondClasses] builder:nil error:NULL];
+        [lets injectDependencyGraph:graph];
+        [lets skipAsserts];
+    }];
+    
+    DIDependencyGraphTests_Api *api = [graph instanceOfClass:[DIDependencyGraphTests_Api class]];
+    XCTAssertEqual(api.network, [graph instanceOfClass:[DIDependencyGraphTests_Network class]]);
+    XCTAssertEqual(api.storage, [graph instanceOfClass:[DIDependencyGraphTests_Storage class]]);
+    XCTAssertEqual(api.network.config, api.storage.config, @"Shared dependency should be single instance");
+    
+    DIDependencyGraphTests_SubApi *subApi = [DIDependencyGraphTests_SubApi new];
+    XCTAssertEqual(subApi.network, api.network);
+}
+
+- (void)testUndeclaredReentranceAsserted {
+    __block DIDependencyGraph *graph;
+    [DeluxeInjection imperative:^(DIImperative *lets) {
+        graph = [lets dependencyGraphForClasses:@[[DIDependencyGraphTests_Config class]] builder:^id(Class klass) {
+            // Config is reached again while being built, without declared dependency
+            return [graph instanceOfClass:[DIDependencyGraphTests_Config class]];
+        } error:nil];
+        [lets skipAsserts];
+    }];
+    
+    XCTAssertThrows([graph instanceOfClass:[DIDependencyGraphTests_Config class]], @"Undeclared reentrance should be asserted instead of deadlock");
+}
+
+@end
@@ -106,4 +106,52 @@
     XCTAssertEqual(test.DIImperativeTests_dynamicCategoryProperty, answer1);
 }
 
+- (void)testImperativeSessions {
+    id answer1 = @[@1,@2,@3];
+    id answer2 = @"abc";
+    
+    for (id answer in @[answer1, answer2]) {
+        [DeluxeInjection imperative:^(DIImperative *lets){
+            [lets rejectAll];
+            
+            [[[[lets inject]
+               byPropertyClass:[NSMutableArray class]]
+              filterContainerClass:[DIImperativeTests_Class class]]
+             getterValue:answer];
+            
+            [lets skipAsserts];
+        }];
+        
+        DIImperativeTests_Class *test = [[DIImperativeTests_Class alloc] init];
+        XCTAssertEqualObjects(test.classObject, answer);
+        XCTAssertNil(test.protocolObject);
+    }
+}
+
+- (void)testImperativeFromOtherThreadInsideSession {
+    id answer1 = [@[@1,@2,@3] mutableCopy];
+    
+    [DeluxeInjection imperative:^(DIImperative *lets){
+        // Session waiting for session of other thread must not deadlock
+        dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+        dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+            [DeluxeInjection imperative:^(DIImperative *lets){
+                [[[[lets inject]
+                   byPropertyClass:[NSMutableArray class]]
+                  filterContainerClass:[DIImperativeTests_Class class]]
+                 getterValue:answer1];
+                
+                [lets skipAsserts];
+            }];
+            dispatch_semaphore_signal(semaphore);
+        });
+        XCTAssertEqual(dispatch_semaphore_wait(semaphore, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)), 0);
+        
+        [lets skipAsserts];
+    }];
+    
+    DIImperativeTests_Class *test = [[DIImperativeTests_Class alloc] init];
+    XCTAssertEqualObjects(test.classObject, answer1);
+}
+
 @end
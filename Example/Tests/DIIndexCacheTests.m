@@ -0,0 +1,111 @@
+//
+//  DIIndexCacheTests.m
+//  DeluxeInjection
+//
+//  Created by agent on 17.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#import "AbstractTests.h"
+
+#import <DeluxeInjection/DeluxeInjection.h>
+#import <DeluxeInjection/DIPropertyIndex.h>
+#import <DeluxeInjection/DIIndexCache.h>
+
+//
+
+@interface DIIndexCacheTests_Class : NSObject
+
+@property (strong, nonatomic) NSMutableArray<DILazy> *first;
+@property (strong, nonatomic, getter=customSecond) NSMutableArray<DILazy> *second;
+
+@end
+
+@implementation DIIndexCacheTests_Class
+
+@end
+
+//
+
+@interface DIIndexCacheTests : AbstractTests
+
+@property (strong, nonatomic) NSString *path;
+@property (strong, nonatomic) DIScanScope *scope;
+
+@end
+
+@implementation DIIndexCacheTests
+
+- (void)setUp {
+    [super setUp];
+    
+    self.path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"DIIndexCacheTests.cache"];
+    [[NSFileManager defaultManager] removeItemAtPath:self.path error:NULL];
+    self.scope = [DIScanScope scopeWithImages:nil classPrefixes:@[@"DIIndexCacheTests_"] includeMetaClasses:NO];
+}
+
+- (void)tearDown {
+    [[NSFileManager defaultManager] removeItemAtPath:self.path error:NULL];
+    
+    [super tearDown];
+}
+
+- (DIPropertyIndex *)makeIndex {
+    DIPropertyIndex *index = [[DIPropertyIndex alloc] init];
+    index.scanScope = self.scope;
+    index.cachePath = self.path;
+    return index;
+}
+
+- (NSArray<NSString *> *)namesOfDescriptors:(NSArray<DIPropertyDescriptor *> *)descriptors {
+    NSMutableArray<NSString *> *names = [NSMutableArray array];
+    for (DIPropertyDescriptor *descriptor in descriptors) {
+        [names addObject:[NSString stringWithFormat:@"%@.%@", descriptor.targetClass, NSStringFromSelector(descriptor.getter)]];
+    }
+    return [names sortedArrayUsingSelector:@selector(compare:)];
+}
+
+- (void)testKey {
+    NSData *key = [DIIndexCache keyForScope:self.scope];
+    XCTAssertEqualObjects(key, [DIIndexCache keyForScope:self.scope]);
+    
+    DIScanScope *otherScope = [DIScanScope scopeWithImages:nil classPrefixes:@[@"Other"] includeMetaClasses:NO];
+    XCTAssertNotEqualObjects(key, [DIIndexCache keyForScope:otherScope]);
+}
+
+- (void)testWriteOnMiss {
+    NSArray *expected = @[@"DIIndexCacheTests_Class.customSecond", @"DIIndexCacheTests_Class.first"];
+    XCTAssertEqualObjects([self namesOfDescriptors:[[self makeIndex] descriptorsForProtocol:@protocol(DILazy)]], expected);
+    
+    DIIndexCache *cache = [[DIIndexCache alloc] initWithPath:self.path key:[DIIndexCache keyForScope:self.scope]];
+    XCTAssertNotNil(cache, @"Cache should be written after scan");
+    XCTAssertEqual(cache.count, 2);
+    
+    XCTAssertEqualObjects([self namesOfDescriptors:[[self makeIndex] descriptorsForProtocol:@protocol(DILazy)]], expected);
+}
+
+- (void)testReadOnHit {
+    DIPropertyIndex *index = [self makeIndex];
+    index.cachePath = nil;
+    NSArray<DIPropertyDescriptor *> *descriptors = [index descriptorsForProtocol:@protocol(DILazy)];
+    NSArray<DIPropertyDescriptor *> *customSecond = [descriptors filteredArrayUsingPredicate:[NSPredicate predicateWithFormat:@"propertyName == 'second'"]];
+    XCTAssertTrue([DIIndexCache writeDescriptors:customSecond key:[DIIndexCache keyForScope:self.scope] toPath:self.path]);
+    
+    descriptors = [[self makeIndex] descriptorsForProtocol:@protocol(DILazy)];
+    XCTAssertEqualObjects([self namesOfDescriptors:descriptors], @[@"DIIndexCacheTests_Class.customSecond"], @"Valid cache should replace scan");
+    XCTAssertEqual(descriptors.firstObject.setter, @selector(setSecond:));
+}
+
+- (void)testInvalidCache {
+    DIScanScope *otherScope = [DIScanScope scopeWithImages:nil classPrefixes:@[@"Other"] includeMetaClasses:NO];
+    XCTAssertTrue([DIIndexCache writeDescriptors:@[] key:[DIIndexCache keyForScope:otherScope] toPath:self.path]);
+    XCTAssertNil([[DIIndexCache alloc] initWithPath:self.path key:[DIIndexCache keyForScope:self.scope]]);
+    XCTAssertEqual([[self makeIndex] descriptorsForProtocol:@protocol(DILazy)].count, 2, @"Cache of other images should be ignored");
+    XCTAssertNotNil([[DIIndexCache alloc] initWithPath:self.path key:[DIIndexCache keyForScope:self.scope]], @"Cache should be rewritten");
+    
+    [[@"garbage" dataUsingEncoding:NSUTF8StringEncoding] writeToFile:self.path atomically:YES];
+    XCTAssertNil([[DIIndexCache alloc] initWithPath:self.path key:[DIIndexCache keyForScope:self.scope]]);
+    XCTAssertEqual([[self makeIndex] descriptorsForProtocol:@protocol(DILazy)].count, 2);
+}
+
+@end
@@ -148,6 +148,30 @@
     XCTAssertEqualObjects(test.classObject, answer1);
 }
 
+- (void)testInjectBlockOnce {
+    NSArray *answer1 = @[ @1, @2, @3 ];
+    
+    [DeluxeInjection injectBlock:^DIGetter(Class targetClass, SEL getter, NSString *propertyName, Class propertyClass, NSSet<Protocol *> *propertyProtocols) {
+        if (targetClass == [DIInjectTests_Class class] && propertyClass == [NSMutableArray class]) {
+            return DIGetterIfIvarIsNilOnce(^id(id target, SEL cmd) {
+                return [answer1 mutableCopy];
+            });
+        }
+        return nil;
+    }];
+    
+    DIInjectTests_Class *test = [[DIInjectTests_Class alloc] init];
+    DIInjectTests_Class *test2 = [[DIInjectTests_Class alloc] init];
+    
+    XCTAssertEqualObjects(test.classObject, answer1);
+    XCTAssertEqualObjects(test.dynamicClassObject, answer1);
+    test.classObject = nil;
+    test.dynamicClassObject = nil;
+    XCTAssertNil(test.classObject);
+    XCTAssertNil(test.dynamicClassObject);
+    XCTAssertEqualObjects(test2.classObject, answer1);
+}
+
 - (void)testRejectAll {
     NSArray *answer1 = @[ @1, @2, @3 ];
     NSArray *answer2 = @[ @4, @5, @6 ];
@@ -260,6 +284,29 @@
     XCTAssertNil(test.dynamicWeakObject);
 }
 
+- (void)testInjectedValueRetainedAfterReject {
+    __weak id weakAnswer = nil;
+    DIInjectTests_Class *test = [[DIInjectTests_Class alloc] init];
+    @autoreleasepool {
+        id answer1 = [@[ @1, @2, @3 ] mutableCopy];
+        weakAnswer = answer1;
+        
+        [DeluxeInjection inject:^id(Class targetClass, SEL getter, NSString *propertyName, Class propertyClass, NSSet<Protocol *> *protocols) {
+            if (targetClass == [DIInjectTests_Class class] && [propertyName isEqualToString:NSStringFromSelector(@selector(classObject))]) {
+                return answer1;
+            }
+            return [DeluxeInjection doNotInject];
+        }];
+        
+        XCTAssertEqual(test.classObject, answer1);
+        [DeluxeInjection rejectAll];
+    }
+    
+    XCTAssertNotNil(weakAnswer);
+    XCTAssertEqual(test.classObject, weakAnswer);
+    XCTAssertEqualObjects(test.classObject, (@[ @1, @2, @3 ]));
+}
+
 - (void)testInjectToCategory {
     NSArray *answer1 = @[ @1, @2, @3 ];
     NSArray *answer2 = @[ @4, @5, @6 ];
@@ -16,11 +16,15 @@
 
 @property (strong, nonatomic) NSMutableArray<NSString *><DILazy> *lazyArray;
 @property (strong, nonatomic) NSMutableDictionary<NSString *, NSString *><DILazy> *lazyDict;
+@property (strong, nonatomic) NSMutableSet<NSString *><DILazy> *lazySet;
+@property (readonly, nonatomic) NSMutableArray<NSString *><DILazy> *readonlyLazyArray;
 
 @end
 
 @implementation DILazyTests_Class
 
+@dynamic lazySet;
+
 @end
 
 //
@@ -58,4 +62,65 @@
     
 }
 
+- (void)testLazyInPlan {
+    [DeluxeInjection injectPlan:^{
+        [DeluxeInjection injectLazy];
+        XCTAssertFalse([DeluxeInjection checkInjected:[DILazyTests_Class class] selector:@selector(lazyArray)]);
+    }];
+    XCTAssertTrue([DeluxeInjection checkInjected:[DILazyTests_Class class] selector:@selector(lazyArray)]);
+    
+    DILazyTests_Class *test = [[DILazyTests_Class alloc] init];
+    XCTAssertTrue([test.lazyArray isKindOfClass:[NSMutableArray class]]);
+    
+    [DeluxeInjection injectPlan:^{
+        [DeluxeInjection rejectLazy];
+    }];
+    XCTAssertFalse([DeluxeInjection checkInjected:[DILazyTests_Class class] selector:@selector(lazyArray)]);
+}
+
+- (void)testLazyAtomic {
+    [DeluxeInjection injectLazyAtomic];
+    
+    for (NSInteger i = 0; i < 100; i++) {
+        DILazyTests_Class *test = [[DILazyTests_Class alloc] init];
+        NSMutableArray<NSArray *> *results = [NSMutableArray array];
+        dispatch_apply(8, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t index) {
+            NSArray *result = @[test.lazyArray, test.lazySet];
+            @synchronized(results) {
+                [results addObject:result];
+            }
+        });
+        
+        for (NSArray *result in results) {
+            XCTAssertEqual(result.firstObject, test.lazyArray, @"All threads should get published ivar value");
+            XCTAssertEqual(result.lastObject, test.lazySet, @"All threads should get published side table value");
+        }
+    }
+    
+    DILazyTests_Class *test = [[DILazyTests_Class alloc] init];
+    [test.lazySet addObject:@"object"];
+    test.lazyArray = nil;
+    XCTAssertTrue([test.lazyArray isKindOfClass:[NSMutableArray class]]);
+    XCTAssertTrue(test.lazySet.count == 1);
+}
+
+- (void)testLazyAtomicReadonly {
+    [DeluxeInjection injectLazyAtomic];
+    
+    for (NSInteger i = 0; i < 100; i++) {
+        DILazyTests_Class *test = [[DILazyTests_Class alloc] init];
+        NSMutableArray *results = [NSMutableArray array];
+        dispatch_apply(8, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t index) {
+            id result = test.readonlyLazyArray;
+            @synchronized(results) {
+                [results addObject:result];
+            }
+        });
+        
+        for (id result in results) {
+            XCTAssertEqual(result, test.readonlyLazyArray, @"Readonly strong ivar should be published atomically");
+        }
+    }
+}
+
 @end
@@ -0,0 +1,126 @@
+//
+//  DILoadedImageTests.m
+//  DeluxeInjection
+//
+//  Created by agent on 17.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#import <objc/runtime.h>
+
+#import <DeluxeInjection/DeluxeInjection.h>
+#import <DeluxeInjection/DIPropertyIndex.h>
+
+#import "AbstractTests.h"
+
+//
+
+@interface DILoadedImageTests_Value : NSObject
+
+@end
+
+@implementation DILoadedImageTests_Value
+
+@end
+
+//
+
+/**
+ *  Registers class in runtime after injections and adds it to shared index the same way as classes of newly loaded image
+ */
+static Class DILoadedImageTestsLoadClass(void) {
+    static NSUInteger classesCount = 0;
+    NSString *className = [NSString stringWithFormat:@"DILoadedImageTests_Loaded%lu", (unsigned long)classesCount++];
+    Class klass = objc_allocateClassPair([NSObject class], className.UTF8String, 0);
+    objc_property_attribute_t lazyAttributes[] = {{"T", "@\"NSMutableArray<DILazy>\""}, {"&", ""}, {"N", ""}};
+    objc_property_attribute_t defaultsAttributes[] = {{"T", "@\"NSString<DIDefaults>\""}, {"&", ""}, {"N", ""}};
+    objc_property_attribute_t injectAttributes[] = {{"T", "@\"DILoadedImageTests_Value<DIInject>\""}, {"&", ""}, {"N", ""}};
+    class_addProperty(klass, "lazyArray", lazyAttributes, 3);
+    class_addProperty(klass, "defaultsString", defaultsAttributes, 3);
+    class_addProperty(klass, "value", injectAttributes, 3);
+    objc_registerClassPair(klass);
+    
+    [[DIPropertyIndex sharedIndex] indexClasses:@[klass]];
+    [[DIPropertyIndex sharedIndex] waitForIndexedImages];
+    return klass;
+}
+
+//
+
+@interface DILoadedImageTests : AbstractTests
+
+@end
+
+@implementation DILoadedImageTests
+
+- (void)tearDown {
+    [DeluxeInjection rejectLazy];
+    [DeluxeInjection rejectDefaults];
+    [DeluxeInjection imperative:^(DIImperative *lets) {
+        [lets rejectAll];
+        [lets skipAsserts];
+    }];
+    
+    [super tearDown];
+}
+
+- (void)testActiveRulesAppliedToLoadedClass {
+    DILoadedImageTests_Value *value = [DILoadedImageTests_Value new];
+    [DeluxeInjection injectLazy];
+    [DeluxeInjection injectDefaults];
+    [DeluxeInjection imperative:^(DIImperative *lets) {
+        [[[lets inject] byPropertyClass:[DILoadedImageTests_Value class]] getterValue:value];
+        [lets skipAsserts];
+    }];
+    
+    Class klass = DILoadedImageTestsLoadClass();
+    XCTAssertTrue([DeluxeInjection checkInjected:klass selector:NSSelectorFromString(@"lazyArray")]);
+    XCTAssertTrue([DeluxeInjection checkInjected:klass selector:NSSelectorFromString(@"defaultsString")]);
+    XCTAssertTrue([DeluxeInjection checkInjected:klass selector:NSSelectorFromString(@"value")]);
+    
+    id object = [klass new];
+    XCTAssertTrue([[object valueForKey:@"lazyArray"] isKindOfClass:[NSMutableArray class]]);
+    XCTAssertEqual([object valueForKey:@"value"], value);
+}
+
+- (void)testRejectedRulesNotAppliedToLoadedClass {
+    [DeluxeInjection injectLazy];
+    [DeluxeInjection injectDefaults];
+    [DeluxeInjection imperative:^(DIImperative *lets) {
+        [[[lets inject] byPropertyClass:[DILoadedImageTests_Value class]] getterValue:[DILoadedImageTests_Value new]];
+        [lets skipAsserts];
+    }];
+    
+    [DeluxeInjection rejectLazy];
+    [DeluxeInjection rejectDefaults];
+    [DeluxeInjection imperative:^(DIImperative *lets) {
+        [lets rejectAll];
+        [lets skipAsserts];
+    }];
+    
+    Class klass = DILoadedImageTestsLoadClass();
+    XCTAssertFalse([DeluxeInjection checkInjected:klass selector:NSSelectorFromString(@"lazyArray")]);
+    XCTAssertFalse([DeluxeInjection checkInjected:klass selector:NSSelectorFromString(@"defaultsString")]);
+    XCTAssertFalse([DeluxeInjection checkInjected:klass selector:NSSelectorFromString(@"value")]);
+}
+
+- (void)testRulesAppliedToClassLoadedWhileIndexIsNotBuilt {
+    [DeluxeInjection injectLazy];
+    
+    [[DIPropertyIndex sharedIndex] invalidate];
+    Class klass = DILoadedImageTestsLoadClass();
+    XCTAssertFalse([DeluxeInjection checkInjected:klass selector:NSSelectorFromString(@"lazyArray")]);
+    
+    NSArray<DIPropertyDescriptor *> *descriptors = [[DIPropertyIndex sharedIndex] descriptorsForProtocol:@protocol(DILazy)];
+    [[DIPropertyIndex sharedIndex] waitForIndexedImages];
+    XCTAssertTrue([DeluxeInjection checkInjected:klass selector:NSSelectorFromString(@"lazyArray")], @"Rules should be applied after rebuild");
+    
+    descriptors = [[DIPropertyIndex sharedIndex] descriptorsForProtocol:@protocol(DILazy)];
+    NSUInteger count = 0;
+    for (DIPropertyDescriptor *descriptor in descriptors) {
+        count += (descriptor.targetClass == klass);
+    }
+    XCTAssertEqual(count, 1, @"Class found by rebuild and indexed again should not be duplicated");
+}
+
+@end
@@ -0,0 +1,103 @@
+//
+//  DIManifestTests.m
+//  DeluxeInjection
+//
+//  Created by agent on 17.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#import <objc/runtime.h>
+
+#import "AbstractTests.h"
+
+#import <DeluxeInjection/DeluxeInjection.h>
+
+//
+
+@interface DIManifestTests_Class : NSObject
+
+@property (strong, nonatomic) NSMutableArray<DILazy> *listedArray;
+@property (strong, nonatomic) NSMutableArray<DILazy> *unlistedArray;
+@property (strong, class) NSMutableArray<DILazy> *classLazyArray;
+
+@end
+
+@implementation DIManifestTests_Class
+
+@dynamic /*(class)*/ classLazyArray;
+
++ (NSMutableArray<DILazy> *)classLazyArray {
+    return nil;
+}
+
++ (void)setClassLazyArray:(NSMutableArray<DILazy> *)classLazyArray {
+}
+
+@end
+
+DIManifestPropertyIvar(DIManifestTests_Class, listedArray, DILazy, _listedArray);
+DIManifestClassProperty(DIManifestTests_Class, classLazyArray, DILazy);
+
+//
+
+@interface DIManifestTests : AbstractTests
+
+@end
+
+@implementation DIManifestTests
+
+- (void)tearDown {
+    [DeluxeInjection rejectLazy];
+    [DeluxeInjection forceRejectAll];
+    [DeluxeInjection setScanScope:nil];
+    
+    [super tearDown];
+}
+
+- (void)testEnumerateImage {
+    NSMutableArray<NSString *> *names = [NSMutableArray array];
+    BOOL found = DIManifestEnumerateImage(class_getImageName([DIManifestTests_Class class]), ^(const DIManifestEntry *entry) {
+        if (strcmp(entry->className, "DIManifestTests_Class") == 0) {
+            [names addObject:[NSString stringWithFormat:@"%s.%s<%s>%s", entry->className, entry->propertyName, entry->protocolName, entry->ivarName ?: ""]];
+        }
+    });
+    
+    XCTAssertTrue(found);
+    NSArray *expected = @[@"DIManifestTests_Class.listedArray<DILazy>_listedArray",
+                          @"DIManifestTests_Class.classLazyArray<DILazy>"];
+    XCTAssertEqualObjects([names sortedArrayUsingSelector:@selector(compare:)], [expected sortedArrayUsingSelector:@selector(compare:)]);
+    XCTAssertFalse(DIManifestEnumerateImage(class_getImageName([NSObject class]), ^(const DIManifestEntry *entry) {}));
+}
+
+- (void)testManifest {
+    [DeluxeInjection setScanScope:[DIScanScope scopeWithImages:nil classPrefixes:@[@"DIManifestTests_"] includeMetaClasses:YES usesManifest:YES]];
+    [DeluxeInjection injectLazy];
+    
+    DIManifestTests_Class *test = [DIManifestTests_Class new];
+    XCTAssertNotNil(test.listedArray);
+    XCTAssertNil(test.unlistedArray, @"Image with manifest should not be scanned");
+    XCTAssertNotNil(DIManifestTests_Class.classLazyArray);
+}
+
+- (void)testWithoutManifest {
+    [DeluxeInjection setScanScope:[DIScanScope scopeWithImages:nil classPrefixes:@[@"DIManifestTests_"] includeMetaClasses:YES usesManifest:NO]];
+    [DeluxeInjection injectLazy];
+    
+    DIManifestTests_Class *test = [DIManifestTests_Class new];
+    XCTAssertNotNil(test.listedArray);
+    XCTAssertNotNil(test.unlistedArray);
+}
+
+- (void)testScanAfterForceInject {
+    [DeluxeInjection setScanScope:[DIScanScope scopeWithImages:nil classPrefixes:@[@"DIManifestTests_"] includeMetaClasses:YES usesManifest:YES]];
+    [DeluxeInjection forceInject:^id(Class targetClass, SEL getter, NSString *propertyName, Class propertyClass, NSSet<Protocol *> *propertyProtocols) {
+        return [DeluxeInjection doNotInject];
+    }];
+    [DeluxeInjection injectLazy];
+    
+    DIManifestTests_Class *test = [DIManifestTests_Class new];
+    XCTAssertNotNil(test.listedArray);
+    XCTAssertNotNil(test.unlistedArray, @"Enumeration of all properties should fall back to runtime scan");
+}
+
+@end
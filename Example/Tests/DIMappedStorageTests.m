@@ -0,0 +1,128 @@
+//
+//  DIMappedStorageTests.m
+//  DeluxeInjection
+//
+//  Created by agent on 17.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#import "AbstractTests.h"
+
+#import <DeluxeInjection/DIDefaults.h>
+#import <DeluxeInjection/DIMappedStorage.h>
+
+//
+
+@interface DIMappedStorageTests_Class : NSObject
+
+@property (strong, nonatomic) NSNumber<DIDefaults> *mappedNumber;
+@property (strong, nonatomic) NSArray<DIDefaultsArchived> *mappedArchived;
+
+@end
+
+@implementation DIMappedStorageTests_Class
+
+@end
+
+//
+
+@interface DIMappedStorageTests : AbstractTests
+
+@property (copy, nonatomic) NSString *path;
+
+@end
+
+@implementation DIMappedStorageTests
+
+- (void)setUp {
+    [super setUp];
+    
+    self.path = [NSTemporaryDirectory() stringByAppendingPathComponent:[NSUUID UUID].UUIDString];
+}
+
+- (void)tearDown {
+    [DeluxeInjection rejectDefaults];
+    [[NSFileManager defaultManager] removeItemAtPath:self.path error:NULL];
+    
+    [super tearDown];
+}
+
+- (void)testSetGetRemove {
+    DIMappedStorage *storage = [[DIMappedStorage alloc] initWithPath:self.path error:NULL];
+    XCTAssertNotNil(storage);
+    XCTAssertNil([storage objectForKey:@"key"]);
+    
+    [storage setObject:@"value" forKey:@"key"];
+    XCTAssertEqualObjects([storage objectForKey:@"key"], @"value");
+    
+    NSData *data = [@"bytes" dataUsingEncoding:NSUTF8StringEncoding];
+    [storage setObject:data forKey:@"data"];
+    XCTAssertEqualObjects([storage objectForKey:@"data"], data);
+    
+    [storage setObject:@{ @"a" : @[ @1, @2 ] } forKey:@"key"];
+    XCTAssertEqualObjects([storage objectForKey:@"key"], (@{ @"a" : @[ @1, @2 ] }));
+    
+    [storage setObject:nil forKey:@"key"];
+    XCTAssertNil([storage objectForKey:@"key"]);
+    XCTAssertEqualObjects([storage objectForKey:@"data"], data);
+}
+
+- (void)testReopen {
+    DIMappedStorage *storage = [[DIMappedStorage alloc] initWithPath:self.path error:NULL];
+    [storage setObject:@1 forKey:@"one"];
+    [storage setObject:@2 forKey:@"two"];
+    [storage setObject:nil forKey:@"one"];
+    XCTAssertTrue([storage synchronize]);
+    storage = nil;
+    
+    storage = [[DIMappedStorage alloc] initWithPath:self.path error:NULL];
+    XCTAssertNil([storage objectForKey:@"one"]);
+    XCTAssertEqualObjects([storage objectForKey:@"two"], @2);
+}
+
+- (void)testCompaction {
+    DIMappedStorage *storage = [[DIMappedStorage alloc] initWithPath:self.path error:NULL];
+    [storage setObject:[NSMutableData dataWithLength:1024] forKey:@"data"];
+    NSData *data = [storage objectForKey:@"data"];
+    
+    // Data read before compaction keeps pointing to previous mapping
+    for (NSInteger i = 0; i < 5000; i++) {
+        [storage setObject:@(i) forKey:@"counter"];
+        [storage setObject:[NSString stringWithFormat:@"string %@", @(i)] forKey:@"string"];
+    }
+    XCTAssertLessThan(storage.usedLength, 64 * 1024);
+    XCTAssertEqualObjects([storage objectForKey:@"counter"], @4999);
+    XCTAssertEqualObjects([storage objectForKey:@"string"], @"string 4999");
+    XCTAssertEqual(data.length, 1024);
+    
+    XCTAssertTrue([storage compact]);
+    storage = [[DIMappedStorage alloc] initWithPath:self.path error:NULL];
+    XCTAssertEqualObjects([storage objectForKey:@"counter"], @4999);
+    XCTAssertEqualObjects([[storage objectForKey:@"data"] copy], [NSMutableData dataWithLength:1024]);
+}
+
+- (void)testInjectWithStorage {
+    DIMappedStorage *storage = [[DIMappedStorage alloc] initWithPath:self.path error:NULL];
+    
+    [DeluxeInjection injectDefaultsWithKeyBlock:^NSString *(Class targetClass, NSString *propertyName, Class propertyClass, NSSet<Protocol *> *propertyProtocols) {
+        return propertyName;
+    } storageBlock:^id<DIDefaultsStorage>(Class targetClass, NSString *propertyName, Class propertyClass, NSSet<Protocol *> *propertyProtocols) {
+        return storage;
+    } options:DIDefaultsOptionCached];
+    
+    DIMappedStorageTests_Class *test = [[DIMappedStorageTests_Class alloc] init];
+    XCTAssertNil(test.mappedNumber);
+    XCTAssertNil(test.mappedArchived);
+    
+    test.mappedNumber = @777;
+    test.mappedArchived = @[ @"a", @"b" ];
+    XCTAssertEqualObjects(test.mappedNumber, @777);
+    XCTAssertEqualObjects(test.mappedArchived, (@[ @"a", @"b" ]));
+    XCTAssertEqualObjects([storage objectForKey:@"mappedNumber"], @777);
+    XCTAssertNil([[NSUserDefaults standardUserDefaults] objectForKey:@"mappedNumber"]);
+    
+    [storage setObject:@1 forKey:@"mappedNumber"];
+    XCTAssertEqualObjects(test.mappedNumber, @1);
+}
+
+@end
@@ -0,0 +1,154 @@
+//
+//  DIPrewarmTests.m
+//  DeluxeInjection
+//
+//  Created by agent on 17.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#import "AbstractTests.h"
+
+#import <DeluxeInjection/DeluxeInjection.h>
+
+//
+
+@interface DIPrewarmTests_Service : NSObject
+
+@end
+
+@implementation DIPrewarmTests_Service
+
+@end
+
+@interface DIPrewarmTests_Class : NSObject
+
+@property (strong, nonatomic) DIPrewarmTests_Service<DIInject> *service;
+@property (strong, nonatomic) NSMutableArray<DIInject> *array;
+@property (strong, nonatomic) NSMutableDictionary<DILazy> *lazyDict;
+
+@end
+
+@implementation DIPrewarmTests_Class
+
+@end
+
+//
+
+@interface DIPrewarmTests : AbstractTests
+
+@end
+
+@implementation DIPrewarmTests
+
+- (void)tearDown {
+    [DeluxeInjection imperative:^(DIImperative *lets) {
+        [lets rejectAll];
+        [lets skipAsserts];
+    }];
+    
+    [super tearDown];
+}
+
+- (void)testPrewarmClasses {
+    __block NSInteger serviceBuildCount = 0;
+    __block NSInteger arrayBuildCount = 0;
+    [DeluxeInjection imperative:^(DIImperative *lets) {
+        [[[lets inject] byPropertyClass:[DIPrewarmTests_Service class]] getterValueLazy:^id {
+            serviceBuildCount++;
+            [NSThread sleepForTimeInterval:0.05];
+            return [DIPrewarmTests_Service new];
+        }];
+        [[[lets inject] byPropertyClass:[NSMutableArray class]] getterValueLazy:^id {
+            arrayBuildCount++;
+            return [NSMutableArray array];
+        }];
+        [lets skipAsserts];
+    }];
+    
+    [DeluxeInjection prewarmClasses:@[[DIPrewarmTests_Class class]]];
+    XCTAssertTrue([DeluxeInjection waitForPrewarmWithTimeout:5]);
+    
+    DIPrewarmTests_Class *test1 = [DIPrewarmTests_Class new];
+    DIPrewarmTests_Class *test2 = [DIPrewarmTests_Class new];
+    XCTAssertNotNil(test1.service);
+    XCTAssertEqual(test1.service, test2.service);
+    XCTAssertEqual(test1.array, test2.array);
+    XCTAssertEqual(serviceBuildCount, 1);
+    XCTAssertEqual(arrayBuildCount, 1);
+    
+    NSString *serviceProperty = [NSString stringWithFormat:@"%@.service", [DIPrewarmTests_Class class]];
+    DIPrewarmEntry *serviceEntry = nil;
+    for (DIPrewarmEntry *entry in [DeluxeInjection prewarmReport]) {
+        if ([entry.properties containsObject:serviceProperty]) {
+            serviceEntry = entry;
+        }
+    }
+    XCTAssertNotNil(serviceEntry);
+    XCTAssertEqual(serviceEntry.state, DIPrewarmStateFinished);
+    XCTAssertTrue(serviceEntry.accessed);
+    XCTAssertTrue(serviceEntry.finishedInTime);
+    XCTAssertGreaterThan(serviceEntry.buildDuration, 0.01);
+}
+
+- (void)testPrewarmAccessDuringBuild {
+    __block NSInteger buildCount = 0;
+    [DeluxeInjection imperative:^(DIImperative *lets) {
+        [[[lets inject] byPropertyClass:[DIPrewarmTests_Service class]] getterValueLazy:^id {
+            @synchronized(self) {
+                buildCount++;
+            }
+            [NSThread sleepForTimeInterval:0.2];
+            return [DIPrewarmTests_Service new];
+        }];
+        [lets skipAsserts];
+    }];
+    
+    [DeluxeInjection prewarmProperties:@[@"service"] ofClass:[DIPrewarmTests_Class class]];
+    [NSThread sleepForTimeInterval:0.05];
+    
+    DIPrewarmTests_Class *test = [DIPrewarmTests_Class new];
+    XCTAssertNotNil(test.service, @"Access should wait for prewarming value");
+    XCTAssertTrue([DeluxeInjection waitForPrewarmWithTimeout:5]);
+    XCTAssertEqual(buildCount, 1);
+    
+    DIPrewarmEntry *entry = [DeluxeInjection prewarmReport].lastObject;
+    XCTAssertFalse(entry.finishedInTime);
+    XCTAssertGreaterThan(entry.accessWaitDuration, 0);
+}
+
+- (void)testPrewarmTarget {
+    [DeluxeInjection imperative:^(DIImperative *lets) {
+        [lets injectLazyAtomic];
+        [lets skipAsserts];
+    }];
+    
+    DIPrewarmTests_Class *test = [DIPrewarmTests_Class new];
+    [DeluxeInjection prewarmProperties:@[@"lazyDict"] ofTarget:test];
+    XCTAssertTrue([DeluxeInjection waitForPrewarmWithTimeout:5]);
+    XCTAssertTrue([test.lazyDict isKindOfClass:[NSMutableDictionary class]]);
+}
+
+- (void)testRejectDropsProviders {
+    NSUInteger reportedCount = [DeluxeInjection prewarmReport].count;
+    [DeluxeInjection imperative:^(DIImperative *lets) {
+        [[[lets inject] byPropertyClass:[DIPrewarmTests_Service class]] getterValueLazy:^id {
+            return [DIPrewarmTests_Service new];
+        }];
+        [lets skipAsserts];
+    }];
+    [DeluxeInjection prewarmClasses:@[[DIPrewarmTests_Class class]]];
+    [DeluxeInjection prewarmClasses:@[[DIPrewarmTests_Class class]]];
+    XCTAssertTrue([DeluxeInjection waitForPrewarmWithTimeout:5]);
+    XCTAssertEqual([DeluxeInjection prewarmReport].count, reportedCount + 1, @"Provider should be scheduled once");
+    
+    [DeluxeInjection imperative:^(DIImperative *lets) {
+        [[lets reject] byPropertyClass:[DIPrewarmTests_Service class]];
+        [lets skipAsserts];
+    }];
+    XCTAssertEqual([DeluxeInjection prewarmReport].count, reportedCount, @"Rejected properties should not be reported");
+    
+    [DeluxeInjection prewarmClasses:@[[DIPrewarmTests_Class class]]];
+    XCTAssertEqual([DeluxeInjection prewarmReport].count, reportedCount, @"Rejected properties should not be prewarmed");
+}
+
+@end
@@ -0,0 +1,126 @@
+//
+//  DIRegistryTests.m
+//  DeluxeInjection
+//
+//  Created by agent on 17.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#import <stdatomic.h>
+
+#import <DeluxeInjection/DeluxeInjection.h>
+#import <DeluxeInjection/DIRegistry.h>
+
+#import "AbstractTests.h"
+
+//
+
+@interface DIRegistryTests_Class : NSObject
+
+@property (strong, nonatomic) NSObject<DIAssociate> *associated;
+@property (strong, nonatomic) NSMutableArray<DILazy> *lazyArray;
+
+@end
+
+@implementation DIRegistryTests_Class
+
+@dynamic associated;
+@dynamic lazyArray;
+
+@end
+
+//
+
+@interface DIRegistryTests : AbstractTests
+
+@end
+
+@implementation DIRegistryTests
+
+- (void)tearDown {
+    [DeluxeInjection rejectAssociate];
+    [DeluxeInjection rejectLazy];
+    
+    [super tearDown];
+}
+
+- (void)testConcurrentAccessWhileInjecting {
+    [DeluxeInjection injectAssociateWithStorage:DIAssociationStorageSideTable];
+    
+    dispatch_apply(1000, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t i) {
+        if (i % 100 == 0) {
+            [DeluxeInjection injectLazyWithStorage:DIAssociationStorageSideTable];
+        }
+        DIRegistryTests_Class *test = [DIRegistryTests_Class new];
+        NSObject *object = [NSObject new];
+        test.associated = object;
+        XCTAssertEqual(test.associated, object);
+    });
+    
+    XCTAssertEqual([DeluxeInjection injectedSelectorsForClass:[DIRegistryTests_Class class]].count, 4);
+}
+
+- (void)testConcurrentRejectWhileAccessing {
+    [DeluxeInjection injectLazy];
+    
+    __block _Atomic(NSUInteger) wrongValues = 0;
+    dispatch_apply(1000, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t i) {
+        if (i % 10 == 0) {
+            // Replaced getters keep working for threads which already called them
+            [DeluxeInjection rejectLazy];
+            [DeluxeInjection injectLazy];
+        }
+        DIRegistryTests_Class *test = [DIRegistryTests_Class new];
+        id value = test.lazyArray;
+        if (value && ![value isKindOfClass:[NSMutableArray class]]) {
+            atomic_fetch_add(&wrongValues, 1);
+        }
+    });
+    
+    XCTAssertEqual(atomic_load(&wrongValues), 0);
+    XCTAssertTrue([DeluxeInjection checkInjected:[DIRegistryTests_Class class] selector:@selector(lazyArray)]);
+    XCTAssertNotNil([DIRegistryTests_Class new].lazyArray);
+}
+
+- (void)testUpdateWhileGetAcrossRehash {
+    static NSUInteger const keysCount = 4096;
+    DIRegistry *registry = DIRegistryCreate();
+    SEL *selectors = malloc(keysCount * sizeof(SEL));
+    for (NSUInteger i = 0; i < keysCount; i++) {
+        selectors[i] = sel_registerName([NSString stringWithFormat:@"DIRegistryTests_selector%lu", (unsigned long)i].UTF8String);
+    }
+    
+    __block _Atomic(NSUInteger) insertedCount = 0;
+    __block _Atomic(NSUInteger) wrongValues = 0;
+    dispatch_queue_t queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+    dispatch_group_t group = dispatch_group_create();
+    dispatch_group_async(group, queue, ^{
+        // Table starts with 64 slots, so it is rehashed several times while readers read it
+        for (NSUInteger i = 0; i < keysCount; i++) {
+            DIRegistryUpdate(registry, [DIRegistryTests class], selectors[i], ^void *(void *value) {
+                return (void *)(i + 1);
+            });
+            atomic_store_explicit(&insertedCount, i + 1, memory_order_release);
+        }
+    });
+    dispatch_apply(4, queue, ^(size_t thread) {
+        NSUInteger count;
+        while ((count = atomic_load_explicit(&insertedCount, memory_order_acquire)) < keysCount) {
+            for (NSUInteger i = 0; i < count; i++) {
+                if (DIRegistryGet(registry, [DIRegistryTests class], selectors[i]) != (void *)(i + 1)) {
+                    atomic_fetch_add(&wrongValues, 1);
+                }
+            }
+        }
+    });
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    
+    XCTAssertEqual(atomic_load(&wrongValues), 0);
+    for (NSUInteger i = 0; i < keysCount; i++) {
+        XCTAssertEqual(DIRegistryGet(registry, [DIRegistryTests class], selectors[i]), (void *)(i + 1));
+    }
+    XCTAssertEqual(DIRegistryGet(registry, [DIRegistryTests class], @selector(tearDown)), NULL);
+    free(selectors);
+}
+
+@end
@@ -0,0 +1,98 @@
+//
+//  DIScanScopeTests.m
+//  DeluxeInjection
+//
+//  Created by agent on 17.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#import <objc/runtime.h>
+
+#import "AbstractTests.h"
+
+#import <DeluxeInjection/DeluxeInjection.h>
+
+//
+
+@interface DIScanScopeTests_Included : NSObject
+
+@property (strong, nonatomic) NSMutableArray<DILazy> *lazyArray;
+@property (strong, class) NSMutableArray<DILazy> *classLazyArray;
+
+@end
+
+@implementation DIScanScopeTests_Included
+
+@dynamic /*(class)*/ classLazyArray;
+
++ (NSMutableArray<DILazy> *)classLazyArray {
+    return nil;
+}
+
++ (void)setClassLazyArray:(NSMutableArray<DILazy> *)classLazyArray {
+}
+
+@end
+
+//
+
+@interface DIScanScopeTests_Excluded : NSObject
+
+@property (strong, nonatomic) NSMutableArray<DILazy> *lazyArray;
+
+@end
+
+@implementation DIScanScopeTests_Excluded
+
+@end
+
+//
+
+@interface DIScanScopeTests : AbstractTests
+
+@end
+
+@implementation DIScanScopeTests
+
+- (void)tearDown {
+    [DeluxeInjection rejectLazy];
+    [DeluxeInjection setScanScope:nil];
+    
+    [super tearDown];
+}
+
+- (void)testClassPrefixes {
+    [DeluxeInjection setScanScope:[DIScanScope scopeWithImages:nil classPrefixes:@[@"DIScanScopeTests_Inc"] includeMetaClasses:NO]];
+    [DeluxeInjection injectLazy];
+    
+    XCTAssertNotNil([DIScanScopeTests_Included new].lazyArray);
+    XCTAssertNil([DIScanScopeTests_Excluded new].lazyArray);
+    XCTAssertNil(DIScanScopeTests_Included.classLazyArray);
+}
+
+- (void)testMetaClasses {
+    [DeluxeInjection setScanScope:[DIScanScope scopeWithImages:nil classPrefixes:@[@"DIScanScopeTests_Inc"] includeMetaClasses:YES]];
+    [DeluxeInjection injectLazy];
+    
+    XCTAssertNotNil([DIScanScopeTests_Included new].lazyArray);
+    XCTAssertNotNil(DIScanScopeTests_Included.classLazyArray);
+}
+
+- (void)testImages {
+    NSString *imagePath = @(class_getImageName([DIScanScopeTests_Included class]));
+    DIScanScope *scope = [DIScanScope scopeWithImages:@[imagePath.lastPathComponent] classPrefixes:nil includeMetaClasses:NO];
+    XCTAssertTrue([scope containsImage:imagePath.UTF8String]);
+    XCTAssertFalse([scope containsImage:class_getImageName([NSObject class])]);
+    
+    [DeluxeInjection setScanScope:[DIScanScope scopeWithImages:@[@"NotExistingImage"] classPrefixes:nil includeMetaClasses:NO]];
+    [DeluxeInjection injectLazy];
+    XCTAssertNil([DIScanScopeTests_Included new].lazyArray);
+    [DeluxeInjection rejectLazy];
+    
+    [DeluxeInjection setScanScope:scope];
+    [DeluxeInjection injectLazy];
+    XCTAssertNotNil([DIScanScopeTests_Included new].lazyArray);
+    XCTAssertNotNil([DIScanScopeTests_Excluded new].lazyArray);
+}
+
+@end
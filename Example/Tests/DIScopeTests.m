@@ -0,0 +1,166 @@
+//
+//  DIScopeTests.m
+//  DeluxeInjection
+//
+//  Created by agent on 17.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#import "AbstractTests.h"
+
+#import <DeluxeInjection/DeluxeInjection.h>
+
+//
+
+@interface DIScopeTests_Session : NSObject
+
+@end
+
+@implementation DIScopeTests_Session
+
+@end
+
+@interface DIScopeTests_Class : NSObject
+
+@property (strong, nonatomic) DIScopeTests_Session<DIInject> *session;
+@property (strong, nonatomic) DIScopeTests_Session<DIInject> *otherSession;
+
+@end
+
+@implementation DIScopeTests_Class
+
+@end
+
+//
+
+@interface DIScopeTests : AbstractTests
+
+@end
+
+@implementation DIScopeTests
+
+- (void)tearDown {
+    [DeluxeInjection rejectAll];
+    
+    [super tearDown];
+}
+
+- (void)testScopedImperative {
+    [DeluxeInjection imperative:^(DIImperative *lets) {
+        [[[lets inject] byPropertyClass:[DIScopeTests_Session class]] getterValueScoped:^id {
+            return [DIScopeTests_Session new];
+        }];
+        [lets skipAsserts];
+    }];
+    
+    DIScopeTests_Class *test = [DIScopeTests_Class new];
+    XCTAssertNil(test.session, @"Scoped value should be nil outside of scope");
+    
+    DIScope *scope1 = [DIScope new];
+    DIScope *scope2 = [DIScope new];
+    __block DIScopeTests_Session *session1;
+    __block __weak DIScopeTests_Session *weakSession2;
+    [scope1 perform:^{
+        XCTAssertEqual([DIScope currentScope], scope1);
+        session1 = test.session;
+        XCTAssertNotNil(session1);
+        XCTAssertEqual(test.otherSession, session1, @"Value should be shared inside scope");
+        XCTAssertEqual([DIScopeTests_Class new].session, session1);
+        
+        [scope2 perform:^{
+            weakSession2 = test.session;
+            XCTAssertNotNil(weakSession2);
+            XCTAssertNotEqual(weakSession2, session1);
+        }];
+        XCTAssertEqual(test.session, session1);
+    }];
+    XCTAssertNil([DIScope currentScope]);
+    XCTAssertEqual(scope1.count, 1);
+    
+    [scope2 end];
+    XCTAssertNil(weakSession2, @"Values should be released when scope ends");
+    XCTAssertEqual(scope2.count, 0);
+    
+    [scope2 perform:^{
+        XCTAssertNotNil(test.session, @"Ended scope should build values again");
+    }];
+}
+
+- (void)testScopedBlock {
+    DIGetter sessionGetter = DIGetterScoped(^id(id target, SEL cmd) {
+        return [DIScopeTests_Session new];
+    });
+    [DeluxeInjection injectBlock:^DIGetter(Class targetClass, SEL getter, NSString *propertyName, Class propertyClass, NSSet<Protocol *> *propertyProtocols) {
+        return (targetClass == [DIScopeTests_Class class]) ? sessionGetter : nil;
+    }];
+    
+    __block __weak DIScopeTests_Session *weakSession;
+    @autoreleasepool {
+        DIScope *scope = [DIScope new];
+        DIScopeTests_Class *test = [DIScopeTests_Class new];
+        [scope perform:^{
+            XCTAssertEqual(test.session, test.otherSession);
+        }];
+        [scope perform:^{
+            weakSession = test.session;
+        }];
+        XCTAssertNotNil(weakSession);
+    }
+    XCTAssertNil(weakSession, @"Values should be released with scope");
+}
+
+- (void)testScopeBuildsOutOfLock {
+    DIScope *scope = [DIScope new];
+    DIScopeSlot slot = DIScopeSlotCreate();
+    DIScopeSlot otherSlot = DIScopeSlotCreate();
+    id value = [scope objectForSlot:slot building:^id {
+        __block id otherValue;
+        dispatch_sync(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+            otherValue = [scope objectForSlot:otherSlot building:^id {
+                return [DIScopeTests_Session new];
+            }];
+        });
+        XCTAssertNotNil(otherValue, @"Other threads should access scope while value is built");
+        return [DIScopeTests_Session new];
+    }];
+    XCTAssertNotNil(value);
+    XCTAssertEqual(scope.count, 2);
+    
+    DIScopeSlot throwingSlot = DIScopeSlotCreate();
+    XCTAssertThrows([scope perform:^{
+        [scope objectForSlot:throwingSlot building:^id {
+            @throw [NSException exceptionWithName:NSInternalInconsistencyException reason:@"Build failed" userInfo:nil];
+        }];
+    }]);
+    XCTAssertNil([DIScope currentScope], @"Previous scope should be restored after exception");
+    XCTAssertEqual([scope objectForSlot:slot building:^id { return nil; }], value, @"Scope should stay usable after exception");
+}
+
+- (void)testScopeHoldsSparseSlots {
+    NSMutableArray<NSNumber *> *slots = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 1000; i++) {
+        DIScopeSlot slot = DIScopeSlotCreate();
+        if (i % 100 == 0) {
+            [slots addObject:@(slot)];
+        }
+    }
+    
+    DIScope *scope = [DIScope new];
+    NSMutableArray *values = [NSMutableArray array];
+    for (NSNumber *slot in slots) {
+        [values addObject:[scope objectForSlot:slot.unsignedIntegerValue building:^id {
+            return [DIScopeTests_Session new];
+        }]];
+    }
+    XCTAssertEqual(scope.count, slots.count);
+    for (NSUInteger i = 0; i < slots.count; i++) {
+        id value = [scope objectForSlot:slots[i].unsignedIntegerValue building:^id { return nil; }];
+        XCTAssertEqual(value, values[i], @"Every slot should keep its own value");
+    }
+    
+    [scope end];
+    XCTAssertEqual(scope.count, 0);
+    XCTAssertNil([scope objectForSlot:slots.firstObject.unsignedIntegerValue building:^id { return nil; }]);
+}
+
+@end
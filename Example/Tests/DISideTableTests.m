@@ -0,0 +1,91 @@
+//
+//  DISideTableTests.m
+//  DeluxeInjection
+//
+//  Created by agent on 17.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#import "AbstractTests.h"
+
+#import <DeluxeInjection/DeluxeInjection.h>
+
+//
+
+@interface DISideTableTests_Class : NSObject
+
+@property (strong, nonatomic) NSObject<DIAssociate> *associated;
+@property (copy, nonatomic) NSString<DIAssociate> *copied;
+@property (weak, nonatomic) NSObject<DIAssociate> *weak;
+@property (strong, nonatomic) NSMutableArray<DILazy> *lazyArray;
+
+@end
+
+@implementation DISideTableTests_Class
+
+@dynamic associated;
+@dynamic copied;
+@dynamic weak;
+@dynamic lazyArray;
+
+@end
+
+//
+
+@interface DISideTableTests : AbstractTests
+
+@end
+
+@implementation DISideTableTests
+
+- (void)tearDown {
+    [DeluxeInjection rejectAssociate];
+    [DeluxeInjection rejectLazy];
+    
+    [super tearDown];
+}
+
+- (void)testAssociate {
+    [DeluxeInjection injectAssociateWithStorage:DIAssociationStorageSideTable];
+    
+    DISideTableTests_Class *test = [DISideTableTests_Class new];
+    NSObject *object = [NSObject new];
+    NSMutableString *string = [NSMutableString stringWithString:@"abc"];
+    
+    test.associated = object;
+    test.copied = (id)string;
+    test.weak = object;
+    [string appendString:@"def"];
+    
+    XCTAssertEqual(test.associated, object);
+    XCTAssertEqualObjects(test.copied, @"abc");
+    XCTAssertEqual(test.weak, object);
+    
+    test.associated = nil;
+    XCTAssertNil(test.associated);
+}
+
+- (void)testValuesReleasedOnDealloc {
+    [DeluxeInjection injectAssociateWithStorage:DIAssociationStorageSideTable];
+    
+    __weak NSObject *weakObject = nil;
+    @autoreleasepool {
+        DISideTableTests_Class *test = [DISideTableTests_Class new];
+        NSObject *object = [NSObject new];
+        weakObject = object;
+        test.associated = object;
+    }
+    XCTAssertNil(weakObject);
+}
+
+- (void)testLazy {
+    [DeluxeInjection injectLazyWithStorage:DIAssociationStorageSideTable];
+    
+    DISideTableTests_Class *test = [DISideTableTests_Class new];
+    DISideTableTests_Class *test2 = [DISideTableTests_Class new];
+    XCTAssertNotNil(test.lazyArray);
+    XCTAssertEqual(test.lazyArray, test.lazyArray);
+    XCTAssertNotEqual(test.lazyArray, test2.lazyArray);
+}
+
+@end
@@ -0,0 +1,140 @@
+//
+//  DIStatsTests.m
+//  DeluxeInjection
+//
+//  Created by agent on 17.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#import "AbstractTests.h"
+
+#import <DeluxeInjection/DeluxeInjection.h>
+
+//
+
+@interface DIStatsTests_Value : NSObject
+
+@end
+
+@implementation DIStatsTests_Value
+
+@end
+
+@interface DIStatsTests_Class : NSObject
+
+@property (strong, nonatomic) DIStatsTests_Value<DIInject> *value;
+
+@end
+
+@implementation DIStatsTests_Class
+
+@end
+
+//
+
+@interface DIStatsTests : AbstractTests
+
+@end
+
+@implementation DIStatsTests
+
+- (void)setUp {
+    [super setUp];
+    
+    [DeluxeInjection resetStats];
+    [DeluxeInjection setStatsSampleInterval:1];
+}
+
+- (void)tearDown {
+    [DeluxeInjection setStatsEnabled:NO];
+    [DeluxeInjection setStatsSampleInterval:64];
+    [DeluxeInjection imperative:^(DIImperative *lets) {
+        [lets rejectAll];
+        [lets skipAsserts];
+    }];
+    
+    [super tearDown];
+}
+
+- (void)injectValue {
+    [DeluxeInjection imperative:^(DIImperative *lets) {
+        [[[lets inject] byPropertyClass:[DIStatsTests_Value class]] getterValueLazyByClass:[DIStatsTests_Value class]];
+        [lets skipAsserts];
+    }];
+}
+
+- (DIAccessorStats *)statsOfSelector:(SEL)selector {
+    for (DIAccessorStats *stats in [DeluxeInjection statsSnapshot]) {
+        if (stats.targetClass == [DIStatsTests_Class class] && stats.selector == selector) {
+            return stats;
+        }
+    }
+    return nil;
+}
+
+- (void)testDisabled {
+    [self injectValue];
+    [DeluxeInjection setStatsEnabled:YES];
+    
+    XCTAssertNotNil([DIStatsTests_Class new].value);
+    XCTAssertNil([self statsOfSelector:@selector(value)], @"Accessors injected while stats are disabled should not be instrumented");
+}
+
+- (void)testCounters {
+    [DeluxeInjection setStatsEnabled:YES];
+    [self injectValue];
+    
+    DIStatsTests_Class *test = [DIStatsTests_Class new];
+    for (NSInteger i = 0; i < 10; i++) {
+        XCTAssertNotNil(test.value);
+    }
+    XCTAssertNotNil([DIStatsTests_Class new].value);
+    
+    DIAccessorStats *getterStats = [self statsOfSelector:@selector(value)];
+    XCTAssertEqual(getterStats.calls, 11);
+    XCTAssertEqual(getterStats.slowPaths, 2, @"Only first access of every object should invoke provider");
+    XCTAssertEqual(getterStats.sampledCalls, 11);
+    XCTAssertEqual([[getterStats.latencyHistogram valueForKeyPath:@"@sum.self"] unsignedLongLongValue], 11);
+    XCTAssertGreaterThan([getterStats latencyAtPercentile:1.0], 0);
+    XCTAssertFalse(getterStats.isSetter);
+    
+    [DeluxeInjection setStatsEnabled:NO];
+    XCTAssertNotNil(test.value);
+    XCTAssertEqual([self statsOfSelector:@selector(value)].calls, 11, @"Disabled stats should not count");
+}
+
+- (void)testThreads {
+    [DeluxeInjection setStatsEnabled:YES];
+    [DeluxeInjection setStatsSampleInterval:16];
+    [self injectValue];
+    
+    dispatch_apply(8, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t iteration) {
+        DIStatsTests_Class *test = [DIStatsTests_Class new];
+        for (NSInteger i = 0; i < 160; i++) {
+            (void)test.value;
+        }
+    });
+    
+    DIAccessorStats *stats = [self statsOfSelector:@selector(value)];
+    XCTAssertEqual(stats.calls, 8 * 160);
+    XCTAssertEqual(stats.slowPaths, 8);
+    XCTAssertGreaterThan(stats.sampledCalls, 0);
+    XCTAssertLessThan(stats.sampledCalls, stats.calls);
+}
+
+- (void)testReset {
+    [DeluxeInjection setStatsEnabled:YES];
+    [self injectValue];
+    
+    DIStatsTests_Class *test = [DIStatsTests_Class new];
+    (void)test.value;
+    XCTAssertEqual([self statsOfSelector:@selector(value)].calls, 1);
+    
+    [DeluxeInjection resetStats];
+    XCTAssertNil([self statsOfSelector:@selector(value)]);
+    (void)test.value;
+    XCTAssertEqual([self statsOfSelector:@selector(value)].calls, 1);
+    XCTAssertEqual([self statsOfSelector:@selector(value)].slowPaths, 0);
+}
+
+@end
@@ -0,0 +1,110 @@
+//
+//  DITraceTests.m
+//  DeluxeInjection
+//
+//  Created by agent on 17.10.26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#import "AbstractTests.h"
+
+#import <DeluxeInjection/DeluxeInjection.h>
+
+//
+
+@interface DITraceTests_Value : NSObject
+
+@end
+
+@implementation DITraceTests_Value
+
+@end
+
+@interface DITraceTests_Class : NSObject
+
+@property (strong, nonatomic) DITraceTests_Value<DIInject> *value;
+
+@end
+
+@implementation DITraceTests_Class
+
+@end
+
+//
+
+@interface DITraceTests : AbstractTests
+
+@property (strong, nonatomic) NSString *path;
+
+@end
+
+@implementation DITraceTests
+
+- (void)setUp {
+    [super setUp];
+    
+    self.path = [NSTemporaryDirectory() stringByAppendingPathComponent:[NSUUID UUID].UUIDString];
+}
+
+- (void)tearDown {
+    [DeluxeInjection stopTracing];
+    [DeluxeInjection imperative:^(DIImperative *lets) {
+        [lets rejectAll];
+        [lets skipAsserts];
+    }];
+    [[NSFileManager defaultManager] removeItemAtPath:self.path error:NULL];
+    
+    [super tearDown];
+}
+
+- (NSArray<NSDictionary *> *)eventsOfCategory:(NSString *)category inTrace:(NSDictionary *)trace {
+    NSPredicate *predicate = [NSPredicate predicateWithFormat:@"ph == 'X' AND cat == %@", category];
+    return [trace[@"traceEvents"] filteredArrayUsingPredicate:predicate];
+}
+
+- (void)testTrace {
+    [DeluxeInjection startTracingToPath:self.path];
+    XCTAssertTrue([DeluxeInjection isTracing]);
+    
+    [DeluxeInjection imperative:^(DIImperative *lets) {
+        [[[lets inject] byPropertyClass:[DITraceTests_Value class]] getterValueLazyByClass:[DITraceTests_Value class]];
+        [lets skipAsserts];
+    }];
+    XCTAssertNotNil([DITraceTests_Class new].value);
+    
+    XCTAssertTrue([DeluxeInjection stopTracing]);
+    XCTAssertFalse([DeluxeInjection isTracing]);
+    
+    NSDictionary *trace = [NSJSONSerialization JSONObjectWithData:[NSData dataWithContentsOfFile:self.path] options:0 error:NULL];
+    XCTAssertNotNil(trace);
+    
+    NSArray<NSDictionary *> *imperative = [self eventsOfCategory:@"imperative" inTrace:trace];
+    XCTAssertTrue([[imperative valueForKey:@"name"] containsObject:@"imperative"]);
+    XCTAssertTrue([[imperative valueForKey:@"name"] containsObject:@"resolve inject"]);
+    
+    NSPredicate *replaceValue = [NSPredicate predicateWithFormat:@"name == 'replace getter' AND args.class == %@ AND args.selector == 'value'", NSStringFromClass([DITraceTests_Class class])];
+    XCTAssertEqual([[self eventsOfCategory:@"commit" inTrace:trace] filteredArrayUsingPredicate:replaceValue].count, 1);
+    
+    NSPredicate *lazyValue = [NSPredicate predicateWithFormat:@"name == 'lazy value' AND args.class == %@ AND args.property == 'value'", NSStringFromClass([DITraceTests_Class class])];
+    NSDictionary *lazy = [[[self eventsOfCategory:@"lazy" inTrace:trace] filteredArrayUsingPredicate:lazyValue] firstObject];
+    XCTAssertNotNil(lazy);
+    XCTAssertGreaterThanOrEqual([lazy[@"dur"] doubleValue], 0);
+    
+    NSPredicate *threadName = [NSPredicate predicateWithFormat:@"ph == 'M' AND name == 'thread_name' AND tid == %@", lazy[@"tid"]];
+    NSDictionary *thread = [[trace[@"traceEvents"] filteredArrayUsingPredicate:threadName] firstObject];
+    XCTAssertEqualObjects(thread[@"args"][@"name"], @"Main Thread");
+}
+
+- (void)testNotTracing {
+    [DeluxeInjection imperative:^(DIImperative *lets) {
+        [[[lets inject] byPropertyClass:[DITraceTests_Value class]] getterValueLazyByClass:[DITraceTests_Value class]];
+        [lets skipAsserts];
+    }];
+    XCTAssertNotNil([DITraceTests_Class new].value);
+    
+    XCTAssertFalse([DeluxeInjection isTracing]);
+    XCTAssertFalse([DeluxeInjection stopTracing]);
+    XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:self.path]);
+}
+
+@end